@@ -0,0 +1,104 @@
+// Times the complex scan loop with the linked active edge list and with the
+// array-based one, for shapes that keep a given number of edges active.
+// The rasterizer switches to the array once a path has more than
+// ACTIVE_EDGE_ARRAY_THRESHOLD (16) edges.
+//
+// "walk" is the work of the list alone: inserting, walking and advancing
+// the edges.  "fill" adds filling the coverage buffer, as the rasterizer's
+// complex scans do.  Times are linked / array.
+//
+// Run with `cargo bench --features bench_internals --bench active_edge_list`.
+
+use std::time::{Duration, Instant};
+use wpf_gpu_raster::bench_internals::{sweep_active_edges, ActiveEdgeList};
+
+// 28.4 fixed point
+fn fix4(x: f32) -> i32 {
+    (x * 16.) as i32
+}
+
+fn bars(edge_count: usize) -> Vec<Vec<(i32, i32)>> {
+    // Slanted bars spanning the height, so that all edges stay active and
+    // their DDAs step every subscanline
+    (0..edge_count / 2).map(|i| {
+        let x = 20. + i as f32 * 900. / (edge_count / 2) as f32;
+        vec![
+            (fix4(x), fix4(0.)),
+            (fix4(x + 6.), fix4(0.)),
+            (fix4(x + 26.), fix4(1000.)),
+            (fix4(x + 20.), fix4(1000.)),
+        ]
+    }).collect()
+}
+
+fn staggered(edge_count: usize) -> Vec<Vec<(i32, i32)>> {
+    // Short bars starting at different heights, so that edges keep being
+    // inserted and retired while about 'edge_count' are active
+    let bar_count = edge_count / 2;
+    (0..bar_count * 64).map(|i| {
+        let x = 20. + (i % bar_count) as f32 * 900. / bar_count as f32;
+        let y = (i / bar_count) as f32 * 15. + (i % bar_count) as f32 * 15. / bar_count as f32;
+        vec![
+            (fix4(x), fix4(y)),
+            (fix4(x + 6.), fix4(y)),
+            (fix4(x + 9.), fix4(y + 15.)),
+            (fix4(x + 3.), fix4(y + 15.)),
+        ]
+    }).collect()
+}
+
+fn shuffled(edge_count: usize) -> Vec<Vec<(i32, i32)>> {
+    // The staggered bars in a random order, so that the edges that are
+    // active together are scattered through the edge store
+    let mut polygons = staggered(edge_count);
+    let mut seed: u64 = 1;
+    for i in (1..polygons.len()).rev() {
+        seed = seed.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+        polygons.swap(i, (seed >> 33) as usize % (i + 1));
+    }
+    polygons
+}
+
+fn time_once(polygons: &[Vec<(i32, i32)>], list: ActiveEdgeList, fill: bool, iterations: u32) -> Duration {
+    let start = Instant::now();
+    for _ in 0..iterations {
+        std::hint::black_box(sweep_active_edges(polygons, list, fill));
+    }
+    start.elapsed()
+}
+
+fn bench(name: &str, polygons: &[Vec<(i32, i32)>]) {
+    print!("{:<14}", name);
+    for fill in [false, true] {
+        assert_eq!(sweep_active_edges(polygons, ActiveEdgeList::Linked, fill), sweep_active_edges(polygons, ActiveEdgeList::Array, fill));
+
+        let mut iterations = 1;
+        while time_once(polygons, ActiveEdgeList::Linked, fill, iterations) < Duration::from_millis(20) {
+            iterations *= 2;
+        }
+
+        // Alternate between the lists so that both see the same
+        // conditions, and report the best round of each, which is the
+        // least noisy
+        let (mut linked, mut array) = (Duration::MAX, Duration::MAX);
+        for _ in 0..15 {
+            linked = linked.min(time_once(polygons, ActiveEdgeList::Linked, fill, iterations) / iterations);
+            array = array.min(time_once(polygons, ActiveEdgeList::Array, fill, iterations) / iterations);
+        }
+        print!("  {} {:>9.1?} / {:>9.1?} ({:.2}x)", if fill { "fill" } else { "walk" }, linked, array,
+            linked.as_secs_f64() / array.as_secs_f64());
+    }
+    println!();
+}
+
+fn main() {
+    for edge_count in [8, 12, 16, 20, 32, 64] {
+        bench(&format!("bars_{}", edge_count), &bars(edge_count));
+    }
+    for edge_count in [8, 16, 32] {
+        bench(&format!("staggered_{}", edge_count), &staggered(edge_count));
+    }
+    for edge_count in [8, 16, 32] {
+        bench(&format!("shuffled_{}", edge_count), &shuffled(edge_count));
+    }
+}
@@ -0,0 +1,132 @@
+// Times rasterization of shapes whose active edge lists rarely go out of
+// order (the common case) and of shapes whose edges cross on nearly every
+// subscanline, where the active edge list has to be re-sorted constantly.
+//
+// Run with `cargo bench --bench active_edge_sort`.
+
+use std::time::{Duration, Instant};
+use wpf_gpu_raster::PathBuilder;
+
+struct Random(u64);
+
+impl Random {
+    fn next(&mut self) -> f32 {
+        self.0 = self.0.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407);
+        ((self.0 >> 33) as f32) / (1u64 << 31) as f32
+    }
+}
+
+fn circle() -> PathBuilder {
+    let mut p = PathBuilder::new();
+    p.move_to(500., 50.);
+    p.curve_to(1000., 50., 1000., 950., 500., 950.);
+    p.curve_to(0., 950., 0., 50., 500., 50.);
+    p.close();
+    p
+}
+
+fn triangles() -> PathBuilder {
+    let mut r = Random(1);
+    let mut p = PathBuilder::new();
+    for _ in 0..200 {
+        let (x, y) = (r.next() * 900., r.next() * 900.);
+        p.move_to(x, y);
+        p.line_to(x + r.next() * 100., y + r.next() * 100.);
+        p.line_to(x + r.next() * 100., y + r.next() * 100.);
+        p.close();
+    }
+    p
+}
+
+fn text_like() -> PathBuilder {
+    // Many small, separate rectangles, like the stems of glyphs
+    let mut p = PathBuilder::new();
+    for row in 0..40 {
+        for column in 0..80 {
+            p.add_rect(column as f32 * 12. + 2.3, row as f32 * 24. + 3.7, 2.5, 14.);
+        }
+    }
+    p
+}
+
+fn star(points: usize) -> PathBuilder {
+    // The {points/(points/2)} star polygon: every edge crosses nearly
+    // every other edge
+    let mut p = PathBuilder::new();
+    for i in 0..points {
+        let angle = (i * (points / 2)) as f32 * std::f32::consts::TAU / points as f32;
+        let (x, y) = (500. + 450. * angle.sin(), 500. - 450. * angle.cos());
+        if i == 0 { p.move_to(x, y) } else { p.line_to(x, y) }
+    }
+    p.close();
+    p
+}
+
+fn scribble() -> PathBuilder {
+    let mut r = Random(7);
+    let mut p = PathBuilder::new();
+    p.move_to(500., 500.);
+    for _ in 0..300 {
+        p.line_to(50. + r.next() * 900., 50. + r.next() * 900.);
+    }
+    p.close();
+    p
+}
+
+fn hatch() -> PathBuilder {
+    // Two families of thin diagonal bars crossing each other
+    let mut p = PathBuilder::new();
+    for i in 0..60 {
+        let x = i as f32 * 16. - 500.;
+        p.move_to(x, 0.);
+        p.line_to(x + 3., 0.);
+        p.line_to(x + 1003., 1000.);
+        p.line_to(x + 1000., 1000.);
+        p.close();
+        p.move_to(x + 1000., 0.);
+        p.line_to(x + 1003., 0.);
+        p.line_to(x + 3., 1000.);
+        p.line_to(x, 1000.);
+        p.close();
+    }
+    p
+}
+
+fn bench(name: &str, p: &PathBuilder) {
+    let mut output = Vec::new();
+    p.rasterize_into(0, 0, 1000, 1000, &mut output);
+
+    // Repeat until enough time has passed and report the best of a few
+    // rounds, which is the least noisy
+    let mut iterations = 1;
+    loop {
+        let start = Instant::now();
+        for _ in 0..iterations {
+            p.rasterize_into(0, 0, 1000, 1000, &mut output);
+        }
+        if start.elapsed() > Duration::from_millis(100) {
+            break;
+        }
+        iterations *= 2;
+    }
+    let best = (0..5).map(|_| {
+        let start = Instant::now();
+        for _ in 0..iterations {
+            p.rasterize_into(0, 0, 1000, 1000, &mut output);
+        }
+        start.elapsed() / iterations
+    }).min().unwrap();
+    println!("{:<12} {:>10.1?} {:>8} vertices", name, best, output.len());
+}
+
+fn main() {
+    println!("rare inversions:");
+    bench("circle", &circle());
+    bench("triangles", &triangles());
+    bench("text_like", &text_like());
+    println!("frequent inversions:");
+    bench("star_31", &star(31));
+    bench("star_201", &star(201));
+    bench("scribble", &scribble());
+    bench("hatch", &hatch());
+}
@@ -0,0 +1,57 @@
+// Times SortActiveEdges and MergeSortActiveEdges on their own, sorting a
+// prepared linked active edge list, against a plain bubble sort that never
+// hands off to the merge sort.  The cases with rare inversions are what
+// the rasterizer normally sees; one edge moving far and a reversed list
+// are what make the bubble sort quadratic.
+//
+// Run with `cargo bench --features bench_internals --bench active_edge_sort_list`.
+
+use std::time::{Duration, Instant};
+use wpf_gpu_raster::bench_internals::{ActiveEdgeSort, UnsortedActiveEdges};
+
+fn time_once(list: &mut UnsortedActiveEdges, sort: Option<ActiveEdgeSort>, iterations: u32) -> Duration {
+    let start = Instant::now();
+    for _ in 0..iterations {
+        list.reset();
+        if let Some(sort) = sort {
+            list.sort(sort);
+        }
+        std::hint::black_box(&list);
+    }
+    start.elapsed()
+}
+
+fn bench(name: &str, xs: &[i32]) {
+    let mut list = UnsortedActiveEdges::new(xs);
+    print!("{:<20}", name);
+    for sort in [ActiveEdgeSort::BubbleSortActiveEdges, ActiveEdgeSort::SortActiveEdges, ActiveEdgeSort::MergeSortActiveEdges] {
+        list.reset();
+        list.sort(sort);
+        assert!(list.is_sorted());
+
+        let mut iterations = 1;
+        while time_once(&mut list, Some(sort), iterations) < Duration::from_millis(20) {
+            iterations *= 2;
+        }
+
+        // Take off the time it takes to put the list back in order, and
+        // report the best of a few rounds, which is the least noisy
+        let best = (0..7).map(|_| {
+            let sorted = time_once(&mut list, Some(sort), iterations);
+            let reset = time_once(&mut list, None, iterations);
+            sorted.saturating_sub(reset) / iterations
+        }).min().unwrap();
+        print!("  {:?} {:>9.1?}", sort, best);
+    }
+    println!();
+}
+
+fn main() {
+    println!("rare inversions:");
+    bench("n30_one_swap", &{ let mut v: Vec<i32> = (0..30).map(|i| i * 10).collect(); v.swap(10, 11); v });
+    bench("n240_40_swaps", &{ let mut v: Vec<i32> = (0..240).map(|i| i * 10).collect(); for k in 0..40 { v.swap(k * 6, k * 6 + 1); } v });
+    println!("frequent inversions:");
+    bench("n200_chunks_reversed", &(0..200).map(|i| (i / 20) * 20 + (19 - i % 20)).collect::<Vec<i32>>());
+    bench("n200_one_far", &{ let mut v: Vec<i32> = (0..200).map(|i| i * 10).collect(); v[199] = -5; v });
+    bench("n200_reversed", &(0..200).rev().collect::<Vec<i32>>());
+}
@@ -6,15 +6,14 @@
 //------------------------------------------------------------------------------
 //
 
-use std::cell::Cell;
-
-use typed_arena_nomut::Arena;
+use std::cell::{Cell, RefCell};
 
 //
 //  Description:
 //      Coverage buffer implementation
 //
-use crate::aarasterizer::{AssertActiveList, CEdge};
+use crate::aarasterizer::{AssertActiveList, CEdge, IActiveEdgeList};
+use crate::allocator::CTransientArray;
 use crate::nullable_ref::Ref;
 use crate::types::*;
 //struct CEdge;
@@ -42,50 +41,35 @@ pub const c_antiAliasMode: MilAntiAliasMode = MilAntiAliasMode::EightByEight;
 // Interval coverage descriptor for our antialiased filler
 //
 
-pub struct CCoverageInterval<'a>
+#[derive(Clone, Default)]
+pub struct CCoverageInterval
 {
-    pub m_pNext: Cell<Ref<'a, CCoverageInterval<'a>>>, // m_pNext interval (look for sentinel, not NULL)
-    pub m_nPixelX: Cell<INT>,              // Interval's left edge (m_pNext->X is the right edge)
-    pub m_nCoverage: Cell<INT>,            // Pixel coverage for interval
+    pub m_iNext: UINT,            // Index of the m_iNext interval (look for sentinel, not c_iIntervalNone)
+    pub m_nPixelX: INT,           // Interval's left edge (m_iNext->X is the right edge)
+    pub m_nCoverage: INT,         // Pixel coverage for interval
 }
 
-impl<'a> Default for CCoverageInterval<'a> {
-    fn default() -> Self {
-        Self { m_pNext: Cell::new(unsafe { Ref::null() } ), m_nPixelX: Default::default(), m_nCoverage: Default::default() }
-    }
-}
+// Intervals are linked by their index in the coverage buffer's array.  The
+// head and tail sentinels always live at the front:
 
-// Define our on-stack storage use.  The 'free' versions are nicely tuned
-// to avoid allocations in most common scenarios, while at the same time
-// not chewing up toooo much stack space.  
+pub const c_iIntervalHead: UINT = 0;
+pub const c_iIntervalTail: UINT = 1;
+pub const c_iIntervalNone: UINT = UINT::MAX;
+
+// Define our initial storage use.  The 'free' versions are nicely tuned
+// to avoid reallocations in most common scenarios.  The array is handed
+// back to the device's buffer dispenser after each rasterization, so
+// once it has grown to fit a scene it is not reallocated again.
 //
 // We make the debug versions small so that we hit the 'grow' cases more
 // frequently, for better testing:
 
 #[cfg(debug_assertions)]
-    // Must be at least 6 now: 4 for the "minus4" logic in hwrasterizer.*, and then 
-    // 1 each for the head and tail sentinels (since their allocation doesn't use Grow).
-    const INTERVAL_BUFFER_NUMBER: usize = 8;        
+    const INTERVAL_BUFFER_NUMBER: usize = 8;
 #[cfg(not(debug_assertions))]
     const INTERVAL_BUFFER_NUMBER: usize = 32;
 
 
-//
-// Allocator structure for the antialiased fill interval data
-//
-
-struct CCoverageIntervalBuffer<'a>
-{
-    m_pNext: Cell<Option<& 'a CCoverageIntervalBuffer<'a>>>,
-    m_interval: [CCoverageInterval<'a>; INTERVAL_BUFFER_NUMBER],
-}
-
-impl<'a>  Default for CCoverageIntervalBuffer<'a> {
-    fn default() -> Self {
-        Self { m_pNext: Cell::new(None), m_interval: Default::default() }
-    }
-}
-
 //------------------------------------------------------------------------------
 //
 //  Class: CCoverageBuffer
@@ -110,10 +94,13 @@ impl<'a>  Default for CCoverageIntervalBuffer<'a> {
 //
 //     m_nPixelX: INT_MIN  |  0  |  1  |  3  |  4  | INT_MAX
 //   m_nCoverage: 0        |  4  |  8  |  4  |  0  | 0xdeadbeef
-//       m_pNext: -------->|---->|---->|---->|---->| NULL
+//       m_iNext: -------->|---->|---->|---->|---->| c_iIntervalNone
+//
+//      The intervals all live in one array and link to each other by index,
+//      so walking a scanline stays within a single allocation.
 //              
 //------------------------------------------------------------------------------
-pub struct CCoverageBuffer<'a>
+pub struct CCoverageBuffer
 {
     /*
 public:
@@ -148,54 +135,27 @@ public:
 
 private:
 
-    HRESULT Grow(
-        __deref_out_ecount(1) CCoverageInterval **ppIntervalNew, 
-        __deref_out_ecount(1) CCoverageInterval **ppIntervalEndMinus4
-        );
+    HRESULT Grow();
 
 public:*/
-    pub m_pIntervalStart: Cell<Ref<'a, CCoverageInterval<'a>>>,           // Points to list head entry
-
-//private:
-    m_pIntervalNew: Cell<Ref<'a, CCoverageInterval<'a>>>,
-    interval_new_index: Cell<usize>,
-
-    // The Minus4 in the below variable refers to the position at which
-    // we need to Grow the buffer.  The buffer is grown once before an
-    // AddInterval, so the Grow has to ensure that there are enough 
-    // intervals for the AddInterval worst case which is the following:
-    //
-    //  1     2           3     4
-    //  *_____*_____ _____*_____* 
-    //  |     |     |     |     |
-    //  |  ---|-----------|---  |
-    //  |_____|_____|_____|_____|
-    //
-    // Note that the *'s above mark potentional insert points in the list,
-    // so we need to ensure that at least 4 intervals can be allocated.
-    //
+    // The intervals, with the head and tail sentinels at c_iIntervalHead
+    // and c_iIntervalTail.  New intervals are appended, and Reset
+    // truncates back to the sentinels without giving up the allocation.
 
-    m_pIntervalEndMinus4:  Cell<Ref<'a, CCoverageInterval<'a>>>,
+    pub m_rgInterval: RefCell<CTransientArray<CCoverageInterval>>,
 
-    m_pIntervalBufferBuiltin: CCoverageIntervalBuffer<'a>,
-    m_pIntervalBufferCurrent: Cell<Ref<'a, CCoverageIntervalBuffer<'a>>>,
+    // Where AddInterval found its insertion point last time
+    m_iIntervalCursor: Cell<UINT>,
 
-    arena: Arena<CCoverageIntervalBuffer<'a>>
-       
     // Disable instrumentation checks within all methods of this class
     //SET_MILINSTRUMENTATION_FLAGS(MILINSTRUMENTATIONFLAGS_DONOTHING);
 }
 
-impl<'a> Default for CCoverageBuffer<'a> {
+impl Default for CCoverageBuffer {
     fn default() -> Self {
         Self {
-            m_pIntervalStart: Cell::new(unsafe { Ref::null() }),
-            m_pIntervalNew: Cell::new(unsafe { Ref::null() }),
-            m_pIntervalEndMinus4: Cell::new(unsafe { Ref::null() }),
-            m_pIntervalBufferBuiltin: Default::default(),
-            m_pIntervalBufferCurrent: unsafe { Cell::new(Ref::null()) },
-            arena: Arena::new(),
-            interval_new_index: Cell::new(0),
+            m_rgInterval: RefCell::new(Default::default()),
+            m_iIntervalCursor: Cell::new(c_iIntervalHead),
         }
     }
 }
@@ -204,7 +164,7 @@ impl<'a> Default for CCoverageBuffer<'a> {
 //
 // Inlines
 //
-impl<'a> CCoverageBuffer<'a> {
+impl CCoverageBuffer {
 //-------------------------------------------------------------------------
 //
 //  Function:   CCoverageBuffer::AddInterval
@@ -212,7 +172,7 @@ impl<'a> CCoverageBuffer<'a> {
 //  Synopsis:   Add a subpixel resolution interval to the coverage buffer
 // 
 //-------------------------------------------------------------------------
-pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESULT
+pub fn AddInterval(&self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESULT
 {
     let hr: HRESULT = S_OK;
     let mut nPixelXNext: INT;
@@ -221,18 +181,7 @@ pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESU
     let nCoverageLeft: INT;  // coverage from right edge of pixel for interval start
     let nCoverageRight: INT; // coverage from left edge of pixel for interval end
 
-    let mut pInterval = self.m_pIntervalStart.get();
-    let mut pIntervalNew = self.m_pIntervalNew.get();
-    let mut interval_new_index = self.interval_new_index.get();
-    let mut pIntervalEndMinus4 = self.m_pIntervalEndMinus4.get();
-
-    // Make sure we have enough room to add two intervals if
-    // necessary:
-
-    if (pIntervalNew >= pIntervalEndMinus4)
-    {
-        IFC!(self.Grow(&mut pIntervalNew, &mut pIntervalEndMinus4, &mut interval_new_index));
-    }
+    let rgInterval = &mut *self.m_rgInterval.borrow_mut();
 
     // Convert interval to pixel space so that we can insert it 
     // into the coverage buffer
@@ -241,34 +190,62 @@ pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESU
     nPixelXLeft = nSubpixelXLeft >> c_nShift;
     nPixelXRight = nSubpixelXRight >> c_nShift; 
 
+    // The fillers add the intervals of a subscanline in ascending 'x'
+    // order, so rather than walking from the head every time we start
+    // from where the previous interval was inserted.  Any interval left
+    // of 'nPixelXLeft' is a valid place to start; otherwise fall back to
+    // the head:
+
+    let mut iInterval = self.m_iIntervalCursor.get();
+    if (rgInterval[iInterval as usize].m_nPixelX >= nPixelXLeft)
+    {
+        iInterval = c_iIntervalHead;
+    }
+
     // Skip any intervals less than 'nPixelLeft':
 
     loop {
-        nPixelXNext = pInterval.m_pNext.get().m_nPixelX.get();
+        nPixelXNext = rgInterval[rgInterval[iInterval as usize].m_iNext as usize].m_nPixelX;
         if !(nPixelXNext < nPixelXLeft) { break }
 
-        pInterval = pInterval.m_pNext.get();
+        iInterval = rgInterval[iInterval as usize].m_iNext;
     }
 
-    // Insert a new interval if necessary:
+    self.m_iIntervalCursor.set(iInterval);
 
-    if (nPixelXNext != nPixelXLeft)
+    // Fast path: an interval within a single pixel that already has
+    // its own entry (i.e. every subscanline of a pixel after the first)
+    // is just a coverage update:
+
+    if (nPixelXLeft == nPixelXRight && nPixelXNext == nPixelXLeft)
     {
-        pIntervalNew.m_nPixelX.set(nPixelXLeft);
-        pIntervalNew.m_nCoverage.set(pInterval.m_nCoverage.get());
+        let iIntervalPixel = rgInterval[iInterval as usize].m_iNext;
+        if (rgInterval[rgInterval[iIntervalPixel as usize].m_iNext as usize].m_nPixelX == nPixelXLeft + 1)
+        {
+            rgInterval[iIntervalPixel as usize].m_nCoverage += nSubpixelXRight - nSubpixelXLeft;
+            debug_assert!(rgInterval[iIntervalPixel as usize].m_nCoverage <= c_nShiftSize*c_nShiftSize);
+            return hr;
+        }
+    }
 
-        pIntervalNew.m_pNext.set(pInterval.m_pNext.get());
-        pInterval.m_pNext.set(pIntervalNew);
+    // Make sure we have enough room to add the new intervals
+    // without reallocating part way through:
 
-        pInterval = pIntervalNew;
+    if (rgInterval.len() + 4 > rgInterval.capacity())
+    {
+        IFC!(Self::Grow(rgInterval));
+    }
 
-        interval_new_index += 1;
-        pIntervalNew = Ref::new(&Ref::get_ref(self.m_pIntervalBufferCurrent.get()).m_interval[interval_new_index])
+    // Insert a new interval if necessary:
 
+    if (nPixelXNext != nPixelXLeft)
+    {
+        let nCoverage = rgInterval[iInterval as usize].m_nCoverage;
+        iInterval = InsertIntervalAfter(rgInterval, iInterval, nPixelXLeft, nCoverage);
     }
     else
     {
-        pInterval = (*pInterval).m_pNext.get();
+        iInterval = rgInterval[iInterval as usize].m_iNext;
     }
 
     //
@@ -290,16 +267,10 @@ pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESU
     // for the end of the pixel 
 
     if ((nCoverageLeft < c_nShiftSize || (nPixelXLeft == nPixelXRight))
-        && nPixelXLeft + 1 != pInterval.m_pNext.get().m_nPixelX.get())
+        && nPixelXLeft + 1 != rgInterval[rgInterval[iInterval as usize].m_iNext as usize].m_nPixelX)
     {
-        pIntervalNew.m_nPixelX.set(nPixelXLeft + 1);
-        pIntervalNew.m_nCoverage.set(pInterval.m_nCoverage.get());
-
-        pIntervalNew.m_pNext.set(pInterval.m_pNext.get());
-        pInterval.m_pNext.set(pIntervalNew);
-
-        interval_new_index += 1;
-        pIntervalNew = Ref::new(&Ref::get_ref(self.m_pIntervalBufferCurrent.get()).m_interval[interval_new_index])
+        let nCoverage = rgInterval[iInterval as usize].m_nCoverage;
+        InsertIntervalAfter(rgInterval, iInterval, nPixelXLeft + 1, nCoverage);
     }
     
     //
@@ -309,53 +280,40 @@ pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESU
 
     if (nPixelXLeft == nPixelXRight)
     {
-        pInterval.m_nCoverage.set(pInterval.m_nCoverage.get() + nSubpixelXRight - nSubpixelXLeft);
-        debug_assert!(pInterval.m_nCoverage.get() <= c_nShiftSize*c_nShiftSize);
+        rgInterval[iInterval as usize].m_nCoverage += nSubpixelXRight - nSubpixelXLeft;
+        debug_assert!(rgInterval[iInterval as usize].m_nCoverage <= c_nShiftSize*c_nShiftSize);
         //goto Cleanup;
-
-        //Cleanup:
-        // Update the coverage buffer new interval
-        self.interval_new_index.set(interval_new_index);
-        self.m_pIntervalNew.set(pIntervalNew);
         return hr;
     }
 
     // Update coverage of current interval
-    pInterval.m_nCoverage.set(pInterval.m_nCoverage.get() + nCoverageLeft);
-    debug_assert!(pInterval.m_nCoverage.get() <= c_nShiftSize*c_nShiftSize);
+    rgInterval[iInterval as usize].m_nCoverage += nCoverageLeft;
+    debug_assert!(rgInterval[iInterval as usize].m_nCoverage <= c_nShiftSize*c_nShiftSize);
 
     // Increase the coverage for any intervals between 'nPixelXLeft'
     // and 'nPixelXRight':
 
     loop {
-        (nPixelXNext = pInterval.m_pNext.get().m_nPixelX.get());
+        (nPixelXNext = rgInterval[rgInterval[iInterval as usize].m_iNext as usize].m_nPixelX);
     
         if !(nPixelXNext < nPixelXRight) {
             break;
         }
-        pInterval = pInterval.m_pNext.get();
-        pInterval.m_nCoverage.set(pInterval.m_nCoverage.get() + c_nShiftSize);
-        debug_assert!(pInterval.m_nCoverage.get() <= c_nShiftSize*c_nShiftSize);
+        iInterval = rgInterval[iInterval as usize].m_iNext;
+        rgInterval[iInterval as usize].m_nCoverage += c_nShiftSize;
+        debug_assert!(rgInterval[iInterval as usize].m_nCoverage <= c_nShiftSize*c_nShiftSize);
     }
 
     // Insert another new interval if necessary:
 
     if (nPixelXNext != nPixelXRight)
     {
-        pIntervalNew.m_nPixelX.set(nPixelXRight);
-        pIntervalNew.m_nCoverage.set(pInterval.m_nCoverage.get() - c_nShiftSize);
-
-        pIntervalNew.m_pNext.set(pInterval.m_pNext.get());
-        pInterval.m_pNext.set(pIntervalNew);
-
-        pInterval = pIntervalNew;
-
-        interval_new_index += 1;
-        pIntervalNew = Ref::new(&Ref::get_ref(self.m_pIntervalBufferCurrent.get()).m_interval[interval_new_index])
+        let nCoverage = rgInterval[iInterval as usize].m_nCoverage - c_nShiftSize;
+        iInterval = InsertIntervalAfter(rgInterval, iInterval, nPixelXRight, nCoverage);
     }
     else
     {
-        pInterval = pInterval.m_pNext.get();
+        iInterval = rgInterval[iInterval as usize].m_iNext;
     }
 
     //
@@ -370,32 +328,70 @@ pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESU
     nCoverageRight = nSubpixelXRight & c_nShiftMask;
     if (nCoverageRight > 0)
     {
-        if (nPixelXRight + 1 != (*(*pInterval).m_pNext.get()).m_nPixelX.get())
+        if (nPixelXRight + 1 != rgInterval[rgInterval[iInterval as usize].m_iNext as usize].m_nPixelX)
         {
-            pIntervalNew.m_nPixelX.set(nPixelXRight + 1);
-            pIntervalNew.m_nCoverage.set(pInterval.m_nCoverage.get());
-
-            pIntervalNew.m_pNext.set(pInterval.m_pNext.get());
-            pInterval.m_pNext.set(pIntervalNew);
-
-            interval_new_index += 1;
-            pIntervalNew = Ref::new(&Ref::get_ref(self.m_pIntervalBufferCurrent.get()).m_interval[interval_new_index])
+            let nCoverage = rgInterval[iInterval as usize].m_nCoverage;
+            InsertIntervalAfter(rgInterval, iInterval, nPixelXRight + 1, nCoverage);
         }
 
-        pInterval.m_nCoverage.set((*pInterval).m_nCoverage.get() + nCoverageRight);
-        debug_assert!(pInterval.m_nCoverage.get() <= c_nShiftSize*c_nShiftSize);
+        rgInterval[iInterval as usize].m_nCoverage += nCoverageRight;
+        debug_assert!(rgInterval[iInterval as usize].m_nCoverage <= c_nShiftSize*c_nShiftSize);
     }
 
 //Cleanup:
-    // Update the coverage buffer new interval
-    self.interval_new_index.set(interval_new_index);
-    self.m_pIntervalNew.set(pIntervalNew);
-    
-
     return hr;
 }
 
 
+//-------------------------------------------------------------------------
+//
+//  Function:   CCoverageBuffer::AddPixelInterval
+//
+//  Synopsis:
+//      Add a pixel resolution interval with full coverage.  Used without
+//      anti-aliasing, where the intervals of a scanline are disjoint and
+//      added in ascending 'x' order, so each one goes after the last.
+// 
+//-------------------------------------------------------------------------
+pub fn AddPixelInterval(&self, nPixelXLeft: INT, nPixelXRight: INT) -> HRESULT
+{
+    let hr: HRESULT = S_OK;
+
+    let rgInterval = &mut *self.m_rgInterval.borrow_mut();
+
+    debug_assert!(nPixelXLeft < nPixelXRight);
+
+    if (rgInterval.len() + 2 > rgInterval.capacity())
+    {
+        IFC!(Self::Grow(rgInterval));
+    }
+
+    // Find the last interval, which has the tail after it:
+
+    let mut iInterval = self.m_iIntervalCursor.get();
+    while (rgInterval[iInterval as usize].m_iNext != c_iIntervalTail)
+    {
+        iInterval = rgInterval[iInterval as usize].m_iNext;
+    }
+
+    debug_assert!(rgInterval[iInterval as usize].m_nPixelX <= nPixelXLeft);
+    debug_assert!(rgInterval[iInterval as usize].m_nCoverage == 0);
+
+    if (rgInterval[iInterval as usize].m_nPixelX == nPixelXLeft)
+    {
+        rgInterval[iInterval as usize].m_nCoverage = c_nShiftSizeSquared;
+    }
+    else
+    {
+        iInterval = InsertIntervalAfter(rgInterval, iInterval, nPixelXLeft, c_nShiftSizeSquared);
+    }
+
+    iInterval = InsertIntervalAfter(rgInterval, iInterval, nPixelXRight, 0);
+    self.m_iIntervalCursor.set(iInterval);
+
+    return hr;
+}
+
 //-------------------------------------------------------------------------
 //
 //  Function:   CCoverageBuffer::FillEdgesAlternating
@@ -405,23 +401,23 @@ pub fn AddInterval(&'a self, nSubpixelXLeft: INT, nSubpixelXRight: INT) -> HRESU
 //      antialiased fill.
 //
 //-------------------------------------------------------------------------
-pub fn FillEdgesAlternating(&'a self,
-    pEdgeActiveList: Ref<CEdge>,
+pub fn FillEdgesAlternating<'a>(&self,
+    activeList: &impl IActiveEdgeList<'a>,
     nSubpixelYCurrent: INT
     ) -> HRESULT
 {
 
     let hr: HRESULT = S_OK;
-    let mut pEdgeStart: Ref<CEdge> = (*pEdgeActiveList).Next.get();
+    let mut pEdgeStart: Ref<CEdge> = activeList.Next(activeList.Head());
     let mut pEdgeEnd: Ref<CEdge>;
     let mut nSubpixelXLeft: INT;
     let mut nSubpixelXRight: INT;
 
-    ASSERTACTIVELIST!(pEdgeActiveList, nSubpixelYCurrent);
+    ASSERTACTIVELIST!(activeList, nSubpixelYCurrent);
 
     while (pEdgeStart.X.get() != INT::MAX)
     {
-        pEdgeEnd = pEdgeStart.Next.get();
+        pEdgeEnd = activeList.Next(pEdgeStart);
 
         // We skip empty pairs:
         (nSubpixelXLeft = pEdgeStart.X.get());
@@ -430,9 +426,9 @@ pub fn FillEdgesAlternating(&'a self,
             // We now know we have a non-empty interval.  Skip any
             // empty interior pairs:
 
-            while ({(nSubpixelXRight = pEdgeEnd.X.get()); pEdgeEnd.X == pEdgeEnd.Next.get().X})
+            while ({(nSubpixelXRight = pEdgeEnd.X.get()); pEdgeEnd.X == activeList.Next(pEdgeEnd).X})
             {
-                pEdgeEnd = pEdgeEnd.Next.get().Next.get();
+                pEdgeEnd = activeList.Next(activeList.Next(pEdgeEnd));
             }
 
             debug_assert!((nSubpixelXLeft < nSubpixelXRight) && (nSubpixelXRight < INT::MAX));
@@ -441,7 +437,7 @@ pub fn FillEdgesAlternating(&'a self,
         }
 
         // Prepare for the next iteration:
-        pEdgeStart = pEdgeEnd.Next.get();
+        pEdgeStart = activeList.Next(pEdgeEnd);
     }
 
 //Cleanup:
@@ -458,29 +454,29 @@ pub fn FillEdgesAlternating(&'a self,
 //      antialiased fill.
 //
 //-------------------------------------------------------------------------
-pub fn FillEdgesWinding(&'a self,
-    pEdgeActiveList: Ref<CEdge>,
+pub fn FillEdgesWinding<'a>(&self,
+    activeList: &impl IActiveEdgeList<'a>,
     nSubpixelYCurrent: INT
     ) -> HRESULT
 {
 
     let hr: HRESULT = S_OK;
-    let mut pEdgeStart: Ref<CEdge> = pEdgeActiveList.Next.get();
+    let mut pEdgeStart: Ref<CEdge> = activeList.Next(activeList.Head());
     let mut pEdgeEnd: Ref<CEdge>;
     let mut nSubpixelXLeft: INT;
     let mut nSubpixelXRight: INT;
     let mut nWindingValue: INT;
 
-    ASSERTACTIVELIST!(pEdgeActiveList, nSubpixelYCurrent);
+    ASSERTACTIVELIST!(activeList, nSubpixelYCurrent);
 
     while (pEdgeStart.X.get() != INT::MAX)
     {
-        pEdgeEnd = pEdgeStart.Next.get();
+        pEdgeEnd = activeList.Next(pEdgeStart);
 
         nWindingValue = pEdgeStart.WindingDirection;
         while ({nWindingValue += pEdgeEnd.WindingDirection; nWindingValue != 0})
         {
-            pEdgeEnd = pEdgeEnd.Next.get();
+            pEdgeEnd = activeList.Next(pEdgeEnd);
         }
 
         debug_assert!(pEdgeEnd.X.get() != INT::MAX);
@@ -492,15 +488,15 @@ pub fn FillEdgesWinding(&'a self,
             // We now know we have a non-empty interval.  Skip any
             // empty interior pairs:
 
-            while ({nSubpixelXRight = pEdgeEnd.X.get(); nSubpixelXRight == pEdgeEnd.Next.get().X.get()})
+            while ({nSubpixelXRight = pEdgeEnd.X.get(); nSubpixelXRight == activeList.Next(pEdgeEnd).X.get()})
             {
-                pEdgeStart = pEdgeEnd.Next.get();
-                pEdgeEnd = pEdgeStart.Next.get();
+                pEdgeStart = activeList.Next(pEdgeEnd);
+                pEdgeEnd = activeList.Next(pEdgeStart);
 
                 nWindingValue = pEdgeStart.WindingDirection;
                 while ({nWindingValue += pEdgeEnd.WindingDirection; nWindingValue != 0})
                 {
-                    pEdgeEnd = pEdgeEnd.Next.get();
+                    pEdgeEnd = activeList.Next(pEdgeEnd);
                 }
             }
 
@@ -511,7 +507,7 @@ pub fn FillEdgesWinding(&'a self,
 
         // Prepare for the next iteration:
 
-        pEdgeStart = pEdgeEnd.Next.get();
+        pEdgeStart = activeList.Next(pEdgeEnd);
     } 
 
 //Cleanup:
@@ -522,41 +518,44 @@ pub fn FillEdgesWinding(&'a self,
 //
 //  Function:   CCoverageBuffer::Initialize
 //
-//  Synopsis:   Set the coverage buffer to a valid initial state
+//  Synopsis:
+//      Set the coverage buffer to a valid initial state, keeping the
+//      intervals in 'rgInterval' (whose allocation is reused)
 // 
 //-------------------------------------------------------------------------
-pub fn Initialize(&'a self) 
+pub fn Initialize(&self, mut rgInterval: CTransientArray<CCoverageInterval>)
 {
-    self.m_pIntervalBufferBuiltin.m_interval[0].m_nPixelX.set(INT::MIN);
-    self.m_pIntervalBufferBuiltin.m_interval[0].m_nCoverage.set(0);
-    self.m_pIntervalBufferBuiltin.m_interval[0].m_pNext.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[1]));
+    rgInterval.clear();
+    rgInterval.reserve(INTERVAL_BUFFER_NUMBER);
 
-    self.m_pIntervalBufferBuiltin.m_interval[1].m_nPixelX.set(INT::MAX);
-    self.m_pIntervalBufferBuiltin.m_interval[1].m_nCoverage.set(0xdeadbeef);
-    self.m_pIntervalBufferBuiltin.m_interval[1].m_pNext.set(unsafe { Ref::null() });
+    rgInterval.push(CCoverageInterval {
+        m_iNext: c_iIntervalTail,
+        m_nPixelX: INT::MIN,
+        m_nCoverage: 0,
+    });
 
-    self.m_pIntervalBufferBuiltin.m_pNext.set(None);
-    self.m_pIntervalBufferCurrent.set(Ref::new(&self.m_pIntervalBufferBuiltin));
+    rgInterval.push(CCoverageInterval {
+        m_iNext: c_iIntervalNone,
+        m_nPixelX: INT::MAX,
+        m_nCoverage: 0xdeadbeef,
+    });
 
-    self.m_pIntervalStart.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[0]));
-    self.m_pIntervalNew.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[2]));
-    self.interval_new_index.set(2);
-    self.m_pIntervalEndMinus4.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[INTERVAL_BUFFER_NUMBER - 4]));
+    *self.m_rgInterval.borrow_mut() = rgInterval;
+    self.m_iIntervalCursor.set(c_iIntervalHead);
 }
 
 //-------------------------------------------------------------------------
 //
 //  Function:   CCoverageBuffer::Destroy
 //
-//  Synopsis:   Free all allocated buffers
+//  Synopsis:
+//      Hand back the interval array so that its allocation can be reused
+//      by the next coverage buffer
 // 
 //-------------------------------------------------------------------------
-pub fn Destroy(&mut self)
+pub fn Destroy(&self) -> CTransientArray<CCoverageInterval>
 {
-    // Free the linked-list of allocations (skipping 'm_pIntervalBufferBuiltin',
-    // which is built into the class):
-
-
+    return self.m_rgInterval.take();
 }
 
 
@@ -567,17 +566,16 @@ pub fn Destroy(&mut self)
 //  Synopsis:   Reset the coverage buffer
 // 
 //-------------------------------------------------------------------------
-pub fn Reset(&'a self)
+pub fn Reset(&self)
 {
     // Reset our coverage structure.  Point the head back to the tail,
-    // and reset where the next new entry will be placed:
+    // and drop everything but the sentinels:
 
-    self.m_pIntervalBufferBuiltin.m_interval[0].m_pNext.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[1]));
+    let rgInterval = &mut *self.m_rgInterval.borrow_mut();
 
-    self.m_pIntervalBufferCurrent.set(Ref::new(&self.m_pIntervalBufferBuiltin));
-    self.m_pIntervalNew.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[2]));
-    self.interval_new_index.set(2);
-    self.m_pIntervalEndMinus4.set(Ref::new(&self.m_pIntervalBufferBuiltin.m_interval[INTERVAL_BUFFER_NUMBER - 4]));
+    rgInterval[c_iIntervalHead as usize].m_iNext = c_iIntervalTail;
+    rgInterval.truncate(2);
+    self.m_iIntervalCursor.set(c_iIntervalHead);
 }
 
 //-------------------------------------------------------------------------
@@ -588,41 +586,45 @@ pub fn Reset(&'a self)
 //      Grow our interval buffer.
 //
 //-------------------------------------------------------------------------
-fn Grow(&'a self,
-    ppIntervalNew: &mut Ref<'a, CCoverageInterval<'a>>, 
-    ppIntervalEndMinus4: &mut Ref<'a, CCoverageInterval<'a>>,
-    interval_new_index: &mut usize
-    ) -> HRESULT
+fn Grow(rgInterval: &mut CTransientArray<CCoverageInterval>) -> HRESULT
 {
     let hr: HRESULT = S_OK;
-    let pIntervalBufferNew = (*self.m_pIntervalBufferCurrent.get()).m_pNext.get();
 
-    let pIntervalBufferNew = pIntervalBufferNew.unwrap_or_else(||
-    {
-        let pIntervalBufferNew = self.arena.alloc(Default::default());
+    // AddInterval inserts at most 4 intervals.  Doubling keeps the number
+    // of reallocations logarithmic in the widest scanline:
 
-        (*pIntervalBufferNew).m_pNext.set(None);
-        (*self.m_pIntervalBufferCurrent.get()).m_pNext.set(Some(pIntervalBufferNew));
-        pIntervalBufferNew
-    });
+    rgInterval.reserve(rgInterval.len().max(4));
 
-    self.m_pIntervalBufferCurrent.set(Ref::new(pIntervalBufferNew));
+    return hr;
+}
 
-    self.m_pIntervalNew.set(Ref::new(&(*pIntervalBufferNew).m_interval[2]));
-    self.interval_new_index.set(2);
-    self.m_pIntervalEndMinus4.set(Ref::new(&(*pIntervalBufferNew).m_interval[INTERVAL_BUFFER_NUMBER - 4]));
+}
 
-    *ppIntervalNew = self.m_pIntervalNew.get();
-    *ppIntervalEndMinus4 = self.m_pIntervalEndMinus4.get();
-    *interval_new_index = 2;
+//-------------------------------------------------------------------------
+//
+//  Function:   InsertIntervalAfter
+//
+//  Synopsis:
+//      Link a new interval in after 'iInterval' and return its index.  The
+//      caller has made sure there is room for it.
+//
+//-------------------------------------------------------------------------
+fn InsertIntervalAfter(
+    rgInterval: &mut CTransientArray<CCoverageInterval>,
+    iInterval: UINT,
+    nPixelX: INT,
+    nCoverage: INT
+    ) -> UINT
+{
+    debug_assert!(rgInterval.len() < rgInterval.capacity());
 
-    return hr;
-}
+    let iIntervalNew = rgInterval.len() as UINT;
+    rgInterval.push(CCoverageInterval {
+        m_iNext: rgInterval[iInterval as usize].m_iNext,
+        m_nPixelX: nPixelX,
+        m_nCoverage: nCoverage,
+    });
+    rgInterval[iInterval as usize].m_iNext = iIntervalNew;
 
+    return iIntervalNew;
 }
-/* 
-impl<'a> Drop for CCoverageBuffer<'a> {
-    fn drop(&mut self) {
-        self.Destroy();
-    }
-}*/
@@ -4,10 +4,13 @@
 
 #![allow(unused_parens)]
 
-use std::cell::Cell;
+use std::cell::{Cell, UnsafeCell};
+use std::mem::MaybeUninit;
+use std::rc::Rc;
 
 use crate::aacoverage::c_nShift;
-use crate::bezier::CMILBezier;
+use crate::allocator::{CTransientAllocator, CTransientArray};
+use crate::bezier::{vSubdivideToClip, CBezierPiece, CMILBezier};
 use crate::helpers::Int32x32To64;
 use crate::matrix::CMILMatrix;
 use crate::nullable_ref::Ref;
@@ -15,7 +18,6 @@ use crate::real::CFloatFPU;
 //use crate::types::PathPointType::*;
 use crate::types::*;
 use cfor::cfor;
-use typed_arena_nomut::Arena;
 
 const S_OK: HRESULT = 0;
 
@@ -32,8 +34,10 @@ macro_rules! INACTIVE_LIST_NUMBER { () => { 12 }; }
 #[cfg(debug_assertions)]
 macro_rules! ENUMERATE_BUFFER_NUMBER { () => { 15 }; }
 
+// The built-in edge store allocation is sized so that typical paths of a
+// couple of hundred edges are rasterized without any heap allocation.
 #[cfg(not(debug_assertions))]
-macro_rules! EDGE_STORE_STACK_NUMBER { () => { (1600 / std::mem::size_of::<CEdge>()) }; }
+macro_rules! EDGE_STORE_STACK_NUMBER { () => { (10240 / std::mem::size_of::<CEdge>()) }; }
 #[cfg(not(debug_assertions))]
 macro_rules! EDGE_STORE_ALLOCATION_NUMBER { () => { (4032 / std::mem::size_of::<CEdge>()) as u32 }; }
 #[cfg(not(debug_assertions))]
@@ -41,12 +45,21 @@ macro_rules! INACTIVE_LIST_NUMBER { () => { EDGE_STORE_STACK_NUMBER!() }; }
 #[cfg(not(debug_assertions))]
 macro_rules! ENUMERATE_BUFFER_NUMBER { () => { 32 }; }
 
+// Paths with more edges than this use CActiveEdgeArray rather than the
+// linked active edge list.  The debug value is tiny so that the tests
+// exercise both.
+#[cfg(debug_assertions)]
+macro_rules! ACTIVE_EDGE_ARRAY_THRESHOLD { () => { 4 }; }
+#[cfg(not(debug_assertions))]
+macro_rules! ACTIVE_EDGE_ARRAY_THRESHOLD { () => { 16 }; }
+
 macro_rules! ASSERTACTIVELIST {
     ($list: expr, $y: expr) => {
         #[cfg(debug_assertions)]
         AssertActiveList($list, $y);
     };
 }
+#[derive(Clone)]
 pub struct CEdge<'a> {
     pub Next: Cell<Ref<'a, CEdge<'a>>>, // Next active edge (don't check for NULL,
     //   look for tail sentinel instead)
@@ -92,6 +105,11 @@ impl<'a> Default for CInactiveEdge<'a> {
         }
     }
 }
+impl<'a> CInactiveEdge<'a> {
+    pub fn GetEdge(&self) -> Ref<'a, CEdge<'a>> {
+        self.Edge
+    }
+}
 macro_rules! ASSERTACTIVELISTORDER {
     ($list: expr) => {
         #[cfg(debug_assertions)]
@@ -220,206 +238,226 @@ macro_rules! SWAP {
     };
 }
 
-struct CEdgeAllocation {
-    Next: *mut CEdgeAllocation, // Next allocation batch (may be NULL)
-    /*__field_range(<=, EDGE_STORE_ALLOCATION_NUMBER)*/ Count: UINT,
-    EdgeArray: [CEdge<'static>; EDGE_STORE_STACK_NUMBER!()],
-}
-
-impl Default for CEdgeAllocation {
-    fn default() -> Self {
-        Self { Next: NULL(), Count: Default::default(), EdgeArray: [(); EDGE_STORE_STACK_NUMBER!()].map(|_| Default::default()) }
-    }
-}
-/* 
-pub struct CEdgeStore {
-    /* __field_range(<=, UINT_MAX - 2) */ TotalCount: UINT, // Total edge count in store
-    /* __field_range(<=, CurrentBuffer->Count) */
-    CurrentRemaining: UINT, // How much room remains in current buffer
-    CurrentBuffer: *mut CEdgeAllocation, // Current buffer
-    CurrentEdge: *mut CEdge<'static>, // Current edge in current buffer
-    Enumerator: *mut CEdgeAllocation, // For enumerating all the edges
-    EdgeHead: CEdgeAllocation, // Our built-in allocation
-}
-
-impl Default for CEdgeStore {
-    fn default() -> Self {
-        Self { TotalCount: Default::default(), CurrentRemaining: Default::default(), CurrentBuffer: NULL(), CurrentEdge: NULL(), Enumerator: NULL(), EdgeHead: Default::default() }
-    }
+/**************************************************************************\
+*
+* Class Description:
+*
+*   Edge storage with a built-in allocation for the first
+*   EDGE_STORE_STACK_NUMBER edges, so that small paths never touch the
+*   heap.  Any further edges go to blocks from the transient allocator,
+*   starting at EDGE_STORE_ALLOCATION_NUMBER edges and doubling.  A full
+*   block is never grown, so edges never move once they have been added
+*   and the references handed out stay valid for the life of the store.
+*
+*   A store made with_device takes the blocks kept in the device's buffer
+*   dispenser and hands them back emptied when it is dropped, so paths of
+*   the same size stop allocating after the first one.
+*
+*   FixedPointPathEnumerateInParallel builds edges on other threads into
+*   stores made with_thread_blocks, which only use blocks.  The blocks are
+*   then adopted by the context's store without moving the edges, and
+*   come after its own edges.
+*
+\**************************************************************************/
+pub struct CEdgeStore<'a> {
+    EdgeHead: UnsafeCell<[MaybeUninit<CEdge<'a>>; EDGE_STORE_STACK_NUMBER!()]>, // Our built-in allocation
+    HeadCount: Cell<usize>,                 // Edges used in the built-in allocation
+    HeadLimit: usize,                       // Edges allowed in the built-in allocation
+    Overflow: UnsafeCell<CEdgeBlocks>,      // Blocks past the built-in allocation
+    OverflowCount: Cell<usize>,             // Edges in all the blocks
 }
 
-impl CEdgeStore {
-    pub fn init(&mut self) {
-        self.TotalCount = 0;
-        self.CurrentBuffer = NULL();
-        self.CurrentEdge = NULL();
-        self.Enumerator = NULL();
-        self.CurrentRemaining = EDGE_STORE_STACK_NUMBER!() as u32;
-
-        self.EdgeHead = CEdgeAllocation {
-                Count: EDGE_STORE_STACK_NUMBER!() as u32,
-                // hack to work around limited Default implementation for arrays
-                EdgeArray: [(); EDGE_STORE_STACK_NUMBER!()].map(|_| Default::default()),
-                Next: NULL(),
-            };
-        self.CurrentBuffer = &mut self.EdgeHead;
-        self.CurrentEdge = &mut self.EdgeHead.EdgeArray[0];
-    }
+// The blocks are typed with a 'static lifetime so that dropping them
+// doesn't need the store's 'a to be alive; edges have nothing to drop.
+pub type CEdgeBlockArray = CTransientArray<CTransientArray<CEdge<'static>>>;
+
+struct CEdgeBlocks {
+    m_rgBlock: CEdgeBlockArray,
+    m_cUsed: usize,                             // Blocks holding edges; the rest are empty
+    // One block array per edge building thread.  The first m_cAdopted
+    // hold edges, the rest are kept empty for the threads of the next path.
+    m_rgThreadBlocks: CTransientArray<CEdgeBlockArray>,
+    m_cAdopted: usize,
+    m_pDevice: Option<Rc<CD3DDeviceLevel1>>,    // Gets the blocks back on drop
 }
 
-impl Drop for CEdgeStore {
+impl Drop for CEdgeBlocks {
     fn drop(&mut self) {
-        // Free our allocation list, skipping the head, which is not
-        // dynamically allocated:
-
-        let mut allocation: *mut CEdgeAllocation = self.EdgeHead.Next;
-        while (allocation != NULL()) {
-            let next = unsafe { (*allocation).Next };
-            drop(unsafe { Box::from_raw(allocation) });
-            allocation = next;
+        if let Some(pDevice) = self.m_pDevice.take() {
+            for block in self.m_rgBlock.iter_mut() {
+                block.clear();
+            }
+            for rgBlock in self.m_rgThreadBlocks.iter_mut() {
+                for block in rgBlock.iter_mut() {
+                    block.clear();
+                }
+            }
+            pDevice.ReleaseEdgeBlocks(std::mem::take(&mut self.m_rgBlock), std::mem::take(&mut self.m_rgThreadBlocks));
         }
     }
 }
 
-impl CEdgeStore {
-    pub fn StartEnumeration(&mut self) -> UINT {
-        unsafe {
-            self.Enumerator = &mut self.EdgeHead;
-
-            // Update the count and make sure nothing more gets added (in
-            // part because this Count would have to be re-computed):
-
-            (*self.CurrentBuffer).Count -= self.CurrentRemaining;
-
-            // This will never overflow because NextAddBuffer always ensures that TotalCount has
-            // space remaining to describe the capacity of all new buffers added to the edge list.
-            self.TotalCount += (*self.CurrentBuffer).Count;
-
-            // Prevent this from being called again, because bad things would
-            // happen:
+// Edge blocks on their way to or from an edge building thread.  The edges
+// in them are not linked to anything, and the transient allocator may be
+// called from those threads (see PathBuilder::set_allocator).
+pub struct CThreadEdgeBlocks(CEdgeBlockArray);
 
-            self.CurrentBuffer = NULL();
+unsafe impl Send for CThreadEdgeBlocks {}
 
-            return self.TotalCount;
-        }
+impl CThreadEdgeBlocks {
+    pub fn into_inner(self) -> CEdgeBlockArray {
+        self.0
     }
+}
 
-    fn Enumerate(
-        &mut self,
-        /*__deref_out_ecount(*ppEndEdge - *ppStartEdge)*/ ppStartEdge: &mut *mut CEdge,
-        /* __deref_out_ecount(0) */ ppEndEdge: &mut *mut CEdge,
-    ) -> bool {
-        /* 
-        unsafe {
-            let enumerator: *mut CEdgeAllocation = self.Enumerator;
-
-            // Might return startEdge == endEdge:
-
-            *ppStartEdge = &mut (*enumerator).EdgeArray[0];
-            *ppEndEdge = (*ppStartEdge).offset((*enumerator).Count as isize);
-
-            self.Enumerator = (*enumerator).Next;
-            return (self.Enumerator != NULL());
-        }*/
-        return true;
+impl<'a> CEdgeStore<'a> {
+    pub fn new() -> Self {
+        Self::with_allocator(Default::default())
     }
 
-    fn StartAddBuffer(
-        &self,
-        /*__deref_out_ecount(*puRemaining)*/ ppCurrentEdge: &mut *mut CEdge,
-        /* __deref_out_range(==, (this->CurrentRemaining)) */ puRemaining: &mut UINT,
-    ) {
-        panic!()
-        // *ppCurrentEdge = self.CurrentEdge;
-        // *puRemaining = self.CurrentRemaining;
+    pub fn with_allocator(allocator: CTransientAllocator) -> Self {
+        Self::with_blocks(CTransientArray::new(allocator), CTransientArray::new(allocator), None, EDGE_STORE_STACK_NUMBER!())
     }
 
-    fn EndAddBuffer(
-        &mut self,
-        /*__in_ecount(remaining) */ pCurrentEdge: *mut CEdge,
-        /* __range(0, (this->CurrentBuffer->Count)) */ remaining: UINT,
-    ) {
-        panic!();
-        //self.CurrentEdge = pCurrentEdge;
-        //self.CurrentRemaining = remaining;
+    pub fn with_device(pDevice: Rc<CD3DDeviceLevel1>) -> Self {
+        let (rgBlock, rgThreadBlocks) = pDevice.GetEdgeBlocks();
+        Self::with_blocks(rgBlock, rgThreadBlocks, Some(pDevice), EDGE_STORE_STACK_NUMBER!())
     }
 
-    // Disable instrumentation checks within all methods of this class
-    //SET_MILINSTRUMENTATION_FLAGS(MILINSTRUMENTATIONFLAGS_DONOTHING);
-}
-
-/**************************************************************************\
-*
-* Function Description:
-*
-*   The edge initializer is out of room in its current 'store' buffer;
-*   get it a new one.
-*
-* Created:
-*
-*   03/25/2000 andrewgo
-*
-\**************************************************************************/
-
-impl CEdgeStore {
-    fn NextAddBuffer(
-        &mut self,
-        /*__deref_out_ecount(*puRemaining)*/ ppCurrentEdge: &mut *mut CEdge,
-        puRemaining: &mut UINT,
-    ) -> HRESULT {
-        panic!()
-        /* 
-        unsafe {
-            let hr = S_OK;
-
-            let mut cNewTotalCount: u32 = 0;
-
-            // The caller has completely filled up this chunk:
-
-            assert!(*puRemaining == 0);
+    // A store for an edge building thread.  It skips the built-in
+    // allocation so that all of its edges can be adopted with its blocks.
+    pub fn with_thread_blocks(rgBlock: CEdgeBlockArray) -> Self {
+        let allocator = rgBlock.GetAllocator();
+        Self::with_blocks(rgBlock, CTransientArray::new(allocator), None, 0)
+    }
 
-            // Check to make sure that "TotalCount" will be able to represent the current capacity
-            cNewTotalCount = self.TotalCount + (*self.CurrentBuffer).Count;
+    fn with_blocks(
+        rgBlock: CEdgeBlockArray,
+        rgThreadBlocks: CTransientArray<CEdgeBlockArray>,
+        pDevice: Option<Rc<CD3DDeviceLevel1>>,
+        cHeadLimit: usize
+    ) -> Self {
+        debug_assert!(rgBlock.iter().all(|block| block.is_empty()));
+        Self {
+            // An array of MaybeUninit needs no initialization
+            EdgeHead: UnsafeCell::new(unsafe { MaybeUninit::uninit().assume_init() }),
+            HeadCount: Cell::new(0),
+            HeadLimit: cHeadLimit,
+            Overflow: UnsafeCell::new(CEdgeBlocks {
+                m_rgBlock: rgBlock,
+                m_cUsed: 0,
+                m_rgThreadBlocks: rgThreadBlocks,
+                m_cAdopted: 0,
+                m_pDevice: pDevice,
+            }),
+            OverflowCount: Cell::new(0),
+        }
+    }
 
-            if (cNewTotalCount < self.TotalCount) {
-                return WINCODEC_ERR_VALUEOVERFLOW;
+    pub fn alloc(&self, edge: CEdge<'a>) -> &CEdge<'a> {
+        let count = self.HeadCount.get();
+        if (count < self.HeadLimit) {
+            self.HeadCount.set(count + 1);
+
+            // Go through a raw pointer so that we never form a reference
+            // to the whole array while earlier edges are borrowed:
+            unsafe {
+                let slot = (self.EdgeHead.get() as *mut CEdge<'a>).add(count);
+                slot.write(edge);
+                &*slot
             }
-
-            // And that it can represent the new capacity as well, with at least 2 to spare.
-            // This "magic" 2 comes from the fact that the usage pattern of this class has callers
-            // needing to allocate space for TotalCount + 2 edges.
-            if (cNewTotalCount + ((EDGE_STORE_ALLOCATION_NUMBER!() + 2) as UINT) < cNewTotalCount) {
-                return WINCODEC_ERR_VALUEOVERFLOW;
+        } else {
+            self.OverflowCount.set(self.OverflowCount.get() + 1);
+
+            // Only the block headers are touched here, never the edges
+            // handed out before:
+            unsafe {
+                let blocks = &mut *self.Overflow.get();
+                // Adopted edges must stay after our own
+                debug_assert!(blocks.m_cAdopted == 0);
+                let rgBlock = &mut blocks.m_rgBlock;
+                let cUsed = blocks.m_cUsed;
+                if (cUsed == 0 || rgBlock[cUsed - 1].len() == rgBlock[cUsed - 1].capacity()) {
+                    // Move on to the next block, allocating it unless an
+                    // earlier store left one behind
+                    if (cUsed == rgBlock.len()) {
+                        let cEdges = if (cUsed == 0) { EDGE_STORE_ALLOCATION_NUMBER!() as usize } else { rgBlock[cUsed - 1].capacity() * 2 };
+                        let allocator = rgBlock.GetAllocator();
+                        rgBlock.push(CTransientArray::with_capacity(allocator, cEdges));
+                    }
+                    blocks.m_cUsed = cUsed + 1;
+                }
+                let block = &mut rgBlock[blocks.m_cUsed - 1];
+                let count = block.len();
+                let slot = (block.as_mut_ptr() as *mut CEdge<'a>).add(count);
+                slot.write(edge);
+                block.set_len(count + 1);
+                &*slot
             }
+        }
+    }
 
-            // We have to grow our data structure by adding a new buffer
-            // and adding it to the list:
-
-            let newBuffer: *mut CEdgeAllocation = Box::into_raw(Box::<CEdgeAllocation>::new(Default::default()));/*static_cast<CEdgeAllocation*>
-                                                            (GpMalloc(Mt(MAARasterizerEdge),
-                                                                      sizeof(CEdgeAllocation) +
-                                                                      sizeof(CEdge) * (EDGE_STORE_ALLOCATION_NUMBER
-                                                                                      - EDGE_STORE_STACK_NUMBER)));*/
-            IFCOOM!(newBuffer);
-
-            (*newBuffer).Next = NULL();
-            (*newBuffer).Count = EDGE_STORE_STACK_NUMBER!() as u32;//EDGE_STORE_ALLOCATION_NUMBER!() as u32;
+    pub fn len(&self) -> usize {
+        self.HeadCount.get() + self.OverflowCount.get()
+    }
 
-            self.TotalCount = cNewTotalCount;
+    // The blocks for edge building thread 'iThread', reusing the ones an
+    // earlier path's thread left behind
+    pub fn TakeThreadBlocks(&self, iThread: usize) -> CThreadEdgeBlocks {
+        let blocks = unsafe { &mut *self.Overflow.get() };
+        debug_assert!(blocks.m_cAdopted == 0);
+        let allocator = blocks.m_rgThreadBlocks.GetAllocator();
+        if (iThread < blocks.m_rgThreadBlocks.len()) {
+            CThreadEdgeBlocks(std::mem::replace(&mut blocks.m_rgThreadBlocks[iThread], CTransientArray::new(allocator)))
+        } else {
+            CThreadEdgeBlocks(CTransientArray::new(allocator))
+        }
+    }
 
-            (*self.CurrentBuffer).Next = newBuffer;
-            self.CurrentBuffer = newBuffer;
+    // Add the edges of a thread's store after the ones already here.
+    // Threads are adopted in order.
+    pub fn AdoptThreadBlocks(&self, rgBlock: CThreadEdgeBlocks) {
+        let rgBlock = rgBlock.into_inner();
+        let blocks = unsafe { &mut *self.Overflow.get() };
+        let cEdges: usize = rgBlock.iter().map(|block| block.len()).sum();
+        let iThread = blocks.m_cAdopted;
+        if (iThread < blocks.m_rgThreadBlocks.len()) {
+            blocks.m_rgThreadBlocks[iThread] = rgBlock;
+        } else {
+            blocks.m_rgThreadBlocks.push(rgBlock);
+        }
+        blocks.m_cAdopted = iThread + 1;
+        self.OverflowCount.set(self.OverflowCount.get() + cEdges);
+    }
 
-            self.CurrentEdge = &mut (*newBuffer).EdgeArray[0];
-            *ppCurrentEdge = panic!();//self.CurrentEdge;
-            self.CurrentRemaining = EDGE_STORE_STACK_NUMBER!() as u32;//EDGE_STORE_ALLOCATION_NUMBER!();
-            *puRemaining = EDGE_STORE_STACK_NUMBER!() as u32; //EDGE_STORE_ALLOCATION_NUMBER!();
+    // Hand this store's blocks to the thread that adopts them.  The caller
+    // makes sure that none of the edges are borrowed any more.
+    pub unsafe fn TakeBlocks(&self) -> CThreadEdgeBlocks {
+        debug_assert!(self.HeadCount.get() == 0);
+        let blocks = &mut *self.Overflow.get();
+        let allocator = blocks.m_rgBlock.GetAllocator();
+        self.OverflowCount.set(0);
+        blocks.m_cUsed = 0;
+        CThreadEdgeBlocks(std::mem::replace(&mut blocks.m_rgBlock, CTransientArray::new(allocator)))
+    }
 
-            return hr;
-        }*/
+    pub fn iter(&self) -> impl Iterator<Item = &CEdge<'a>> {
+        let head = unsafe {
+            std::slice::from_raw_parts(self.EdgeHead.get() as *const CEdge<'a>, self.HeadCount.get())
+        };
+        let (cBlocks, cAdopted) = unsafe { ((*self.Overflow.get()).m_cUsed, (*self.Overflow.get()).m_cAdopted) };
+        let edges = |block: &CTransientArray<CEdge<'static>>| -> &[CEdge<'a>] {
+            unsafe { std::slice::from_raw_parts(block.as_ptr() as *const CEdge<'a>, block.len()) }
+        };
+        head.iter().chain((0..cBlocks).flat_map(move |iBlock| {
+            let rgBlock = unsafe { &(*self.Overflow.get()).m_rgBlock };
+            edges(&rgBlock[iBlock]).iter()
+        })).chain((0..cAdopted).flat_map(move |iThread| {
+            let rgBlock = unsafe { &(&(*self.Overflow.get()).m_rgThreadBlocks)[iThread] };
+            rgBlock.iter().flat_map(move |block| edges(block).iter())
+        }))
     }
 }
-*/
 /**************************************************************************\
 *
 * Function Description:
@@ -432,8 +470,9 @@ impl CEdgeStore {
 *
 \**************************************************************************/
 
-pub fn AssertActiveList(mut list: Ref<CEdge>, yCurrent: INT) -> bool {
+pub fn AssertActiveList<'a>(activeList: &impl IActiveEdgeList<'a>, yCurrent: INT) -> bool {
 
+    let mut list = activeList.Head();
     let mut b = true;
     let mut activeCount = 0;
 
@@ -442,20 +481,20 @@ pub fn AssertActiveList(mut list: Ref<CEdge>, yCurrent: INT) -> bool {
 
     // Skip the head sentinel:
 
-    list = (*list).Next.get();
+    list = activeList.Next(list);
 
     while ((*list).X.get() != INT::MAX) {
         assert!((*list).X.get() != INT::MIN);
         b &= ((*list).X.get() != INT::MIN);
 
-        assert!((*list).X <= (*(*list).Next.get()).X);
-        b &= ((*list).X <= (*(*list).Next.get()).X);
+        assert!((*list).X <= (*activeList.Next(list)).X);
+        b &= ((*list).X <= (*activeList.Next(list)).X);
 
         assert!(((*list).StartY <= yCurrent) && (yCurrent < (*list).EndY));
         b &= (((*list).StartY <= yCurrent) && (yCurrent < (*list).EndY));
 
         activeCount += 1;
-        list = (*list).Next.get();
+        list = activeList.Next(list);
     }
 
     assert!((*list).X.get() == INT::MAX);
@@ -525,7 +564,7 @@ fn AssertActiveListOrder(mut list:  Ref<CEdge>) {
 *   03/25/2000 andrewgo
 *
 \**************************************************************************/
-fn ClipEdge(edgeBuffer: &mut CEdge, yClipTopInteger: INT, dMOriginal: INT) {
+pub fn ClipEdge(edgeBuffer: &mut CEdge, yClipTopInteger: INT, dMOriginal: INT) {
     let mut xDelta: INT;
     let mut error: INT;
 
@@ -564,7 +603,7 @@ fn ClipEdge(edgeBuffer: &mut CEdge, yClipTopInteger: INT, dMOriginal: INT) {
 //      information.
 //
 //------------------------------------------------------------------------------
-fn TransformRasterizerPointsTo28_4(
+pub fn TransformRasterizerPointsTo28_4(
     pmat: &CMILMatrix,
     // Transform to take us to 28.4
     mut pPtsSource: &[MilPoint2F],
@@ -595,40 +634,73 @@ fn TransformRasterizerPointsTo28_4(
     let rPixelCoordinateMax = (1 << (26 - c_nShift)) as f32;
     let rPixelCoordinateMin = -rPixelCoordinateMax;
 
-    while {
-        //
-        // Transform coordinates
-        //
+    //
+    // Work on blocks of points.  Transforming and range checking a block
+    // has no branches and the check is folded into a single test, so the
+    // compiler can use packed instructions.  Full blocks are rounded with
+    // CFloatFPU::RoundSlice, which picks the best kernel for the CPU, and
+    // shorter ones inline with MediumRound, where the dispatch would cost
+    // more than it saves.  Both give the same results as CFloatFPU::Round
+    // within the range checked here.
+    //
 
-        let rPixelX =
-            (pmat.GetM11() * pPtsSource[0].X) + (pmat.GetM21() * pPtsSource[0].Y) + pmat.GetDx();
-        let rPixelY =
-            (pmat.GetM12() * pPtsSource[0].X) + (pmat.GetM22() * pPtsSource[0].Y) + pmat.GetDy();
+    const c_nPointBlock: usize = 32;
 
-        //
-        // Check for NaNs or overflow
-        //
+    let (rM11, rM21, rDx) = (pmat.GetM11(), pmat.GetM21(), pmat.GetDx());
+    let (rM12, rM22, rDy) = (pmat.GetM12(), pmat.GetM22(), pmat.GetDy());
+    let mut rgrPixel = [0.; 2 * c_nPointBlock];
+    let mut rgnPixel = [0; 2 * c_nPointBlock];
 
-        if (!(rPixelX <= rPixelCoordinateMax
-            && rPixelX >= rPixelCoordinateMin
-            && rPixelY <= rPixelCoordinateMax
-            && rPixelY >= rPixelCoordinateMin))
+    while (cPoints > 0)
+    {
+        let cBlock = (cPoints as usize).min(c_nPointBlock);
+        let mut fInRange = true;
+
+        for (rgrPixelXY, pt) in rgrPixel[..2 * cBlock].chunks_exact_mut(2).zip(&pPtsSource[..cBlock])
+        {
+            let rPixelX = (rM11 * pt.X) + (rM21 * pt.Y) + rDx;
+            let rPixelY = (rM12 * pt.X) + (rM22 * pt.Y) + rDy;
+
+            //
+            // Check for NaNs or overflow
+            //
+
+            fInRange &= (rPixelX <= rPixelCoordinateMax)
+                & (rPixelX >= rPixelCoordinateMin)
+                & (rPixelY <= rPixelCoordinateMax)
+                & (rPixelY >= rPixelCoordinateMin);
+
+            rgrPixelXY[0] = rPixelX;
+            rgrPixelXY[1] = rPixelY;
+        }
+
+        if (!fInRange)
         {
             return WGXERR_BADNUMBER;
         }
 
-        //
-        // Assign coordinates
-        //
+        if (cBlock == c_nPointBlock)
+        {
+            CFloatFPU::RoundSlice(&rgrPixel, &mut rgnPixel);
+        }
+        else
+        {
+            for (n, &r) in rgnPixel[..2 * cBlock].iter_mut().zip(&rgrPixel[..2 * cBlock])
+            {
+                *n = CFloatFPU::MediumRound(r);
+            }
+        }
 
-        pPtsDest[0].x = CFloatFPU::Round(rPixelX);
-        pPtsDest[0].y = CFloatFPU::Round(rPixelY);
+        for (ptDest, rgnPixelXY) in pPtsDest[..cBlock].iter_mut().zip(rgnPixel.chunks_exact(2))
+        {
+            ptDest.x = rgnPixelXY[0];
+            ptDest.y = rgnPixelXY[1];
+        }
 
-        pPtsDest = &mut pPtsDest[1..];
-        pPtsSource = &pPtsSource[1..];
-        cPoints -= 1;
-        cPoints != 0
-    } {}
+        pPtsDest = &mut pPtsDest[cBlock..];
+        pPtsSource = &pPtsSource[cBlock..];
+        cPoints -= cBlock as UINT;
+    }
 
     return hr;
 }
@@ -658,17 +730,19 @@ pub struct CInitializeEdgesContext<'a> {
     pub MaxY: INT, // Maximum 'y' found, should be INT_MIN on
     //   first call to 'InitializeEdges'
     pub ClipRect: Option<&'a RECT>, // Bounding clip rectangle in 28.4 format
-    pub Store: &'a Arena<CEdge<'a>>,  // Where to stick the edges
+    pub Store: &'a CEdgeStore<'a>,  // Where to stick the edges
     pub AntiAliasMode: MilAntiAliasMode,
+    pub SimplifyTolerance: INT, // Distance in 28.4 that FixedPointPathEnumerate may
+    //   move the path by dropping vertices, 0 to keep them all
 }
 
 impl<'a> CInitializeEdgesContext<'a> {
-    pub fn new(store: &'a Arena<CEdge<'a>>) -> Self {
-        CInitializeEdgesContext { MaxY: Default::default(), ClipRect: Default::default(), Store: store, AntiAliasMode: MilAntiAliasMode::None }
+    pub fn new(store: &'a CEdgeStore<'a>) -> Self {
+        CInitializeEdgesContext { MaxY: Default::default(), ClipRect: Default::default(), Store: store, AntiAliasMode: MilAntiAliasMode::None, SimplifyTolerance: 0 }
     }
 }
 
-fn InitializeEdges(
+pub fn InitializeEdges(
     pEdgeContext: &mut CInitializeEdgesContext,
     /*__inout_ecount(vertexCount)*/
     mut pointArray: &mut [POINT], // Points to a 28.4 array of size 'vertexCount'
@@ -768,6 +842,9 @@ fn InitializeEdges(
     //store.StartAddBuffer(&mut edgeBuffer, &mut bufferCount);
 
     'outer: loop { loop { 
+        let mut xPoint0 = (pointArray[0]).x;
+        let mut xPoint1 = (pointArray[1]).x;
+
         // Handle trivial rejection:
 
         if (yClipBottom >= 0) {
@@ -848,15 +925,33 @@ fn InitializeEdges(
                     break; // ======================>
                 }
             }
+
+            // What's left of a run to one side of the clipping (the last
+            // edge, or the chord the code above collapsed it to) only
+            // matters for its winding, which doesn't depend on its 'x'
+            // inside the clipping.  So we make it vertical, right on the
+            // clip boundary: its DDA then never moves, it can't cross any
+            // other such edge and force a sort, and the spans it bounds
+            // stop at the clipping instead of running outside it.  The
+            // edge can't just be dropped on the right, because both fill
+            // rules rely on every span being closed by an edge.
+
+            if ((xPoint0 <= xClipLeft) && (xPoint1 <= xClipLeft)) {
+                xPoint0 = xClipLeft;
+                xPoint1 = xClipLeft;
+            } else if ((xPoint0 >= xClipRight) && (xPoint1 >= xClipRight)) {
+                xPoint0 = xClipRight;
+                xPoint1 = xClipRight;
+            }
         }
 
-        dM = (pointArray[1]).x - (pointArray[0]).x;
+        dM = xPoint1 - xPoint0;
         dN = (pointArray[1]).y - (pointArray[0]).y;
 
         if (dN >= 0) {
             // The vector points downward:
 
-            xStart = (pointArray[0]).x;
+            xStart = xPoint0;
             yStart = (pointArray[0]).y;
 
             yStartInteger = (yStart + 15) >> 4;
@@ -870,7 +965,7 @@ fn InitializeEdges(
             dN = -dN;
             dM = -dM;
 
-            xStart = (pointArray[1]).x;
+            xStart = xPoint1;
             yStart = (pointArray[1]).y;
 
             yStartInteger = (yStart + 15) >> 4;
@@ -1010,7 +1105,7 @@ fn InitializeEdges(
 *   03/25/2000 andrewgo
 *
 \**************************************************************************/
-fn ValidatePathTypes(typesArray: &[BYTE], mut count: INT) -> bool {
+pub fn ValidatePathTypes(typesArray: &[BYTE], mut count: INT) -> bool {
     let mut types = typesArray;
 
     if (count == 0) {
@@ -1137,6 +1232,75 @@ fn AssertPath(rgTypes: &[BYTE], cPoints: UINT) {
     assert!(ValidatePathTypes(rgTypes, cPoints as INT));
 }
 
+/**************************************************************************\
+*
+* Function Description:
+*
+*   Drop the vertices of a 28.4 polyline that lie within 'tolerance' of
+*   the segment that replaces them, compacting the kept vertices to the
+*   front of the array.  Runs of near-collinear segments collapse to one
+*   segment and vertices closer together than 'tolerance' merge.  The
+*   first and last vertices are always kept.
+*
+*   This is a greedy pass: each kept vertex is followed by the furthest
+*   vertex that every skipped vertex in between stays close to, so no
+*   original vertex ends up more than 'tolerance' from the result.
+*
+*   Returns the number of vertices kept.
+*
+\**************************************************************************/
+
+pub fn SimplifyPolyline(
+    rgpt: &mut [POINT],
+    cPoints: usize,
+    tolerance: INT
+) -> usize {
+    if (tolerance <= 0 || cPoints <= 2) {
+        return cPoints;
+    }
+
+    let rTolerance2 = (tolerance as f64) * (tolerance as f64);
+
+    // Is 'q' within the tolerance of the segment from 'a' to 'b'?
+
+    let IsClose = |a: POINT, b: POINT, q: POINT| -> bool {
+        let (dx, dy) = ((b.x - a.x) as f64, (b.y - a.y) as f64);
+        let (vx, vy) = ((q.x - a.x) as f64, (q.y - a.y) as f64);
+        let rLength2 = dx * dx + dy * dy;
+        let rDot = vx * dx + vy * dy;
+        if (rDot <= 0. || rLength2 == 0.) {
+            vx * vx + vy * vy <= rTolerance2
+        } else if (rDot >= rLength2) {
+            let (wx, wy) = ((q.x - b.x) as f64, (q.y - b.y) as f64);
+            wx * wx + wy * wy <= rTolerance2
+        } else {
+            let rCross = vx * dy - vy * dx;
+            rCross * rCross <= rTolerance2 * rLength2
+        }
+    };
+
+    // 'cKept - 1' is the last kept vertex; the vertices from 'iSkipped'
+    // up to the candidate 'i' have been dropped so far.  Kept vertices
+    // are only ever written behind 'iSkipped', so the dropped vertices
+    // stay intact for checking.
+
+    let mut cKept = 1;
+    let mut iSkipped = 1;
+
+    for i in 2..cPoints {
+        let ptAnchor = rgpt[cKept - 1];
+        let ptCandidate = rgpt[i];
+        if (!(iSkipped..i).all(|j| IsClose(ptAnchor, ptCandidate, rgpt[j]))) {
+            rgpt[cKept] = rgpt[i - 1];
+            cKept += 1;
+            iSkipped = i;
+        }
+    }
+
+    rgpt[cKept] = rgpt[cPoints - 1];
+    cKept + 1
+}
+
 //+----------------------------------------------------------------------------
 //
 //  Member:
@@ -1159,6 +1323,10 @@ fn AssertPath(rgTypes: &[BYTE], cPoints: UINT) {
 //      the name to be a reminder that this function has been written to be
 //      more general than would otherwise be evident.
 //
+//      If the context has a SimplifyTolerance, each batch is run through
+//      SimplifyPolyline before its edges are built.  Batch boundaries are
+//      always kept.
+//
 
 pub fn FixedPointPathEnumerate(
     rgpt: &[MilPoint2F],
@@ -1171,6 +1339,7 @@ pub fn FixedPointPathEnumerate(
     let hr = S_OK;
     let mut bufferStart: [POINT; ENUMERATE_BUFFER_NUMBER!()] = [(); ENUMERATE_BUFFER_NUMBER!()].map(|_| Default::default());
     let mut bezierBuffer: [POINT; 4] = Default::default();
+    let mut rgBezierPiece: Vec<CBezierPiece> = Vec::new();
     let mut buffer: &mut [POINT];
     let mut bufferSize: usize;
     let mut startFigure: [POINT; 1] = Default::default();
@@ -1257,10 +1426,15 @@ pub fn FixedPointPathEnumerate(
 
                     xLast = bufferStart[ENUMERATE_BUFFER_NUMBER!() - 1].x;
                     yLast = bufferStart[ENUMERATE_BUFFER_NUMBER!() - 1].y;
+                    let cBatch = SimplifyPolyline(
+                        &mut bufferStart,
+                        ENUMERATE_BUFFER_NUMBER!(),
+                        enumerateContext.SimplifyTolerance
+                    );
                     IFR!(InitializeEdges(
                         enumerateContext,
                         &mut bufferStart,
-                        ENUMERATE_BUFFER_NUMBER!()
+                        cBatch as UINT
                     ));
 
                     // Continue the last vertex as the first in the new batch:
@@ -1290,40 +1464,66 @@ pub fn FixedPointPathEnumerate(
 
                 iStart += 3;
 
-                // Process the Bezier:
+                // Split off the parts of the Bezier that can't be seen, so
+                // only the rest gets flattened:
 
-                let mut bezier = CMILBezier::new(&bezierBuffer, clipRect);
-                loop {
-                    thisCount = bezier.Flatten(buffer, &mut isMore) as usize;
+                rgBezierPiece.clear();
+                match clipRect {
+                    Some(rcfxClip) => vSubdivideToClip(&bezierBuffer, rcfxClip, &mut rgBezierPiece),
+                    None => rgBezierPiece.push(CBezierPiece::Curve(bezierBuffer)),
+                }
 
-                    __analysis_assume!(
-                        buffer + bufferSize == bufferStart + ENUMERATE_BUFFER_NUMBER!()
-                    );
-                    assert!(buffer.as_ptr().wrapping_offset(bufferSize as isize) == bufferStartPtr.wrapping_offset(ENUMERATE_BUFFER_NUMBER!()));
+                // Process the pieces:
+
+                for piece in &rgBezierPiece {
+                    let (mut bezier, ptfxEnd) = match piece {
+                        CBezierPiece::Curve(aptfx) => (Some(CMILBezier::new(aptfx, clipRect)), aptfx[3]),
+                        &CBezierPiece::Line(ptfxEnd) => (None, ptfxEnd),
+                    };
+                    loop {
+                        thisCount = match &mut bezier {
+                            Some(bezier) => bezier.Flatten(buffer, &mut isMore) as usize,
+                            None => {
+                                buffer[0] = ptfxEnd;
+                                isMore = false;
+                                1
+                            }
+                        };
+
+                        __analysis_assume!(
+                            buffer + bufferSize == bufferStart + ENUMERATE_BUFFER_NUMBER!()
+                        );
+                        assert!(buffer.as_ptr().wrapping_offset(bufferSize as isize) == bufferStartPtr.wrapping_offset(ENUMERATE_BUFFER_NUMBER!()));
+
+                        buffer = &mut buffer[thisCount..];
+                        bufferSize -= thisCount;
+
+                        if (bufferSize > 0) {
+                            break;
+                        }
+
+                        xLast = bufferStart[ENUMERATE_BUFFER_NUMBER!() - 1].x;
+                        yLast = bufferStart[ENUMERATE_BUFFER_NUMBER!() - 1].y;
+                        let cBatch = SimplifyPolyline(
+                            &mut bufferStart,
+                            ENUMERATE_BUFFER_NUMBER!(),
+                            enumerateContext.SimplifyTolerance
+                        );
+                        IFR!(InitializeEdges(
+                            enumerateContext,
+                            &mut bufferStart,
+                            cBatch as UINT
+                        ));
 
-                    buffer = &mut buffer[thisCount..];
-                    bufferSize -= thisCount;
+                        // Continue the last vertex as the first in the new batch:
 
-                    if (bufferSize > 0) {
-                        break;
-                    }
-
-                    xLast = bufferStart[ENUMERATE_BUFFER_NUMBER!() - 1].x;
-                    yLast = bufferStart[ENUMERATE_BUFFER_NUMBER!() - 1].y;
-                    IFR!(InitializeEdges(
-                        enumerateContext,
-                        &mut bufferStart,
-                        ENUMERATE_BUFFER_NUMBER!()
-                    ));
-
-                    // Continue the last vertex as the first in the new batch:
-
-                    bufferStart[0].x = xLast;
-                    bufferStart[0].y = yLast;
-                    buffer = &mut bufferStart[1..];
-                    bufferSize = ENUMERATE_BUFFER_NUMBER!() - 1;
-                    if !isMore {
-                        break;
+                        bufferStart[0].x = xLast;
+                        bufferStart[0].y = yLast;
+                        buffer = &mut bufferStart[1..];
+                        bufferSize = ENUMERATE_BUFFER_NUMBER!() - 1;
+                        if !isMore {
+                            break;
+                        }
                     }
                 }
             }
@@ -1352,10 +1552,15 @@ pub fn FixedPointPathEnumerate(
 
         let verticesInBatch = ENUMERATE_BUFFER_NUMBER!() - bufferSize;
         if (verticesInBatch > 1) {
+            let cBatch = SimplifyPolyline(
+                &mut bufferStart,
+                verticesInBatch,
+                enumerateContext.SimplifyTolerance
+            );
             IFR!(InitializeEdges(
                 enumerateContext,
                 &mut bufferStart,
-                (verticesInBatch) as UINT
+                cBatch as UINT
             ));
         }
     }
@@ -1363,6 +1568,109 @@ pub fn FixedPointPathEnumerate(
     return hr;
 }
 
+// Subpaths are only split between threads if each thread gets at least
+// this many points, otherwise starting the threads costs more than it saves.
+pub const PARALLEL_ENUMERATE_POINT_MIN: usize = 2048;
+
+//+----------------------------------------------------------------------------
+//
+//  Member:
+//      FixedPointPathEnumerateInParallel
+//
+//  Synopsis:
+//
+//      FixedPointPathEnumerate on up to 'cThreads' threads.  The subpaths
+//      are split into contiguous groups of about the same number of points
+//      and each group is enumerated into its own edge store, whose blocks
+//      come from the context's store and use its allocator.  The context's
+//      store then adopts the blocks group by group, without copying the
+//      edges.
+//
+//      Each subpath starts a new batch, so the edges of a subpath don't
+//      depend on the ones before it and the store ends up with the edges
+//      in the order FixedPointPathEnumerate would leave them.  If a group
+//      fails, the error of the first failing group is returned, as the
+//      sequential enumeration would.
+//
+
+pub fn FixedPointPathEnumerateInParallel(
+    rgpt: &[MilPoint2F],
+    rgTypes: &[BYTE],
+    cPoints: UINT,
+    matrix: &CMILMatrix,
+    clipRect: Option<&RECT>, // In scaled 28.4 format
+    enumerateContext: &mut CInitializeEdgesContext,
+    cThreads: usize,
+) -> HRESULT {
+    let hr = S_OK;
+    let cThreads = cThreads.min(cPoints as usize / PARALLEL_ENUMERATE_POINT_MIN);
+
+    // Split at the first subpath start past each thread's share of points:
+
+    let mut rgiGroupStart: Vec<usize> = vec![0];
+    for i in 1..cThreads {
+        let iShare = (cPoints as usize * i / cThreads).max(rgiGroupStart[rgiGroupStart.len() - 1] + 1);
+        if let Some(iStart) = (iShare..cPoints as usize).find(|&j| (rgTypes[j] & PathPointTypePathTypeMask) == PathPointTypeStart) {
+            if (iStart > rgiGroupStart[rgiGroupStart.len() - 1]) {
+                rgiGroupStart.push(iStart);
+            }
+        }
+    }
+    rgiGroupStart.push(cPoints as usize);
+
+    if (rgiGroupStart.len() <= 2) {
+        return FixedPointPathEnumerate(rgpt, rgTypes, cPoints, matrix, clipRect, enumerateContext);
+    }
+
+    let antiAliasMode = enumerateContext.AntiAliasMode;
+    let nSimplifyTolerance = enumerateContext.SimplifyTolerance;
+
+    let rgGroupResult: Vec<(HRESULT, INT, CThreadEdgeBlocks)> = std::thread::scope(|scope| {
+        let rgThread: Vec<_> = rgiGroupStart.windows(2).enumerate().map(|(iThread, rgiGroup)| {
+            let (iStart, iEnd) = (rgiGroup[0], rgiGroup[1]);
+            let rgBlock = enumerateContext.Store.TakeThreadBlocks(iThread);
+            scope.spawn(move || {
+                let store = CEdgeStore::with_thread_blocks(rgBlock.into_inner());
+                let mut context = CInitializeEdgesContext::new(&store);
+                context.MaxY = INT::MIN;
+                context.ClipRect = clipRect;
+                context.AntiAliasMode = antiAliasMode;
+                context.SimplifyTolerance = nSimplifyTolerance;
+
+                let hr = FixedPointPathEnumerate(
+                    &rgpt[iStart..iEnd],
+                    &rgTypes[iStart..iEnd],
+                    (iEnd - iStart) as UINT,
+                    matrix,
+                    clipRect,
+                    &mut context
+                );
+                let yMax = context.MaxY;
+
+                // Nothing refers to the edges once the context is gone
+                drop(context);
+                (hr, yMax, unsafe { store.TakeBlocks() })
+            })
+        }).collect();
+
+        rgThread.into_iter().map(|thread| thread.join().unwrap()).collect()
+    });
+
+    // Adopt every group's blocks, even past a failure, so that they are
+    // kept for the next path
+    let mut hrFirst = S_OK;
+    for (hrGroup, yMax, rgBlock) in rgGroupResult {
+        if (hrFirst == S_OK) {
+            hrFirst = hrGroup;
+        }
+        enumerateContext.MaxY = enumerateContext.MaxY.max(yMax);
+        enumerateContext.Store.AdoptThreadBlocks(rgBlock);
+    }
+    IFR!(hrFirst);
+
+    return hr;
+}
+
 /**************************************************************************\
 *
 * Function Description:
@@ -1627,7 +1935,7 @@ fn AssertInactiveArray(
 \**************************************************************************/
 
 pub fn InitializeInactiveArray<'a>(
-    pEdgeStore: &'a Arena<CEdge<'a>>,
+    pEdgeStore: &'a CEdgeStore<'a>,
     /*__in_ecount(count+2)*/ rgInactiveArray: &mut [CInactiveEdge<'a>],
     count: UINT,
     tailEdge: Ref<'a, CEdge<'a>> // Tail sentinel for inactive list
@@ -1682,6 +1990,355 @@ pub fn InitializeInactiveArray<'a>(
 
 }
 
+// The most points a polygon can have and still take the convex polygon
+// path (CHwRasterizer::RasterizeConvexPolygon).  Larger polygons go
+// through the general path.
+pub const CONVEX_POLYGON_POINT_MAX: usize = 32;
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   InitializeInactiveArray for the edges of a convex polygon.  Those split
+*   into a chain of downward edges and a chain of upward edges, and each
+*   chain is already in 'y' order once it is rotated to start at the top,
+*   so the inactive array is a merge of the two chains rather than a sort.
+*   Ties go to the edge that comes first in the store, which is what the
+*   stable insertion sort in InitializeInactiveArray does.
+*
+*   Clipping can collapse edges so that they no longer form two such
+*   chains; then this falls back to InitializeInactiveArray.
+*
+\**************************************************************************/
+
+pub fn InitializeInactiveArrayFromConvexPolygon<'a>(
+    pEdgeStore: &'a CEdgeStore<'a>,
+    /*__in_ecount(count+2)*/ rgInactiveArray: &mut [CInactiveEdge<'a>],
+    count: UINT,
+    tailEdge: Ref<'a, CEdge<'a>> // Tail sentinel for inactive list
+) -> INT {
+    let mut rgDown: [(usize, Ref<'a, CEdge<'a>>); CONVEX_POLYGON_POINT_MAX] = [(0, unsafe { Ref::null() }); CONVEX_POLYGON_POINT_MAX];
+    let mut rgUp: [(usize, Ref<'a, CEdge<'a>>); CONVEX_POLYGON_POINT_MAX] = [(0, unsafe { Ref::null() }); CONVEX_POLYGON_POINT_MAX];
+    let mut cDown = 0;
+    let mut cUp = 0;
+
+    assert!(count as usize <= CONVEX_POLYGON_POINT_MAX);
+
+    // Split the edges into the two chains, remembering their position in
+    // the store for breaking ties:
+
+    for (i, e) in pEdgeStore.iter().enumerate() {
+        if (e.WindingDirection > 0) {
+            rgDown[cDown] = (i, Ref::new(e));
+            cDown += 1;
+        } else {
+            rgUp[cUp] = (i, Ref::new(e));
+            cUp += 1;
+        }
+    }
+
+    // The upward edges were stored bottom to top:
+
+    rgUp[..cUp].reverse();
+
+    // The path can start anywhere, so rotate each chain to begin at its
+    // topmost edge, and check that it is then in order:
+
+    for chain in [&mut rgDown[..cDown], &mut rgUp[..cUp]] {
+        if let Some(iTop) = (1..chain.len()).find(|&i| chain[i].1.StartY < chain[i - 1].1.StartY) {
+            chain.rotate_left(iTop);
+        }
+
+        if (chain.windows(2).any(|pair| pair[1].1.StartY <= pair[0].1.StartY)) {
+            return InitializeInactiveArray(pEdgeStore, rgInactiveArray, count, tailEdge);
+        }
+    }
+
+    // Merge the chains, skipping the head sentinel:
+
+    let mut yxDown: LONGLONG = 0;
+    let mut yxUp: LONGLONG = 0;
+    let mut iDown = 0;
+    let mut iUp = 0;
+    let mut iInactive = 1;
+
+    while (iDown < cDown || iUp < cUp) {
+        if (iDown < cDown) {
+            YX(rgDown[iDown].1.X.get(), rgDown[iDown].1.StartY, &mut yxDown);
+        }
+        if (iUp < cUp) {
+            YX(rgUp[iUp].1.X.get(), rgUp[iUp].1.StartY, &mut yxUp);
+        }
+
+        let takeDown = if (iUp == cUp) {
+            true
+        } else if (iDown == cDown) {
+            false
+        } else {
+            (yxDown < yxUp) || (yxDown == yxUp && rgDown[iDown].0 < rgUp[iUp].0)
+        };
+
+        if (takeDown) {
+            rgInactiveArray[iInactive].Edge = rgDown[iDown].1;
+            rgInactiveArray[iInactive].Yx = yxDown;
+            iDown += 1;
+        } else {
+            rgInactiveArray[iInactive].Edge = rgUp[iUp].1;
+            rgInactiveArray[iInactive].Yx = yxUp;
+            iUp += 1;
+        }
+        iInactive += 1;
+    }
+
+    assert!(iInactive as UINT == count + 1);
+
+    // Add the tail and the head sentinels, as InitializeInactiveArray does:
+
+    rgInactiveArray[iInactive].Edge = tailEdge;
+    rgInactiveArray[0].Yx = i64::MIN;
+
+    ASSERTINACTIVEARRAY!(rgInactiveArray, count as i32);
+
+    return (*rgInactiveArray[1].Edge).StartY;
+}
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   Serialized edge table support.  This lets a client run the expensive
+*   part of the pipeline (path enumeration, flattening, clipping, edge
+*   construction and sorting) once offline and replay the result later
+*   straight into the rasterization loop.
+*
+*   The table is little-endian and laid out as a fixed header followed by
+*   one record per edge, already in inactive-array (YX) order:
+*
+*       header:  magic, version, fill mode, clip X, clip Y, clip width,
+*                clip height, edge count                (8 x 32-bit)
+*       edge:    StartY, EndY, X, Error, Dx, ErrorUp, ErrorDown,
+*                WindingDirection                       (8 x 32-bit)
+*
+*   All edge values are in the rasterizer's subpixel space, i.e. exactly
+*   what InitializeEdges produced.
+*
+\**************************************************************************/
+
+pub const EDGE_TABLE_MAGIC: UINT = 0x45524757; // 'WGRE'
+pub const EDGE_TABLE_VERSION: UINT = 1;
+pub const EDGE_TABLE_HEADER_SIZE: usize = 8 * 4;
+pub const EDGE_TABLE_EDGE_SIZE: usize = 8 * 4;
+
+#[derive(Default, Clone)]
+pub struct CEdgeTableHeader {
+    pub FillMode: INT,
+    pub ClipBounds: MilPointAndSizeL,
+    pub Count: UINT,
+}
+
+fn ReadTableInt(table: &[u8], offset: usize) -> INT {
+    INT::from_le_bytes(table[offset..offset + 4].try_into().unwrap())
+}
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   Append the edges of a sorted inactive array to 'table'.  The array
+*   must have been set up by InitializeInactiveArray, so it starts with
+*   the head sentinel and holds 'header.Count' edges after it.
+*
+\**************************************************************************/
+
+pub fn SerializeEdgeTable(
+    header: &CEdgeTableHeader,
+    rgInactiveArray: &[CInactiveEdge],
+    table: &mut Vec<u8>,
+) {
+    let count = header.Count as usize;
+    table.reserve(EDGE_TABLE_HEADER_SIZE + count * EDGE_TABLE_EDGE_SIZE);
+
+    for value in [
+        EDGE_TABLE_MAGIC as INT,
+        EDGE_TABLE_VERSION as INT,
+        header.FillMode,
+        header.ClipBounds.X,
+        header.ClipBounds.Y,
+        header.ClipBounds.Width,
+        header.ClipBounds.Height,
+        header.Count as INT,
+    ] {
+        table.extend_from_slice(&value.to_le_bytes());
+    }
+
+    for inactive in rgInactiveArray.iter().skip(1).take(count) {
+        let edge = &*inactive.Edge;
+        for value in [
+            edge.StartY,
+            edge.EndY,
+            edge.X.get(),
+            edge.Error.get(),
+            edge.Dx,
+            edge.ErrorUp,
+            edge.ErrorDown,
+            edge.WindingDirection,
+        ] {
+            table.extend_from_slice(&value.to_le_bytes());
+        }
+    }
+}
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   Parse and validate the header of a serialized edge table.
+*
+* Returns:
+*
+*   E_INVALIDARG if the table is truncated or was not produced by
+*   SerializeEdgeTable.
+*
+\**************************************************************************/
+
+pub fn ReadEdgeTableHeader(table: &[u8], pHeader: &mut CEdgeTableHeader) -> HRESULT {
+    if (table.len() < EDGE_TABLE_HEADER_SIZE
+        || ReadTableInt(table, 0) as UINT != EDGE_TABLE_MAGIC
+        || ReadTableInt(table, 4) as UINT != EDGE_TABLE_VERSION)
+    {
+        return E_INVALIDARG;
+    }
+
+    pHeader.FillMode = ReadTableInt(table, 8);
+    pHeader.ClipBounds.X = ReadTableInt(table, 12);
+    pHeader.ClipBounds.Y = ReadTableInt(table, 16);
+    pHeader.ClipBounds.Width = ReadTableInt(table, 20);
+    pHeader.ClipBounds.Height = ReadTableInt(table, 24);
+    pHeader.Count = ReadTableInt(table, 28) as UINT;
+
+    if (pHeader.FillMode != MilFillMode::Alternate as INT
+        && pHeader.FillMode != MilFillMode::Winding as INT)
+    {
+        return E_INVALIDARG;
+    }
+
+    // An edge table is either empty or holds at least two edges, and
+    // the inactive array needs room for the two sentinels:
+
+    if (pHeader.Count == 1
+        || pHeader.Count > UINT::MAX - 2
+        || (table.len() - EDGE_TABLE_HEADER_SIZE) / EDGE_TABLE_EDGE_SIZE != pHeader.Count as usize
+        || (table.len() - EDGE_TABLE_HEADER_SIZE) % EDGE_TABLE_EDGE_SIZE != 0)
+    {
+        return E_INVALIDARG;
+    }
+
+    return S_OK;
+}
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   Load the edges of a serialized edge table into 'pEdgeStore' and set up
+*   the inactive array exactly as InitializeInactiveArray would have.
+*   The table is already sorted, so no sorting is done; the order is
+*   verified on the way in instead.
+*
+*   'table' is read in place, so it may point directly into a
+*   memory-mapped file.
+*
+* Returns:
+*
+*   E_INVALIDARG if an edge is malformed or out of order.
+*
+\**************************************************************************/
+
+pub fn InitializeInactiveArrayFromTable<'a>(
+    table: &[u8],
+    pEdgeStore: &'a CEdgeStore<'a>,
+    /*__in_ecount(count+2)*/ rgInactiveArray: &mut [CInactiveEdge<'a>],
+    count: UINT,
+    tailEdge: Ref<'a, CEdge<'a>>, // Tail sentinel for inactive list
+    pnSubpixelYTop: &mut INT,
+    pnSubpixelYBottom: &mut INT,
+) -> HRESULT {
+    let mut nSubpixelYBottom = INT::MIN;
+
+    rgInactiveArray[0].Yx = i64::MIN;
+
+    let mut offset = EDGE_TABLE_HEADER_SIZE;
+    for i in 1..(count as usize + 1) {
+        let edge = CEdge {
+            StartY: ReadTableInt(table, offset),
+            EndY: ReadTableInt(table, offset + 4),
+            X: Cell::new(ReadTableInt(table, offset + 8)),
+            Error: Cell::new(ReadTableInt(table, offset + 12)),
+            Dx: ReadTableInt(table, offset + 16),
+            ErrorUp: ReadTableInt(table, offset + 20),
+            ErrorDown: ReadTableInt(table, offset + 24),
+            WindingDirection: ReadTableInt(table, offset + 28),
+            ..Default::default()
+        };
+        offset += EDGE_TABLE_EDGE_SIZE;
+
+        // Reject anything InitializeEdges could not have produced, since
+        // the DDA and the sentinels rely on these invariants:
+
+        if (edge.StartY >= edge.EndY
+            || edge.StartY == INT::MAX
+            || edge.ErrorDown <= 0
+            || edge.ErrorUp < 0
+            || edge.ErrorUp >= edge.ErrorDown
+            || edge.Error.get() >= 0
+            || edge.Error.get() < -edge.ErrorDown
+            || (edge.WindingDirection != 1 && edge.WindingDirection != -1))
+        {
+            return E_INVALIDARG;
+        }
+
+        // The DDA assumes the coordinates InitializeEdges gets from 28.4
+        // space: everything along the edge lies within [-2^26, 2^26] and
+        // ErrorDown is below 2^30 (see AdvanceDDAMultipleSteps).  Check
+        // where the edge ends up, carries included, in 64 bits:
+
+        let nCoordinateMax = 1 << 26;
+        let llSubpixelYAdvance = edge.EndY as i64 - edge.StartY as i64;
+        let llSubpixelXEnd = edge.X.get() as i64
+            + edge.Dx as i64 * llSubpixelYAdvance
+            + (edge.Error.get() as i64 + edge.ErrorUp as i64 * llSubpixelYAdvance).div_euclid(edge.ErrorDown as i64)
+            + 1;
+
+        if (edge.ErrorDown >= (1 << 30)
+            || edge.StartY < -nCoordinateMax
+            || edge.EndY > nCoordinateMax
+            || edge.X.get() < -nCoordinateMax
+            || edge.X.get() > nCoordinateMax
+            || llSubpixelXEnd < -nCoordinateMax as i64
+            || llSubpixelXEnd > nCoordinateMax as i64)
+        {
+            return E_INVALIDARG;
+        }
+
+        YX(edge.X.get(), edge.StartY, &mut rgInactiveArray[i].Yx);
+        if (rgInactiveArray[i].Yx < rgInactiveArray[i - 1].Yx) {
+            return E_INVALIDARG;
+        }
+
+        nSubpixelYBottom = nSubpixelYBottom.max(edge.EndY);
+        rgInactiveArray[i].Edge = Ref::new(pEdgeStore.alloc(edge));
+    }
+
+    rgInactiveArray[count as usize + 1].Edge = tailEdge;
+
+    ASSERTINACTIVEARRAY!(rgInactiveArray, count as i32);
+
+    *pnSubpixelYTop = (*rgInactiveArray[1].Edge).StartY;
+    *pnSubpixelYBottom = nSubpixelYBottom;
+
+    return S_OK;
+}
+
 /**************************************************************************\
 *
 * Function Description:
@@ -1744,7 +2401,10 @@ pub fn InsertNewEdges<'a>(
 *   Sort the edges so that they're in ascending 'x' order.
 *
 *   We use a bubble-sort for this stage, because edges maintain good
-*   locality and don't often switch ordering positions.
+*   locality and don't often switch ordering positions.  Edges that cross
+*   a lot (self-intersecting scribbles, star polygons, dense hatching) can
+*   take many passes though, so after c_nBubbleSortPassMax of them we
+*   switch to MergeSortActiveEdges.
 *
 * Created:
 *
@@ -1752,10 +2412,26 @@ pub fn InsertNewEdges<'a>(
 *
 \**************************************************************************/
 
-fn SortActiveEdges(list: Ref<CEdge>) {
+pub fn SortActiveEdges(list: Ref<CEdge>) {
+    if (!BubbleSortActiveEdges(list, c_nBubbleSortPassMax)) {
+        MergeSortActiveEdges(list);
+    }
+}
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   The bubble-sort passes of SortActiveEdges.  Stops after 'cPassMax'
+*   passes and returns false if the last one still swapped edges.
+*
+\**************************************************************************/
+
+pub fn BubbleSortActiveEdges(list: Ref<CEdge>, cPassMax: INT) -> bool {
 
     let mut swapOccurred: bool;
     let mut tmp: Ref<CEdge>;
+    let mut cPasses = 0;
 
     // We should never be called with an empty active edge list:
 
@@ -1786,7 +2462,439 @@ fn SortActiveEdges(list: Ref<CEdge>) {
             nextX = (*next).X.get();
             nextX != INT::MAX
         } {}
+
+        cPasses += 1;
+        if (swapOccurred && cPasses == cPassMax) {
+            return false;
+        }
         swapOccurred
     } {}
 
+    return true;
+}
+
+// Sorting the active edge list normally takes a pass or two.  Past these
+// limits the edges are moving far and the sort is headed for O(n^2), so it
+// finishes with an O(n log n) merge sort instead.
+
+const c_nBubbleSortPassMax: INT = 4;
+const c_nInsertionSortMovesPerEdgeMax: usize = 4;
+
+/**************************************************************************\
+*
+* Function Description:
+*
+*   Sort the edges so that they're in ascending 'x' order by repeatedly
+*   merging neighbouring ascending runs, which takes O(n log(runs)).
+*   Merging takes from the left run on ties, so the result is the same as
+*   SortActiveEdges'.
+*
+\**************************************************************************/
+
+pub fn MergeSortActiveEdges(list: Ref<CEdge>) {
+
+    // We should never be called with an empty active edge list:
+
+    assert!((*(*list).Next.get()).X.get() != INT::MAX);
+
+    loop {
+        let mut cRuns = 0;
+        let mut last = list;
+        let mut current = (*list).Next.get();
+
+        while ((*current).X.get() != INT::MAX) {
+            // Measure the run starting at 'current' and the one after it:
+
+            let mut runA = current;
+            let mut cA = 1;
+            while ({ let next = (*current).Next.get(); (*next).X.get() != INT::MAX && (*next).X.get() >= (*current).X.get() }) {
+                current = (*current).Next.get();
+                cA += 1;
+            }
+            current = (*current).Next.get();
+            cRuns += 1;
+
+            let mut runB = current;
+            let mut cB = 0;
+            if ((*current).X.get() != INT::MAX) {
+                cB = 1;
+                while ({ let next = (*current).Next.get(); (*next).X.get() != INT::MAX && (*next).X.get() >= (*current).X.get() }) {
+                    current = (*current).Next.get();
+                    cB += 1;
+                }
+                current = (*current).Next.get();
+                cRuns += 1;
+            }
+
+            // 'current' is now the start of the rest of the list.  Relink
+            // the two runs in order behind 'last':
+
+            while (cA + cB > 0) {
+                let takeB = (cA == 0) || (cB != 0 && (*runB).X.get() < (*runA).X.get());
+                let edge;
+                if (takeB) {
+                    edge = runB;
+                    runB = (*runB).Next.get();
+                    cB -= 1;
+                } else {
+                    edge = runA;
+                    runA = (*runA).Next.get();
+                    cA -= 1;
+                }
+                (*last).Next.set(edge);
+                last = edge;
+            }
+            (*last).Next.set(current);
+        }
+
+        if (cRuns <= 2) {
+            break;
+        }
+    }
+}
+
+/**************************************************************************\
+*
+* Interface Description:
+*
+*   The active edge list as seen by the rasterization loop.  Whatever the
+*   storage, 'Next' steps from the head sentinel through the active edges
+*   in ascending 'x' order and ends at the tail sentinel, which is all the
+*   fillers and the trapezoid code rely on.  Only the linked list keeps
+*   the edges' own 'Next' links up to date.
+*
+\**************************************************************************/
+pub trait IActiveEdgeList<'a> {
+    fn Head(&self) -> Ref<'a, CEdge<'a>>;
+
+    // The edge after 'pEdge', which is the head sentinel or an active edge
+    fn Next(&self, pEdge: Ref<'a, CEdge<'a>>) -> Ref<'a, CEdge<'a>>;
+
+    fn InsertNewEdges(
+        &mut self,
+        iCurrentY: INT,
+        ppInactiveEdge: &'a mut [CInactiveEdge<'a>],
+        pYNextInactive: &mut INT,
+    ) -> &'a mut [CInactiveEdge<'a>];
+
+    // Drop edges that end at or above 'nSubpixelYCurrent' without
+    // advancing the DDA (used after outputting trapezoids)
+    fn RemoveStaleEdges(&mut self, nSubpixelYCurrent: INT);
+
+    fn AdvanceDDAAndUpdate(&mut self, nSubpixelYCurrent: INT);
+
+    // Put 'pEdgeNew' in place of the active edge following 'pEdgePrevious'
+    // (used when a trapezoid continues across the joint between them).
+    // The caller then updates the X and Error of Next(pEdgePrevious).
+    fn ReplaceEdge(&mut self, pEdgePrevious: Ref<'a, CEdge<'a>>, pEdgeNew: Ref<'a, CEdge<'a>>);
+}
+
+/**************************************************************************\
+*
+* Class Description:
+*
+*   The original active edge list: the edges stay where the edge store put
+*   them and are threaded together through their 'Next' links.
+*
+\**************************************************************************/
+pub struct CLinkedActiveEdgeList<'a> {
+    m_pHead: Ref<'a, CEdge<'a>>,
+}
+
+impl<'a> CLinkedActiveEdgeList<'a> {
+    pub fn new(pEdgeActiveList: Ref<'a, CEdge<'a>>) -> Self {
+        Self { m_pHead: pEdgeActiveList }
+    }
+}
+
+impl<'a> IActiveEdgeList<'a> for CLinkedActiveEdgeList<'a> {
+    fn Head(&self) -> Ref<'a, CEdge<'a>> {
+        self.m_pHead
+    }
+
+    fn Next(&self, pEdge: Ref<'a, CEdge<'a>>) -> Ref<'a, CEdge<'a>> {
+        (*pEdge).Next.get()
+    }
+
+    fn InsertNewEdges(
+        &mut self,
+        iCurrentY: INT,
+        ppInactiveEdge: &'a mut [CInactiveEdge<'a>],
+        pYNextInactive: &mut INT,
+    ) -> &'a mut [CInactiveEdge<'a>] {
+        InsertNewEdges(self.m_pHead, iCurrentY, ppInactiveEdge, pYNextInactive)
+    }
+
+    fn RemoveStaleEdges(&mut self, nSubpixelYCurrent: INT) {
+        let mut pEdgePrevious = self.m_pHead;
+        let mut pEdgeCurrent = (*self.m_pHead).Next.get();
+
+        while ((*pEdgeCurrent).EndY != INT::MIN) {
+            if ((*pEdgeCurrent).EndY <= nSubpixelYCurrent) {
+                // Unlink and advance
+
+                pEdgeCurrent = (*pEdgeCurrent).Next.get();
+                (*pEdgePrevious).Next.set(pEdgeCurrent);
+            } else {
+                // Advance
+
+                pEdgePrevious = pEdgeCurrent;
+                pEdgeCurrent = (*pEdgeCurrent).Next.get();
+            }
+        }
+    }
+
+    fn AdvanceDDAAndUpdate(&mut self, nSubpixelYCurrent: INT) {
+        AdvanceDDAAndUpdateActiveEdgeList(nSubpixelYCurrent, self.m_pHead);
+    }
+
+    fn ReplaceEdge(&mut self, pEdgePrevious: Ref<'a, CEdge<'a>>, pEdgeNew: Ref<'a, CEdge<'a>>) {
+        (*pEdgeNew).Next.set((*(*pEdgePrevious).Next.get()).Next.get());
+        (*pEdgePrevious).Next.set(pEdgeNew);
+    }
+}
+
+/**************************************************************************\
+*
+* Class Description:
+*
+*   Buffers for a CActiveEdgeArray, kept in the buffer dispenser between
+*   paths.  They are always empty here, so the lifetime of the edges they
+*   held doesn't matter.
+*
+\**************************************************************************/
+#[derive(Default)]
+pub struct CActiveEdgeArrayBuffers {
+    pub m_rgEdges: CTransientArray<CEdge<'static>>,
+    pub m_rgNewEdges: CTransientArray<CEdge<'static>>,
+    pub m_rgMerged: CTransientArray<CEdge<'static>>,
+}
+
+impl CActiveEdgeArrayBuffers {
+    pub fn new(allocator: CTransientAllocator) -> Self {
+        Self {
+            m_rgEdges: CTransientArray::new(allocator),
+            m_rgNewEdges: CTransientArray::new(allocator),
+            m_rgMerged: CTransientArray::new(allocator),
+        }
+    }
+}
+
+/**************************************************************************\
+*
+* Class Description:
+*
+*   Active edge list kept as a contiguous array of edges in ascending 'x'
+*   order.  Newly active edges are copied in from the edge store, stale
+*   edges are compacted away and the order is restored with an in-place
+*   insertion sort.  The edges' 'Next' links are not used: 'Next' is the
+*   following array element, so walking the list is a linear pass over
+*   memory instead of a pointer chase through the edge store.
+*
+*   The resulting order is exactly the one the linked list produces, so
+*   the output does not depend on which list is used.
+*
+\**************************************************************************/
+pub struct CActiveEdgeArray<'a> {
+    m_pHead: Ref<'a, CEdge<'a>>,
+    m_pTail: Ref<'a, CEdge<'a>>,
+    m_rgEdges: CTransientArray<CEdge<'a>>,
+    m_rgNewEdges: CTransientArray<CEdge<'a>>, // Scratch for InsertNewEdges
+    m_rgMerged: CTransientArray<CEdge<'a>>,   // Scratch for InsertNewEdges
+}
+
+// Only for empty arrays: there are no edges whose lifetime could change
+unsafe fn ChangeEdgeLifetime<'b, 'c>(mut rgEdges: CTransientArray<CEdge<'b>>) -> CTransientArray<CEdge<'c>> {
+    rgEdges.clear();
+    std::mem::transmute::<CTransientArray<CEdge<'b>>, CTransientArray<CEdge<'c>>>(rgEdges)
+}
+
+impl<'a> CActiveEdgeArray<'a> {
+    // 'pEdgeActiveList' must be an empty list, i.e. the head sentinel
+    // linked straight to the tail sentinel.
+    pub fn new(pEdgeActiveList: Ref<'a, CEdge<'a>>, nTotalCount: usize, buffers: CActiveEdgeArrayBuffers) -> Self {
+        let pTail = (*pEdgeActiveList).Next.get();
+        assert!((*pTail).EndY == INT::MIN);
+
+        let mut activeList = unsafe {
+            Self {
+                m_pHead: pEdgeActiveList,
+                m_pTail: pTail,
+                m_rgEdges: ChangeEdgeLifetime(buffers.m_rgEdges),
+                m_rgNewEdges: ChangeEdgeLifetime(buffers.m_rgNewEdges),
+                m_rgMerged: ChangeEdgeLifetime(buffers.m_rgMerged),
+            }
+        };
+        activeList.m_rgEdges.reserve(nTotalCount);
+        activeList.m_rgMerged.reserve(nTotalCount);
+        activeList
+    }
+
+    // Hand the buffers back, emptied, for the next path
+    pub fn Destroy(self) -> CActiveEdgeArrayBuffers {
+        unsafe {
+            CActiveEdgeArrayBuffers {
+                m_rgEdges: ChangeEdgeLifetime(self.m_rgEdges),
+                m_rgNewEdges: ChangeEdgeLifetime(self.m_rgNewEdges),
+                m_rgMerged: ChangeEdgeLifetime(self.m_rgMerged),
+            }
+        }
+    }
+
+    fn IndexOf(&self, pEdge: Ref<'a, CEdge<'a>>) -> usize {
+        let i = unsafe { (&*pEdge as *const CEdge<'a>).offset_from(self.m_rgEdges.as_ptr()) } as usize;
+        debug_assert!(i < self.m_rgEdges.len());
+        i
+    }
+}
+
+impl<'a> IActiveEdgeList<'a> for CActiveEdgeArray<'a> {
+    fn Head(&self) -> Ref<'a, CEdge<'a>> {
+        self.m_pHead
+    }
+
+    #[inline]
+    fn Next(&self, pEdge: Ref<'a, CEdge<'a>>) -> Ref<'a, CEdge<'a>> {
+        let pFirst = self.m_rgEdges.as_ptr();
+        let pEnd = pFirst.wrapping_add(self.m_rgEdges.len());
+        let pNext = if (pEdge == self.m_pHead) { pFirst } else { (&*pEdge as *const CEdge<'a>).wrapping_add(1) };
+
+        // The edges point into our own storage, which stays put until the
+        // next update:
+        if (pNext == pEnd) { self.m_pTail } else { Ref::new(unsafe { &*pNext }) }
+    }
+
+    fn InsertNewEdges(
+        &mut self,
+        iCurrentY: INT,
+        ppInactiveEdge: &'a mut [CInactiveEdge<'a>],
+        pYNextInactive: &mut INT,
+    ) -> &'a mut [CInactiveEdge<'a>] {
+        let mut inactive: &mut [CInactiveEdge] = ppInactiveEdge;
+
+        assert!((*inactive[0].Edge).StartY == iCurrentY);
+
+        self.m_rgNewEdges.clear();
+        while ((*inactive[0].Edge).StartY == iCurrentY) {
+            self.m_rgNewEdges.push((*inactive[0].Edge).clone());
+            inactive = &mut inactive[1..];
+        }
+
+        *pYNextInactive = (*inactive[0].Edge).StartY;
+
+        // The linked list inserts each new edge in front of the first edge
+        // with an 'x' at least as large, scanning on from where the previous
+        // insertion stopped.  So new edges go in front of existing edges
+        // with the same 'x', and new edges sharing an 'x' end up in reverse
+        // order.  Reverse those runs and merge:
+
+        let mut start = 0;
+        while (start < self.m_rgNewEdges.len()) {
+            let x = self.m_rgNewEdges[start].X.get();
+            let mut end = start + 1;
+            while (end < self.m_rgNewEdges.len() && self.m_rgNewEdges[end].X.get() == x) {
+                end += 1;
+            }
+            self.m_rgNewEdges[start..end].reverse();
+            start = end;
+        }
+
+        self.m_rgMerged.clear();
+        self.m_rgMerged.reserve(self.m_rgEdges.len() + self.m_rgNewEdges.len());
+        {
+            let (mut iExisting, mut iAdded) = (0, 0);
+            while (iExisting < self.m_rgEdges.len() || iAdded < self.m_rgNewEdges.len()) {
+                let takeAdded = iExisting == self.m_rgEdges.len()
+                    || (iAdded < self.m_rgNewEdges.len() && self.m_rgNewEdges[iAdded].X.get() <= self.m_rgEdges[iExisting].X.get());
+                if (takeAdded) {
+                    self.m_rgMerged.push(self.m_rgNewEdges[iAdded].clone());
+                    iAdded += 1;
+                } else {
+                    self.m_rgMerged.push(self.m_rgEdges[iExisting].clone());
+                    iExisting += 1;
+                }
+            }
+        }
+        std::mem::swap(&mut self.m_rgEdges, &mut self.m_rgMerged);
+
+        return inactive;
+    }
+
+    fn RemoveStaleEdges(&mut self, nSubpixelYCurrent: INT) {
+        let mut count = 0;
+        for i in 0..self.m_rgEdges.len() {
+            if (self.m_rgEdges[i].EndY > nSubpixelYCurrent) {
+                if (count != i) {
+                    self.m_rgEdges.swap(count, i);
+                }
+                count += 1;
+            }
+        }
+        self.m_rgEdges.truncate(count);
+    }
+
+    fn AdvanceDDAAndUpdate(&mut self, nSubpixelYCurrent: INT) {
+        let mut nOutOfOrderCount: INT = 0;
+        let mut nPreviousX = INT::MIN;
+        let mut cStale = 0;
+
+        for edge in self.m_rgEdges.iter() {
+            // Stale edges are compacted away below:
+
+            if (edge.EndY <= nSubpixelYCurrent) {
+                cStale += 1;
+                continue;
+            }
+
+            // Advance the DDA:
+
+            let mut x = edge.X.get() + edge.Dx;
+            let mut error = edge.Error.get() + edge.ErrorUp;
+            if (error >= 0) {
+                error -= edge.ErrorDown;
+                x += 1;
+            }
+            edge.X.set(x);
+            edge.Error.set(error);
+
+            nOutOfOrderCount += (nPreviousX > x) as INT;
+            nPreviousX = x;
+        }
+
+        if (cStale != 0) {
+            self.RemoveStaleEdges(nSubpixelYCurrent);
+        }
+        let count = self.m_rgEdges.len();
+
+        // As with the linked list, out-of-order edges are rare.  Insertion
+        // sort is stable, so it gives the same order as the bubble sort.
+        // If the edges have moved so far that it is doing a lot of work,
+        // the standard library's merge sort, which is stable too, finishes
+        // the job.  It picks up the part that is already sorted as a run.
+
+        if (nOutOfOrderCount != 0) {
+            let mut cMovesLeft = count * c_nInsertionSortMovesPerEdgeMax;
+            for i in 1..count {
+                let mut j = i;
+                while (j > 0 && self.m_rgEdges[j - 1].X.get() > self.m_rgEdges[j].X.get()) {
+                    self.m_rgEdges.swap(j - 1, j);
+                    j -= 1;
+                }
+                cMovesLeft = cMovesLeft.saturating_sub(i - j);
+                if (cMovesLeft == 0) {
+                    self.m_rgEdges.sort_by_key(|edge| edge.X.get());
+                    break;
+                }
+            }
+        }
+
+        debug_assert!(self.m_rgEdges.windows(2).all(|pair| pair[0].X <= pair[1].X));
+    }
+
+    fn ReplaceEdge(&mut self, pEdgePrevious: Ref<'a, CEdge<'a>>, pEdgeNew: Ref<'a, CEdge<'a>>) {
+        // Copy the new edge over the old one's slot:
+
+        let i = self.IndexOf(self.Next(pEdgePrevious));
+        self.m_rgEdges[i] = (*pEdgeNew).clone();
+    }
 }
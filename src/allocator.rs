@@ -0,0 +1,279 @@
+//------------------------------------------------------------------------------
+//
+//  Description:
+//      Allocator hook for the rasterizer's transient buffers
+//
+//      The inactive array, the coverage intervals, the aliased pixel
+//      spans, the vertex storage and the overflow of the edge store are
+//      allocated through a CTransientAllocator, which is either the global
+//      allocator or a pair of functions supplied by the embedder (see
+//      PathBuilder::set_allocator).
+//
+
+use std::alloc::Layout;
+use std::ffi::c_void;
+use std::marker::PhantomData;
+use std::ops::{Deref, DerefMut};
+use std::ptr::NonNull;
+
+use crate::types::DynArrayExts;
+
+/// Allocates `size` bytes aligned to `align`, or returns null.
+pub type TransientAllocFn = unsafe extern "C" fn(user_data: *mut c_void, size: usize, align: usize) -> *mut c_void;
+/// Frees a block returned by the matching `TransientAllocFn`, passing back
+/// its size and alignment.
+pub type TransientFreeFn = unsafe extern "C" fn(user_data: *mut c_void, ptr: *mut c_void, size: usize, align: usize);
+
+unsafe extern "C" fn GlobalAlloc(_user_data: *mut c_void, size: usize, align: usize) -> *mut c_void {
+    std::alloc::alloc(Layout::from_size_align_unchecked(size, align)) as *mut c_void
+}
+
+unsafe extern "C" fn GlobalFree(_user_data: *mut c_void, ptr: *mut c_void, size: usize, align: usize) {
+    std::alloc::dealloc(ptr as *mut u8, Layout::from_size_align_unchecked(size, align))
+}
+
+#[derive(Clone, Copy)]
+pub struct CTransientAllocator {
+    m_pfnAlloc: TransientAllocFn,
+    m_pfnFree: TransientFreeFn,
+    m_pvUserData: *mut c_void,
+}
+
+impl Default for CTransientAllocator {
+    fn default() -> Self {
+        Self {
+            m_pfnAlloc: GlobalAlloc,
+            m_pfnFree: GlobalFree,
+            m_pvUserData: std::ptr::null_mut(),
+        }
+    }
+}
+
+impl CTransientAllocator {
+    // The caller guarantees that 'pfnAlloc' and 'pfnFree' stay usable with
+    // 'pvUserData' for as long as anything allocated through them lives.
+    pub unsafe fn new(pfnAlloc: TransientAllocFn, pfnFree: TransientFreeFn, pvUserData: *mut c_void) -> Self {
+        Self {
+            m_pfnAlloc: pfnAlloc,
+            m_pfnFree: pfnFree,
+            m_pvUserData: pvUserData,
+        }
+    }
+
+    // True if both allocate and free through the same functions and user data
+    pub fn IsSameAs(&self, other: &CTransientAllocator) -> bool {
+        self.m_pfnAlloc as usize == other.m_pfnAlloc as usize
+            && self.m_pfnFree as usize == other.m_pfnFree as usize
+            && self.m_pvUserData == other.m_pvUserData
+    }
+
+    fn Alloc(&self, layout: Layout) -> NonNull<u8> {
+        assert!(layout.size() != 0);
+        let p = unsafe { (self.m_pfnAlloc)(self.m_pvUserData, layout.size(), layout.align()) } as *mut u8;
+        match NonNull::new(p) {
+            Some(p) => {
+                assert!(p.as_ptr() as usize % layout.align() == 0);
+                p
+            }
+            None => std::alloc::handle_alloc_error(layout),
+        }
+    }
+
+    unsafe fn Free(&self, p: NonNull<u8>, layout: Layout) {
+        (self.m_pfnFree)(self.m_pvUserData, p.as_ptr() as *mut c_void, layout.size(), layout.align())
+    }
+}
+
+/**************************************************************************\
+*
+* Class Description:
+*
+*   A growable array whose storage comes from a CTransientAllocator.
+*   Elements only move when the array grows past its capacity, and the
+*   storage goes back to the allocator it came from when the array is
+*   dropped.
+*
+\**************************************************************************/
+pub struct CTransientArray<T> {
+    m_pData: NonNull<T>,
+    m_cCount: usize,
+    m_cCapacity: usize,
+    m_allocator: CTransientAllocator,
+    _phantom: PhantomData<T>,
+}
+
+impl<T> Default for CTransientArray<T> {
+    fn default() -> Self {
+        Self::new(Default::default())
+    }
+}
+
+impl<T> CTransientArray<T> {
+    pub fn new(allocator: CTransientAllocator) -> Self {
+        assert!(std::mem::size_of::<T>() != 0);
+        Self {
+            m_pData: NonNull::dangling(),
+            m_cCount: 0,
+            m_cCapacity: 0,
+            m_allocator: allocator,
+            _phantom: PhantomData,
+        }
+    }
+
+    pub fn with_capacity(allocator: CTransientAllocator, capacity: usize) -> Self {
+        let mut array = Self::new(allocator);
+        array.reserve_exact(capacity);
+        array
+    }
+
+    pub fn GetAllocator(&self) -> CTransientAllocator {
+        self.m_allocator
+    }
+
+    pub fn len(&self) -> usize {
+        self.m_cCount
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.m_cCount == 0
+    }
+
+    pub fn capacity(&self) -> usize {
+        self.m_cCapacity
+    }
+
+    pub fn as_ptr(&self) -> *const T {
+        self.m_pData.as_ptr()
+    }
+
+    pub fn as_mut_ptr(&mut self) -> *mut T {
+        self.m_pData.as_ptr()
+    }
+
+    // Make room for 'additional' more elements, at least doubling the
+    // capacity so that pushes are amortized constant time
+    pub fn reserve(&mut self, additional: usize) {
+        let cRequired = self.m_cCount.checked_add(additional).unwrap();
+        if (cRequired > self.m_cCapacity) {
+            self.Reallocate(cRequired.max(self.m_cCapacity * 2).max(4));
+        }
+    }
+
+    pub fn reserve_exact(&mut self, additional: usize) {
+        let cRequired = self.m_cCount.checked_add(additional).unwrap();
+        if (cRequired > self.m_cCapacity) {
+            self.Reallocate(cRequired);
+        }
+    }
+
+    fn Reallocate(&mut self, cCapacity: usize) {
+        debug_assert!(cCapacity >= self.m_cCount);
+
+        let layout = Layout::array::<T>(cCapacity).unwrap();
+        let pData = self.m_allocator.Alloc(layout).cast::<T>();
+        unsafe {
+            std::ptr::copy_nonoverlapping(self.m_pData.as_ptr(), pData.as_ptr(), self.m_cCount);
+        }
+        self.FreeStorage();
+        self.m_pData = pData;
+        self.m_cCapacity = cCapacity;
+    }
+
+    fn FreeStorage(&mut self) {
+        if (self.m_cCapacity != 0) {
+            unsafe {
+                self.m_allocator.Free(self.m_pData.cast(), Layout::array::<T>(self.m_cCapacity).unwrap());
+            }
+        }
+        self.m_pData = NonNull::dangling();
+        self.m_cCapacity = 0;
+    }
+
+    pub fn push(&mut self, value: T) {
+        if (self.m_cCount == self.m_cCapacity) {
+            self.reserve(1);
+        }
+        unsafe {
+            self.m_pData.as_ptr().add(self.m_cCount).write(value);
+        }
+        self.m_cCount += 1;
+    }
+
+    // The caller has initialized the elements up to 'count', which is
+    // within the capacity
+    pub unsafe fn set_len(&mut self, count: usize) {
+        debug_assert!(count <= self.m_cCapacity);
+        self.m_cCount = count;
+    }
+
+    pub fn resize_with(&mut self, count: usize, mut f: impl FnMut() -> T) {
+        if (count <= self.m_cCount) {
+            self.truncate(count);
+        } else {
+            self.reserve(count - self.m_cCount);
+            while (self.m_cCount < count) {
+                unsafe {
+                    self.m_pData.as_ptr().add(self.m_cCount).write(f());
+                }
+                self.m_cCount += 1;
+            }
+        }
+    }
+
+    pub fn resize(&mut self, count: usize, value: T) where T: Clone {
+        self.resize_with(count, || value.clone())
+    }
+
+    pub fn truncate(&mut self, count: usize) {
+        while (self.m_cCount > count) {
+            self.m_cCount -= 1;
+            unsafe {
+                std::ptr::drop_in_place(self.m_pData.as_ptr().add(self.m_cCount));
+            }
+        }
+    }
+
+    pub fn clear(&mut self) {
+        self.truncate(0);
+    }
+}
+
+impl<T> Drop for CTransientArray<T> {
+    fn drop(&mut self) {
+        self.clear();
+        self.FreeStorage();
+    }
+}
+
+impl<T> Deref for CTransientArray<T> {
+    type Target = [T];
+    fn deref(&self) -> &[T] {
+        unsafe { std::slice::from_raw_parts(self.m_pData.as_ptr(), self.m_cCount) }
+    }
+}
+
+impl<T> DerefMut for CTransientArray<T> {
+    fn deref_mut(&mut self) -> &mut [T] {
+        unsafe { std::slice::from_raw_parts_mut(self.m_pData.as_ptr(), self.m_cCount) }
+    }
+}
+
+impl<T> DynArrayExts<T> for CTransientArray<T> {
+    fn Reset(&mut self, shrink: bool) {
+        self.clear();
+        if shrink {
+            self.FreeStorage();
+        }
+    }
+    fn GetCount(&self) -> usize {
+        self.len()
+    }
+    fn SetCount(&mut self, count: usize) {
+        assert!(count <= self.len());
+        self.truncate(count);
+    }
+
+    fn GetDataBuffer(&self) -> &[T] {
+        self
+    }
+}
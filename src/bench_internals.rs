@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+//
+//  Description:
+//      Entry points for the micro-benchmarks in benches/
+//
+//      These time pieces of the rasterizer that the public API only reaches
+//      as part of a whole rasterization.  Only built with the
+//      "bench_internals" feature, and not part of the API.
+//
+
+use crate::aacoverage::{CCoverageBuffer, c_antiAliasMode, c_nShiftMask};
+use crate::aarasterizer::*;
+use crate::nullable_ref::Ref;
+use crate::types::*;
+
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum ActiveEdgeList {
+    Linked,
+    Array,
+}
+
+/// Scan converts `polygons` (each a closed loop of 28.4 device space
+/// points) one subscanline at a time with the given active edge list, the
+/// way the rasterizer handles complex scans: insert the newly active
+/// edges, fill the coverage buffer, advance the DDA.  Without
+/// `fill_coverage` the fill is replaced by a plain walk over the active
+/// edges, which leaves only the work the list itself does.
+///
+/// Returns the number of coverage intervals produced, or the sum of the
+/// walked 'x' values, neither of which depends on the list.
+pub fn sweep_active_edges(polygons: &[Vec<(i32, i32)>], list: ActiveEdgeList, fill_coverage: bool) -> usize {
+    let mut rgInactiveArray: Vec<CInactiveEdge> = Vec::new();
+    let edgeHead: CEdge = Default::default();
+    let mut edgeTail: CEdge = Default::default();
+    let edgeStore = CEdgeStore::new();
+    let mut edgeContext = CInitializeEdgesContext::new(&edgeStore);
+
+    edgeTail.X.set(i32::MAX);       // Terminator to active list
+    edgeTail.StartY = i32::MAX;     // Terminator to inactive list
+    edgeTail.EndY = i32::MIN;
+    edgeHead.X.set(i32::MIN);       // Beginning of active list
+    edgeHead.Next.set(Ref::new(&edgeTail));
+
+    edgeContext.MaxY = i32::MIN;
+    edgeContext.AntiAliasMode = c_antiAliasMode;
+
+    for polygon in polygons {
+        let mut rgpt: Vec<POINT> = polygon.iter().chain(polygon.first())
+            .map(|&(x, y)| POINT { x, y })
+            .collect();
+        let cPoints = rgpt.len() as UINT;
+        assert!(!FAILED(InitializeEdges(&mut edgeContext, &mut rgpt, cPoints)));
+    }
+
+    let nTotalCount = edgeStore.len();
+    if (nTotalCount == 0) {
+        return 0;
+    }
+
+    rgInactiveArray.resize_with(nTotalCount + 2, Default::default);
+    let nSubpixelYCurrent = InitializeInactiveArray(&edgeStore, &mut rgInactiveArray, nTotalCount as UINT, Ref::new(&edgeTail));
+    let nSubpixelYBottom = edgeContext.MaxY;
+    let pEdgeActiveList = Ref::new(&edgeHead);
+
+    match list {
+        ActiveEdgeList::Linked => {
+            let mut activeList = CLinkedActiveEdgeList::new(pEdgeActiveList);
+            SweepActiveEdges(&mut activeList, &mut rgInactiveArray[1..], nSubpixelYCurrent, nSubpixelYBottom, fill_coverage)
+        }
+        ActiveEdgeList::Array => {
+            let mut activeList = CActiveEdgeArray::new(pEdgeActiveList, nTotalCount, Default::default());
+            let cResult = SweepActiveEdges(&mut activeList, &mut rgInactiveArray[1..], nSubpixelYCurrent, nSubpixelYBottom, fill_coverage);
+            activeList.Destroy();
+            cResult
+        }
+    }
+}
+
+fn SweepActiveEdges<'a>(
+    activeList: &mut impl IActiveEdgeList<'a>,
+    mut pInactiveEdgeArray: &'a mut [CInactiveEdge<'a>],
+    mut nSubpixelYCurrent: INT,
+    nSubpixelYBottom: INT,
+    fFillCoverage: bool,
+) -> usize {
+    let coverageBuffer: CCoverageBuffer = Default::default();
+    let mut nSubpixelYNextInactive: INT = 0;
+    let mut cResult: usize = 0;
+
+    coverageBuffer.Initialize(Default::default());
+
+    pInactiveEdgeArray = activeList.InsertNewEdges(nSubpixelYCurrent, pInactiveEdgeArray, &mut nSubpixelYNextInactive);
+
+    while (nSubpixelYCurrent < nSubpixelYBottom) {
+        let nSubpixelYNext;
+
+        if ((*activeList.Next(activeList.Head())).EndY == INT::MIN) {
+            // Nothing is active, so jump over the gap
+            nSubpixelYNext = nSubpixelYNextInactive;
+        } else {
+            if (fFillCoverage) {
+                assert!(!FAILED(coverageBuffer.FillEdgesWinding(activeList, nSubpixelYCurrent)));
+            } else {
+                let mut pEdge = activeList.Next(activeList.Head());
+                while ((*pEdge).EndY != INT::MIN) {
+                    cResult = cResult.wrapping_add(pEdge.X.get() as usize);
+                    pEdge = activeList.Next(pEdge);
+                }
+            }
+            nSubpixelYNext = nSubpixelYCurrent + 1;
+            activeList.AdvanceDDAAndUpdate(nSubpixelYNext);
+        }
+
+        // If the scan is done, count and drop what's there:
+        if (nSubpixelYNext > (nSubpixelYCurrent | c_nShiftMask)) {
+            cResult += coverageBuffer.m_rgInterval.borrow().len() - 2;
+            coverageBuffer.Reset();
+        }
+
+        nSubpixelYCurrent = nSubpixelYNext;
+
+        if (nSubpixelYCurrent == nSubpixelYNextInactive && nSubpixelYCurrent < nSubpixelYBottom) {
+            pInactiveEdgeArray = activeList.InsertNewEdges(nSubpixelYCurrent, pInactiveEdgeArray, &mut nSubpixelYNextInactive);
+        }
+    }
+
+    coverageBuffer.Destroy();
+
+    cResult
+}
+
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub enum ActiveEdgeSort {
+    SortActiveEdges,
+    MergeSortActiveEdges,
+    // Bubble sort passes until sorted, without SortActiveEdges' hand-off
+    // to the merge sort
+    BubbleSortActiveEdges,
+}
+
+/// A linked active edge list, between its head and tail sentinels, whose
+/// edges have the given 'x' values in the given order.
+pub struct UnsortedActiveEdges {
+    // The head sentinel, the edges and the tail sentinel.  The list links
+    // point into this, so it is never resized.
+    m_rgEdge: Box<[CEdge<'static>]>,
+    m_rgX: Vec<INT>,
+}
+
+impl UnsortedActiveEdges {
+    pub fn new(rgX: &[i32]) -> Self {
+        let mut list = Self {
+            m_rgEdge: (0..rgX.len() + 2).map(|_| Default::default()).collect(),
+            m_rgX: rgX.to_vec(),
+        };
+        assert!(!rgX.is_empty() && rgX.iter().all(|&x| x != INT::MIN && x != INT::MAX));
+
+        let cEdges = list.m_rgEdge.len();
+        list.m_rgEdge[0].X.set(INT::MIN);
+        list.m_rgEdge[cEdges - 1].X.set(INT::MAX);
+        list.m_rgEdge[cEdges - 1].EndY = INT::MIN;
+        list.reset();
+        list
+    }
+
+    /// Puts the edges back in their original order
+    pub fn reset(&mut self) {
+        for (edge, &x) in self.m_rgEdge[1..].iter().zip(&self.m_rgX) {
+            edge.X.set(x);
+        }
+        for i in 1..self.m_rgEdge.len() {
+            // The edges are boxed, so they stay put for as long as we live
+            let pEdge: &'static CEdge<'static> = unsafe { &*(&self.m_rgEdge[i] as *const CEdge<'static>) };
+            self.m_rgEdge[i - 1].Next.set(Ref::new(pEdge));
+        }
+    }
+
+    pub fn sort(&self, sort: ActiveEdgeSort) {
+        let pHead = Ref::new(unsafe { &*(&self.m_rgEdge[0] as *const CEdge<'static>) });
+        match sort {
+            ActiveEdgeSort::SortActiveEdges => SortActiveEdges(pHead),
+            ActiveEdgeSort::MergeSortActiveEdges => MergeSortActiveEdges(pHead),
+            ActiveEdgeSort::BubbleSortActiveEdges => { BubbleSortActiveEdges(pHead, INT::MAX); }
+        }
+    }
+
+    pub fn is_sorted(&self) -> bool {
+        let mut pEdge = self.m_rgEdge[0].Next.get();
+        let mut cEdges = 0;
+        while ((*pEdge).X.get() != INT::MAX) {
+            let pNext = (*pEdge).Next.get();
+            if ((*pNext).X.get() < (*pEdge).X.get()) {
+                return false;
+            }
+            pEdge = pNext;
+            cEdges += 1;
+        }
+        cEdges == self.m_rgX.len()
+    }
+}
@@ -823,6 +823,118 @@ fn cFlatten(
 }
 }
 
+//+-----------------------------------------------------------------------------
+//
+//  Pre-clipping
+//
+//  The crackers only skip a curve, or one of Bezier64's high-level pieces,
+//  when its bound box misses the visible area.  A curve that crosses the
+//  visible area at high zoom is otherwise flattened along its whole length.
+//  vSubdivideToClip splits such a curve (de Casteljau, in doubles) until
+//  every piece either lies near the visible area or misses it.  Pieces that
+//  miss it are replaced by their chords.  The chord and the piece both lie
+//  inside the piece's bound box, so they wind the same way around every
+//  visible pixel and the fill doesn't change.
+//
+
+// Pieces are flattened whole once they are within the visible area grown by
+// its own width and height, or once they are this small (16 pixels in 28.4):
+
+const PRECLIP_PIECE_MIN: f64 = 256.;
+
+// Limits the splitting of pieces that keep straddling the visible area:
+
+const PRECLIP_DEPTH_MAX: i32 = 24;
+
+pub enum CBezierPiece
+{
+    Line(POINT),            // End point of a chord that isn't visible
+    Curve([POINT; 4])       // Control points of a piece to be flattened
+}
+
+fn vSubdivideToClipRecursive(
+    aptfx: &[[f64; 2]; 4],
+    ptfxStart: POINT,
+    ptfxEnd: POINT,
+    rcfxClip: &[f64; 4],
+    rcfxNear: &[f64; 4],
+    nDepth: i32,
+    rgPiece: &mut Vec<CBezierPiece>)
+{
+    let mut rcfxBound = [aptfx[0][0], aptfx[0][1], aptfx[0][0], aptfx[0][1]];
+    for ptfx in &aptfx[1..]
+    {
+        rcfxBound[0] = rcfxBound[0].min(ptfx[0]);
+        rcfxBound[1] = rcfxBound[1].min(ptfx[1]);
+        rcfxBound[2] = rcfxBound[2].max(ptfx[0]);
+        rcfxBound[3] = rcfxBound[3].max(ptfx[1]);
+    }
+    let fSmall = (rcfxBound[2] - rcfxBound[0]).max(rcfxBound[3] - rcfxBound[1]) <= PRECLIP_PIECE_MIN;
+
+    // Make the bounds one pixel loose, like vBoundBox:
+
+    let rcfxBound = [rcfxBound[0] - 16., rcfxBound[1] - 16., rcfxBound[2] + 16., rcfxBound[3] + 16.];
+
+    if (!((rcfxBound[0] < rcfxClip[2]) &&
+          (rcfxBound[1] < rcfxClip[3]) &&
+          (rcfxBound[2] > rcfxClip[0]) &&
+          (rcfxBound[3] > rcfxClip[1])))
+    {
+        rgPiece.push(CBezierPiece::Line(ptfxEnd));
+        return;
+    }
+
+    let fNear = (rcfxBound[0] >= rcfxNear[0]) &&
+                (rcfxBound[1] >= rcfxNear[1]) &&
+                (rcfxBound[2] <= rcfxNear[2]) &&
+                (rcfxBound[3] <= rcfxNear[3]);
+
+    let fxRound = |ptfx: &[f64; 2]| POINT { x: ptfx[0].round() as INT, y: ptfx[1].round() as INT };
+
+    if (fNear || fSmall || nDepth == 0)
+    {
+        rgPiece.push(CBezierPiece::Curve([ptfxStart, fxRound(&aptfx[1]), fxRound(&aptfx[2]), ptfxEnd]));
+        return;
+    }
+
+    // Split in half:
+
+    let mid = |a: &[f64; 2], b: &[f64; 2]| [(a[0] + b[0]) * 0.5, (a[1] + b[1]) * 0.5];
+    let p01 = mid(&aptfx[0], &aptfx[1]);
+    let p12 = mid(&aptfx[1], &aptfx[2]);
+    let p23 = mid(&aptfx[2], &aptfx[3]);
+    let p012 = mid(&p01, &p12);
+    let p123 = mid(&p12, &p23);
+    let p0123 = mid(&p012, &p123);
+    let ptfxMid = fxRound(&p0123);
+
+    vSubdivideToClipRecursive(&[aptfx[0], p01, p012, p0123], ptfxStart, ptfxMid, rcfxClip, rcfxNear, nDepth - 1, rgPiece);
+    vSubdivideToClipRecursive(&[p0123, p123, p23, aptfx[3]], ptfxMid, ptfxEnd, rcfxClip, rcfxNear, nDepth - 1, rgPiece);
+}
+
+//+-----------------------------------------------------------------------------
+//
+//  Function:  vSubdivideToClip
+//
+//  Synopsis:  Appends the pieces of the Bezier 'aptfxBez' (28.4) to 'rgPiece'
+//             in order.  A curve near the visible area comes back whole,
+//             with its control points unchanged.
+//
+//------------------------------------------------------------------------------
+pub fn vSubdivideToClip(
+    aptfxBez: &[POINT; 4],
+    rcfxClip: &RECT,
+    rgPiece: &mut Vec<CBezierPiece>)
+{
+    let rcfxClip = [rcfxClip.left as f64, rcfxClip.top as f64, rcfxClip.right as f64, rcfxClip.bottom as f64];
+    let (fxWidth, fxHeight) = (rcfxClip[2] - rcfxClip[0], rcfxClip[3] - rcfxClip[1]);
+    let rcfxNear = [rcfxClip[0] - fxWidth, rcfxClip[1] - fxHeight, rcfxClip[2] + fxWidth, rcfxClip[3] + fxHeight];
+
+    let aptfx = aptfxBez.map(|ptfx| [ptfx.x as f64, ptfx.y as f64]);
+
+    vSubdivideToClipRecursive(&aptfx, aptfxBez[0], aptfxBez[3], &rcfxClip, &rcfxNear, PRECLIP_DEPTH_MAX, rgPiece);
+}
+
 //+-----------------------------------------------------------------------------
 //
 //  class CMILBezier
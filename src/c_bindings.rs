@@ -1,4 +1,6 @@
-use crate::{PathBuilder, OutputVertex, FillMode};
+use std::ffi::c_void;
+
+use crate::{TransientAllocFn, TransientFreeFn, PathBuilder, OutputVertex, InteriorTrapezoid, OutputTrapezoid, OutputSpan, FillMode, MilPoint2F, MilPointAndSizeF, rasterize_path, rasterize_rects};
 
 #[no_mangle]
 pub extern "C" fn wgr_new_builder() -> *mut PathBuilder {
@@ -26,11 +28,75 @@ pub extern "C" fn wgr_builder_quad_to(pb: &mut PathBuilder, cx: f32, cy: f32, x:
     pb.quad_to(cx, cy, x, y);
 }
 
+/// Clears the path and settings but keeps the allocated capacity.
+#[no_mangle]
+pub extern "C" fn wgr_builder_reset(pb: &mut PathBuilder) {
+    pb.reset();
+}
+
+#[no_mangle]
+pub extern "C" fn wgr_builder_reserve(pb: &mut PathBuilder, additional: usize) {
+    pb.reserve(additional);
+}
+
+#[no_mangle]
+pub extern "C" fn wgr_builder_add_rect(pb: &mut PathBuilder, x: f32, y: f32, width: f32, height: f32) {
+    pb.add_rect(x, y, width, height);
+}
+
+/// Equivalent to calling `wgr_builder_line_to` for each of the `count` points.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_builder_append_polyline(pb: &mut PathBuilder, points: *const MilPoint2F, count: usize) {
+    if count != 0 {
+        pb.append_polyline(std::slice::from_raw_parts(points, count));
+    }
+}
+
+/// Appends `count` points and types in the `wgr_rasterize_path` format.
+/// Returns false, leaving the builder untouched, if they aren't a valid path.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_builder_append_path(pb: &mut PathBuilder, points: *const MilPoint2F, types: *const u8, count: usize) -> bool {
+    if count == 0 {
+        return true;
+    }
+    pb.append_path(std::slice::from_raw_parts(points, count), std::slice::from_raw_parts(types, count))
+}
+
 #[no_mangle]
 pub extern "C" fn wgr_builder_set_fill_mode(pb: &mut PathBuilder, fill_mode: FillMode) {
     pb.set_fill_mode(fill_mode)
 }
 
+#[no_mangle]
+pub extern "C" fn wgr_builder_set_simplify_tolerance(pb: &mut PathBuilder, tolerance: f32) {
+    pb.set_simplify_tolerance(tolerance)
+}
+
+#[no_mangle]
+pub extern "C" fn wgr_builder_set_trapezoid_chain_tolerance(pb: &mut PathBuilder, tolerance: f32) {
+    pb.set_trapezoid_chain_tolerance(tolerance)
+}
+
+#[no_mangle]
+pub extern "C" fn wgr_builder_set_antialias(pb: &mut PathBuilder, antialias: bool) {
+    pb.set_antialias(antialias)
+}
+
+#[no_mangle]
+pub extern "C" fn wgr_builder_set_edge_building_threads(pb: &mut PathBuilder, threads: usize) {
+    pb.set_edge_building_threads(threads)
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn wgr_builder_set_allocator(pb: &mut PathBuilder, alloc: TransientAllocFn, free: TransientFreeFn, user_data: *mut c_void) {
+    pb.set_allocator(alloc, free, user_data)
+}
+
+#[no_mangle]
+pub extern "C" fn wgr_builder_release_buffers(pb: &mut PathBuilder) {
+    pb.release_buffers()
+}
+
 #[repr(C)]
 pub struct VertexBuffer {
     data: *const OutputVertex,
@@ -44,6 +110,180 @@ pub extern "C" fn wgr_rasterize_to_tri_strip(pb: &PathBuilder, clip_x: i32, clip
     VertexBuffer { data: result.as_ptr(), len: result.len()}
 }
 
+/// Rasterizes `count` points and types in the `rasterize_path` format.
+/// Returns an empty buffer if they don't describe a valid path.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_rasterize_path(points: *const MilPoint2F, types: *const u8, count: usize, fill_mode: FillMode,
+    clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> VertexBuffer
+{
+    let (points, types) = if count == 0 {
+        (&[][..], &[][..])
+    } else {
+        (std::slice::from_raw_parts(points, count), std::slice::from_raw_parts(types, count))
+    };
+    let result = rasterize_path(points, types, fill_mode, clip_x, clip_y, clip_width, clip_height).unwrap_or_default();
+    let vb = VertexBuffer { data: result.as_ptr(), len: result.len()};
+    std::mem::forget(result);
+    vb
+}
+
+/// Rasterizes each of the `count` rectangles on its own and returns the
+/// concatenated output.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_rasterize_rects(rects: *const MilPointAndSizeF, count: usize,
+    clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> VertexBuffer
+{
+    let rects = if count == 0 { &[][..] } else { std::slice::from_raw_parts(rects, count) };
+    let result = rasterize_rects(rects, clip_x, clip_y, clip_width, clip_height);
+    let vb = VertexBuffer { data: result.as_ptr(), len: result.len()};
+    std::mem::forget(result);
+    vb
+}
+
+/// A growable vertex buffer owned by the caller and filled by
+/// `wgr_rasterize_into`. Start from a zeroed buffer and release it
+/// with `wgr_output_buffer_release`.
+#[repr(C)]
+pub struct OutputBuffer {
+    data: *mut OutputVertex,
+    len: usize,
+    capacity: usize,
+}
+
+impl OutputBuffer {
+    unsafe fn take(&mut self) -> Vec<OutputVertex> {
+        let vec = if self.capacity == 0 {
+            Vec::new()
+        } else {
+            Vec::from_raw_parts(self.data, self.len, self.capacity)
+        };
+        *self = OutputBuffer { data: std::ptr::null_mut(), len: 0, capacity: 0 };
+        vec
+    }
+
+    fn put(&mut self, vec: Vec<OutputVertex>) {
+        let mut vec = std::mem::ManuallyDrop::new(vec);
+        *self = OutputBuffer { data: vec.as_mut_ptr(), len: vec.len(), capacity: vec.capacity() };
+    }
+}
+
+/// Like `wgr_rasterize_to_tri_strip` but replaces the contents of `output`,
+/// reusing its allocation from previous calls.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_rasterize_into(pb: &PathBuilder, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32, output: &mut OutputBuffer)
+{
+    let mut vec = output.take();
+    pb.rasterize_into(clip_x, clip_y, clip_width, clip_height, &mut vec);
+    output.put(vec);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn wgr_output_buffer_release(output: &mut OutputBuffer)
+{
+    drop(output.take());
+}
+
+/// A growable list of full coverage areas owned by the caller and filled
+/// by `wgr_rasterize_edges_into`. Start from a zeroed buffer and release it
+/// with `wgr_interior_buffer_release`.
+#[repr(C)]
+pub struct InteriorBuffer {
+    data: *mut InteriorTrapezoid,
+    len: usize,
+    capacity: usize,
+}
+
+impl InteriorBuffer {
+    unsafe fn take(&mut self) -> Vec<InteriorTrapezoid> {
+        let vec = if self.capacity == 0 {
+            Vec::new()
+        } else {
+            Vec::from_raw_parts(self.data, self.len, self.capacity)
+        };
+        *self = InteriorBuffer { data: std::ptr::null_mut(), len: 0, capacity: 0 };
+        vec
+    }
+
+    fn put(&mut self, vec: Vec<InteriorTrapezoid>) {
+        let mut vec = std::mem::ManuallyDrop::new(vec);
+        *self = InteriorBuffer { data: vec.as_mut_ptr(), len: vec.len(), capacity: vec.capacity() };
+    }
+}
+
+/// Like `wgr_rasterize_into` but only puts the anti-aliased fringes in
+/// `output` and stores the areas of full coverage in `interior`.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_rasterize_edges_into(pb: &PathBuilder, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32,
+    output: &mut OutputBuffer, interior: &mut InteriorBuffer)
+{
+    let mut vec = output.take();
+    let mut interior_vec = interior.take();
+    pb.rasterize_edges_into(clip_x, clip_y, clip_width, clip_height, &mut vec, &mut interior_vec);
+    output.put(vec);
+    interior.put(interior_vec);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn wgr_interior_buffer_release(interior: &mut InteriorBuffer)
+{
+    drop(interior.take());
+}
+
+/// Growable lists of trapezoids and spans owned by the caller and filled by
+/// `wgr_rasterize_trapezoids_into`. Start from a zeroed buffer and release
+/// it with `wgr_record_buffer_release`.
+#[repr(C)]
+pub struct RecordBuffer {
+    trapezoids: *mut OutputTrapezoid,
+    trapezoids_len: usize,
+    trapezoids_capacity: usize,
+    spans: *mut OutputSpan,
+    spans_len: usize,
+    spans_capacity: usize,
+}
+
+impl RecordBuffer {
+    unsafe fn take(&mut self) -> (Vec<OutputTrapezoid>, Vec<OutputSpan>) {
+        let trapezoids = if self.trapezoids_capacity == 0 {
+            Vec::new()
+        } else {
+            Vec::from_raw_parts(self.trapezoids, self.trapezoids_len, self.trapezoids_capacity)
+        };
+        let spans = if self.spans_capacity == 0 {
+            Vec::new()
+        } else {
+            Vec::from_raw_parts(self.spans, self.spans_len, self.spans_capacity)
+        };
+        self.put(Vec::new(), Vec::new());
+        (trapezoids, spans)
+    }
+
+    fn put(&mut self, trapezoids: Vec<OutputTrapezoid>, spans: Vec<OutputSpan>) {
+        let mut trapezoids = std::mem::ManuallyDrop::new(trapezoids);
+        let mut spans = std::mem::ManuallyDrop::new(spans);
+        *self = RecordBuffer {
+            trapezoids: trapezoids.as_mut_ptr(), trapezoids_len: trapezoids.len(), trapezoids_capacity: trapezoids.capacity(),
+            spans: spans.as_mut_ptr(), spans_len: spans.len(), spans_capacity: spans.capacity(),
+        };
+    }
+}
+
+/// Replaces the contents of `records` with the trapezoids and spans of the
+/// path, see `PathBuilder::rasterize_trapezoids_into`.
+#[no_mangle]
+pub unsafe extern "C" fn wgr_rasterize_trapezoids_into(pb: &PathBuilder, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32, records: &mut RecordBuffer)
+{
+    let (mut trapezoids, mut spans) = records.take();
+    pb.rasterize_trapezoids_into(clip_x, clip_y, clip_width, clip_height, &mut trapezoids, &mut spans);
+    records.put(trapezoids, spans);
+}
+
+#[no_mangle]
+pub unsafe extern "C" fn wgr_record_buffer_release(records: &mut RecordBuffer)
+{
+    drop(records.take());
+}
+
 #[no_mangle]
 pub extern "C" fn wgr_vertex_buffer_release(vb: VertexBuffer)
 {
@@ -1,5 +1,4 @@
 use crate::aacoverage::CCoverageInterval;
-use crate::nullable_ref::Ref;
 use crate::types::*;
 
 pub trait IGeometrySink
@@ -50,8 +49,8 @@ pub trait IGeometrySink
     fn AddComplexScan(&mut self,
         nPixelY: INT,
             // In: y coordinate in pixel space
-            pIntervalSpanStart: Ref<CCoverageInterval>
-            // In: coverage segments
+            rgIntervals: &[CCoverageInterval]
+            // In: coverage segments, linked from c_iIntervalHead
         ) -> HRESULT;
     
     fn AddTrapezoid(
@@ -5,7 +5,7 @@
 #![allow(unused_parens)]
 
 
-use std::cell::RefCell;
+use std::cell::{Cell, RefCell};
 use std::rc::Rc;
 
 use crate::aacoverage::{CCoverageBuffer, c_rInvShiftSize, c_antiAliasMode, c_nShift, CCoverageInterval, c_nShiftMask, c_nShiftSize, c_nHalfShiftSize};
@@ -13,11 +13,11 @@ use crate::hwvertexbuffer::CHwVertexBufferBuilder;
 use crate::matrix::{CMILMatrix, CMatrix};
 use crate::nullable_ref::Ref;
 use crate::aarasterizer::*;
+use crate::allocator::CTransientArray;
 use crate::geometry_sink::IGeometrySink;
 use crate::helpers::Int32x32To64;
 use crate::types::*;
 use cfor::cfor;
-use typed_arena_nomut::Arena;
 
 //-----------------------------------------------------------------------------
 //
@@ -146,6 +146,199 @@ IsFractionLessThan(
 }
 
 
+//-------------------------------------------------------------------------
+//
+//  Function:   IsConvexPolygon
+//
+//  Synopsis:
+//      Check whether a path is a single subpath of lines that is a convex
+//      polygon once transformed to 28.4, returning the transformed points.
+//      A last point repeating the first is dropped.
+//
+//      The polygon is convex if it always turns the same way and only
+//      changes vertical direction twice, i.e. winds around exactly once.
+//
+//-------------------------------------------------------------------------
+fn IsConvexPolygon(
+    rgpt: &[MilPoint2F],
+    rgTypes: &[BYTE],
+    pmatWorldTransform: &CMILMatrix,
+    rgptPolygon: &mut [POINT; CONVEX_POLYGON_POINT_MAX],
+    pcPoints: &mut usize
+    ) -> bool
+{
+    let mut cPoints = rgpt.len();
+
+    if (cPoints < 3
+        || cPoints > CONVEX_POLYGON_POINT_MAX + 1
+        || (rgTypes[0] & PathPointTypePathTypeMask) != PathPointTypeStart
+        || rgTypes[1..].iter().any(|&t| (t & PathPointTypePathTypeMask) != PathPointTypeLine))
+    {
+        return false;
+    }
+
+    if (rgpt[cPoints - 1].X == rgpt[0].X && rgpt[cPoints - 1].Y == rgpt[0].Y)
+    {
+        cPoints -= 1;
+    }
+
+    if (cPoints < 3 || cPoints > CONVEX_POLYGON_POINT_MAX)
+    {
+        return false;
+    }
+
+    let mut matrix: CMILMatrix = pmatWorldTransform.clone();
+    AppendScaleToMatrix(&mut matrix, TOREAL!(16), TOREAL!(16));
+
+    if (FAILED(TransformRasterizerPointsTo28_4(&matrix, rgpt, cPoints as UINT, &mut rgptPolygon[..])))
+    {
+        // Let RasterizePath report the failure
+        return false;
+    }
+
+    let p = &rgptPolygon[..cPoints];
+    let edge = |i: usize| -> (LONGLONG, LONGLONG) {
+        let (a, b) = (p[i % cPoints], p[(i + 1) % cPoints]);
+        ((b.x - a.x) as LONGLONG, (b.y - a.y) as LONGLONG)
+    };
+
+    let mut nTurn: LONGLONG = 0;
+    let mut nDirectionChanges = 0;
+
+    // Start from the vertical direction of the last edge going up or down:
+
+    let mut nDirectionY: LONGLONG = (0..cPoints).rev().map(|i| edge(i).1.signum()).find(|&d| d != 0).unwrap_or(0);
+
+    for i in 0..cPoints
+    {
+        let (dx1, dy1) = edge(i);
+        let (dx2, dy2) = edge(i + 1);
+
+        let nCross = (dx1 * dy2 - dy1 * dx2).signum();
+        if (nCross != 0)
+        {
+            if (nTurn != 0 && nCross != nTurn)
+            {
+                return false;
+            }
+            nTurn = nCross;
+        }
+        else if (dx1 * dx2 + dy1 * dy2 < 0)
+        {
+            // Doubles back on itself
+            return false;
+        }
+
+        if (dy1 != 0 && dy1.signum() != nDirectionY)
+        {
+            nDirectionChanges += 1;
+            nDirectionY = dy1.signum();
+        }
+    }
+
+    *pcPoints = cPoints;
+
+    // Degenerate (all collinear) polygons go down the general path
+    return nTurn != 0 && nDirectionChanges <= 2;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   GetConvexPolygonChains
+//
+//  Synopsis:
+//      Split the edges of a convex polygon into its chain of downward
+//      edges and its chain of upward edges, each in 'y' order.
+//
+//      Returns false unless each chain runs from the top of the polygon
+//      to its bottom without gaps, so that exactly one edge of each chain
+//      is active on every scanline.  Clipping can collapse edges so that
+//      this no longer holds.
+//
+//-------------------------------------------------------------------------
+fn GetConvexPolygonChains<'a>(
+    pEdgeStore: &'a CEdgeStore<'a>,
+    rgpEdgeDown: &mut [Ref<'a, CEdge<'a>>; CONVEX_POLYGON_POINT_MAX],
+    rgpEdgeUp: &mut [Ref<'a, CEdge<'a>>; CONVEX_POLYGON_POINT_MAX],
+    pcEdgesDown: &mut usize,
+    pcEdgesUp: &mut usize
+    ) -> bool
+{
+    let mut cDown = 0;
+    let mut cUp = 0;
+
+    for e in pEdgeStore.iter()
+    {
+        if (e.WindingDirection > 0)
+        {
+            rgpEdgeDown[cDown] = Ref::new(e);
+            cDown += 1;
+        }
+        else
+        {
+            rgpEdgeUp[cUp] = Ref::new(e);
+            cUp += 1;
+        }
+    }
+
+    *pcEdgesDown = cDown;
+    *pcEdgesUp = cUp;
+
+    if (cDown == 0 || cUp == 0)
+    {
+        return false;
+    }
+
+    for chain in [&mut rgpEdgeDown[..cDown], &mut rgpEdgeUp[..cUp]]
+    {
+        chain.sort_unstable_by_key(|pEdge| pEdge.StartY);
+
+        if (chain.windows(2).any(|pair| pair[0].EndY != pair[1].StartY))
+        {
+            return false;
+        }
+    }
+
+    return rgpEdgeDown[0].StartY == rgpEdgeUp[0].StartY
+        && rgpEdgeDown[cDown - 1].EndY == rgpEdgeUp[cUp - 1].EndY;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   IsAxisAlignedRectangle
+//
+//  Synopsis:
+//      Check whether the 28.4 points of a polygon from IsConvexPolygon are
+//      the corners of an axis-aligned rectangle.
+//
+//-------------------------------------------------------------------------
+fn IsAxisAlignedRectangle(
+    rgptPolygon: &[POINT]
+    ) -> bool
+{
+    let p = rgptPolygon;
+
+    p.len() == 4
+        && ((p[0].y == p[1].y && p[1].x == p[2].x && p[2].y == p[3].y && p[3].x == p[0].x)
+            || (p[0].x == p[1].x && p[1].y == p[2].y && p[2].x == p[3].x && p[3].y == p[0].y))
+}
+
+// The number of polygons RasterizeConvexChains has walked, and how many
+// of them were rectangles from RasterizeRectangle, on this thread, so that
+// the tests can tell which path a polygon took
+#[cfg(test)]
+thread_local! {
+    pub static g_cConvexChainWalks: Cell<usize> = Cell::new(0);
+    pub static g_cRectangleWalks: Cell<usize> = Cell::new(0);
+}
+
+// The number of subpixel rows RasterizeActiveEdges has filled one at a
+// time on this thread, so that the tests can tell which rows it skipped
+#[cfg(test)]
+thread_local! {
+    pub static g_cScanRows: Cell<usize> = Cell::new(0);
+}
+
 //-------------------------------------------------------------------------
 //
 //  Function:   AdvanceDDAMultipleSteps
@@ -264,6 +457,84 @@ AdvanceDDAMultipleSteps(
     *nSubpixelErrorRightBottom = (llSubpixelErrorBottom as INT);
 }
 
+//-------------------------------------------------------------------------
+//
+//  Function:   EdgesMoveTogether
+//
+//  Synopsis:
+//      Whether two active edges at the same position stay at the same
+//      position however far their DDAs are advanced: they are both
+//      vertical, or their DDAs are in the same state.
+//
+//-------------------------------------------------------------------------
+fn EdgesMoveTogether(
+    pEdgeA: &CEdge,
+    pEdgeB: &CEdge
+    ) -> bool
+{
+    if (pEdgeA.X.get() != pEdgeB.X.get())
+    {
+        return false;
+    }
+
+    let fVerticalA = (pEdgeA.Dx == 0 && pEdgeA.ErrorUp == 0);
+    let fVerticalB = (pEdgeB.Dx == 0 && pEdgeB.ErrorUp == 0);
+
+    (fVerticalA && fVerticalB)
+        || (pEdgeA.Dx == pEdgeB.Dx
+            && pEdgeA.ErrorUp == pEdgeB.ErrorUp
+            && pEdgeA.ErrorDown == pEdgeB.ErrorDown
+            && pEdgeA.Error.get() == pEdgeB.Error.get())
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   AdvanceActiveEdgesMultipleSteps
+//
+//  Synopsis:
+//      Advance the DDA of every active edge by multiple steps.  The caller
+//      makes sure that this leaves the active edges in order (see
+//      CHwRasterizer::ComputeNoCoverageEndScan).
+//
+//-------------------------------------------------------------------------
+fn AdvanceActiveEdgesMultipleSteps<'a>(
+    activeList: &impl IActiveEdgeList<'a>,
+    nSubpixelYAdvance: INT
+    )
+{
+    let mut pEdgeLeft = activeList.Next(activeList.Head());
+
+    while ((*pEdgeLeft).EndY != INT::MIN)
+    {
+        // The active edge list always has an even number of edges
+
+        let pEdgeRight = activeList.Next(pEdgeLeft);
+        assert!((*pEdgeRight).EndY != INT::MIN);
+
+        let mut nSubpixelXLeftBottom = 0;
+        let mut nSubpixelErrorLeftBottom = 0;
+        let mut nSubpixelXRightBottom = 0;
+        let mut nSubpixelErrorRightBottom = 0;
+
+        AdvanceDDAMultipleSteps(
+            &*pEdgeLeft,
+            &*pEdgeRight,
+            nSubpixelYAdvance,
+            &mut nSubpixelXLeftBottom,
+            &mut nSubpixelErrorLeftBottom,
+            &mut nSubpixelXRightBottom,
+            &mut nSubpixelErrorRightBottom
+            );
+
+        pEdgeLeft.X.set(nSubpixelXLeftBottom);
+        pEdgeLeft.Error.set(nSubpixelErrorLeftBottom);
+        pEdgeRight.X.set(nSubpixelXRightBottom);
+        pEdgeRight.Error.set(nSubpixelErrorRightBottom);
+
+        pEdgeLeft = activeList.Next(pEdgeRight);
+    }
+}
+
 //-------------------------------------------------------------------------
 //
 //  Function:   ComputeDeltaUpperBound
@@ -397,11 +668,122 @@ ComputeDistanceLowerBound(
 
     return nSubpixelXDistanceLowerBound;
 }
+//-------------------------------------------------------------------------
+//
+//  Class:   CTrapezoidChain
+//
+//  Synopsis:
+//      Scratch for ComputeChainedTrapezoidsEndScan: the active edges and,
+//      in inactive array order, the inactive edges that continue them
+//      below their EndY.  Chaining is only tried for a handful of active
+//      edges, so everything lives in small fixed arrays.
+//
+//-------------------------------------------------------------------------
+const c_nChainEdgeMax: usize = 8;     // Most active edges chained at once
+const c_nChainJointMax: usize = 32;   // Most joints crossed in one step
+
+#[derive(Default)]
+struct CTrapezoidChain<'a> {
+    cEdges: usize,
+    rgpEdgeActive: [Option<Ref<'a, CEdge<'a>>>; c_nChainEdgeMax], // Active edges in x order
+    rgpEdgeLast: [Option<Ref<'a, CEdge<'a>>>; c_nChainEdgeMax],   // Last edge of each chain so far
+    cJoints: usize,
+    rgJoint: [(usize, Option<Ref<'a, CEdge<'a>>>); c_nChainJointMax], // Chain index and continuing edge
+}
+
+impl<'a> CTrapezoidChain<'a> {
+    // The edge of chain 'iChain' that covers scanline 'nSubpixelY' (or
+    // ends right at it), and the scanline its X and Error are for.
+    fn EdgeAt(&self, iChain: usize, nSubpixelYCurrent: INT, nSubpixelY: INT) -> (Ref<'a, CEdge<'a>>, INT) {
+        let mut pEdge = self.rgpEdgeActive[iChain].unwrap();
+        let mut nSubpixelYEdge = nSubpixelYCurrent;
+        for &(iJointChain, pEdgeJoint) in &self.rgJoint[..self.cJoints] {
+            let pEdgeJoint = pEdgeJoint.unwrap();
+            if (pEdgeJoint.StartY >= nSubpixelY) {
+                break;
+            }
+            if (iJointChain == iChain) {
+                pEdge = pEdgeJoint;
+                nSubpixelYEdge = pEdgeJoint.StartY;
+            }
+        }
+        (pEdge, nSubpixelYEdge)
+    }
+
+    // The edge of chain 'iChain' at the bottom of a chained trapezoid and
+    // its x/error there.
+    fn ComputeBottom(&self,
+        iChain: usize,
+        nSubpixelYCurrent: INT,
+        nSubpixelYNext: INT,
+        nSubpixelXBottom: &mut INT,
+        nSubpixelErrorBottom: &mut INT
+        ) -> Ref<'a, CEdge<'a>>
+    {
+        let (pEdge, nSubpixelYEdge) = self.EdgeAt(iChain, nSubpixelYCurrent, nSubpixelYNext);
+        let (mut nUnused, mut nUnusedError) = (0, 0);
+
+        AdvanceDDAMultipleSteps(
+            &*pEdge,
+            &*pEdge,
+            nSubpixelYNext - nSubpixelYEdge,
+            nSubpixelXBottom,
+            nSubpixelErrorBottom,
+            &mut nUnused,
+            &mut nUnusedError
+            );
+
+        pEdge
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Class:   CInactiveArrayAllocation
+//
+//  Synopsis:
+//      A heap inactive array on loan from the device's buffer dispenser
+//      (see CHwRasterizer::AllocateInactiveArray).  Dropping it clears the
+//      entries, which point at edges of the path that was rasterized, and
+//      hands the allocation back.
+//
+//-------------------------------------------------------------------------
+struct CInactiveArrayAllocation {
+    m_pDeviceNoRef: Option<Rc<CD3DDeviceLevel1>>,
+    m_rgInactiveArray: CTransientArray<CInactiveEdge<'static>>,
+}
+
+impl Drop for CInactiveArrayAllocation {
+    fn drop(&mut self) {
+        self.m_rgInactiveArray.clear();
+
+        if let Some(pDevice) = &self.m_pDeviceNoRef
+        {
+            if (self.m_rgInactiveArray.capacity() != 0)
+            {
+                let allocator = self.m_rgInactiveArray.GetAllocator();
+                pDevice.bufferDispenser.borrow_mut().m_rgInactiveArray =
+                    std::mem::replace(&mut self.m_rgInactiveArray, CTransientArray::new(allocator));
+            }
+        }
+    }
+}
+
 pub struct CHwRasterizer {
     m_rcClipBounds: MilPointAndSizeL,
     m_matWorldToDevice: CMILMatrix,
     m_pIGeometrySink: Option<Rc<RefCell<CHwVertexBufferBuilder>>>,
     m_fillMode: MilFillMode,
+    // Simplification tolerance for FixedPointPathEnumerate in 28.4
+    m_nSimplifyTolerance: INT,
+    // How far in subpixels an edge joint may be from a chained trapezoid's
+    // side, 0 to never chain
+    m_nChainTolerance: INT,
+    // c_antiAliasMode, or MilAntiAliasMode::None to sample each pixel
+    // once at its center
+    m_antiAliasMode: MilAntiAliasMode,
+    // How many threads path enumeration may use, 1 to stay on this one
+    m_cEnumerateThreads: usize,
     /* 
 DynArray<MilPoint2F> *m_prgPoints;
 DynArray<BYTE>       *m_prgTypes;
@@ -456,6 +838,55 @@ fn ConvertSubpixelYToPixel(
     return (nSubpixel as f32)*c_rInvShiftSize;
 }
 
+//-------------------------------------------------------------------------
+//
+//  Function:   ComputeAliasedSpans
+//
+//  Synopsis:
+//      Replace 'rgSpan' with the [left, right) pixel intervals that the
+//      active edge list fills on the current scanline.  Without
+//      anti-aliasing an edge's X is the first pixel whose center is at or
+//      to the right of it, so the intervals are exact.  Touching
+//      intervals are merged.
+//
+//-------------------------------------------------------------------------
+fn ComputeAliasedSpans<'a>(
+    activeList: &impl IActiveEdgeList<'a>,
+    fillMode: MilFillMode,
+    rgSpan: &mut CTransientArray<(INT, INT)>
+    )
+{
+    let mut pEdge = activeList.Next(activeList.Head());
+    let mut nWindingValue: INT = 0;
+    let mut nPixelXLeft: INT = 0;
+
+    rgSpan.clear();
+
+    while (pEdge.X.get() != INT::MAX)
+    {
+        let fInsideBefore = if (fillMode == MilFillMode::Alternate) { (nWindingValue & 1) != 0 } else { nWindingValue != 0 };
+        nWindingValue += pEdge.WindingDirection;
+        let fInsideAfter = if (fillMode == MilFillMode::Alternate) { (nWindingValue & 1) != 0 } else { nWindingValue != 0 };
+
+        if (!fInsideBefore && fInsideAfter)
+        {
+            nPixelXLeft = pEdge.X.get();
+        }
+        else if (fInsideBefore && !fInsideAfter && pEdge.X.get() > nPixelXLeft)
+        {
+            match rgSpan.last_mut()
+            {
+                Some(span) if span.1 == nPixelXLeft => span.1 = pEdge.X.get(),
+                _ => rgSpan.push((nPixelXLeft, pEdge.X.get())),
+            }
+        }
+
+        pEdge = activeList.Next(pEdge);
+    }
+
+    debug_assert!(nWindingValue == 0 || fillMode == MilFillMode::Alternate);
+}
+
 impl CHwRasterizer {
     //-------------------------------------------------------------------------
     //
@@ -471,6 +902,10 @@ impl CHwRasterizer {
         m_fillMode: MilFillMode::Alternate,
         m_rcClipBounds: Default::default(),
         m_pIGeometrySink: None,
+        m_nSimplifyTolerance: 0,
+        m_nChainTolerance: 0,
+        m_antiAliasMode: c_antiAliasMode,
+        m_cEnumerateThreads: 1,
     
         // State is cleared on the Setup call
         m_matWorldToDevice: Default::default(),
@@ -514,11 +949,11 @@ pub fn RasterizePath(
     // Default is not implemented for arrays of size 40 so we need to use map
     let mut inactiveArrayStack: [CInactiveEdge; INACTIVE_LIST_NUMBER!()] = [(); INACTIVE_LIST_NUMBER!()].map(|_| Default::default());
     let mut pInactiveArray: &mut [CInactiveEdge];
-    let mut pInactiveArrayAllocation: Vec<CInactiveEdge>;
+    let mut inactiveArrayAllocation: Option<CInactiveArrayAllocation> = None;
     let mut edgeHead: CEdge = Default::default();
     let mut edgeTail: CEdge = Default::default();
     let pEdgeActiveList: Ref<CEdge>;
-    let mut edgeStore = Arena::new();
+    let mut edgeStore = self.NewEdgeStore();
     //edgeStore.init();
     let mut edgeContext: CInitializeEdgesContext = CInitializeEdgesContext::new(&mut edgeStore);
 
@@ -535,8 +970,8 @@ pub fn RasterizePath(
     pEdgeActiveList = Ref::new(&mut edgeHead);
     //edgeContext.Store = &mut edgeStore;
 
-    edgeContext.AntiAliasMode = c_antiAliasMode;
-    assert!(edgeContext.AntiAliasMode != MilAntiAliasMode::None);
+    edgeContext.AntiAliasMode = self.m_antiAliasMode;
+    edgeContext.SimplifyTolerance = self.m_nSimplifyTolerance;
 
     // If the path contains 0 or 1 points, we can ignore it.
     if (cPoints < 2)
@@ -549,11 +984,7 @@ pub fn RasterizePath(
     // Scale the clip bounds rectangle by 16 to account for our
     // scaling to 28.4 coordinates:
 
-    let mut clipBounds : RECT = Default::default();
-    clipBounds.left   = self.m_rcClipBounds.X * FIX4_ONE!();
-    clipBounds.top    = self.m_rcClipBounds.Y * FIX4_ONE!();
-    clipBounds.right  = (self.m_rcClipBounds.X + self.m_rcClipBounds.Width) * FIX4_ONE!();
-    clipBounds.bottom = (self.m_rcClipBounds.Y + self.m_rcClipBounds.Height) * FIX4_ONE!();
+    let clipBounds = self.GetSubpixelClipBounds();
 
     edgeContext.ClipRect = Some(&clipBounds);
 
@@ -563,19 +994,16 @@ pub fn RasterizePath(
     let mut matrix: CMILMatrix = (*pmatWorldTransform).clone();
     AppendScaleToMatrix(&mut matrix, TOREAL!(16), TOREAL!(16));
 
-    let coverageBuffer: CCoverageBuffer = Default::default();
-    // Initialize the coverage buffer
-    coverageBuffer.Initialize();
-
     // Enumerate the path and construct the edge table:
 
-    hr = MIL_THR!(FixedPointPathEnumerate(
+    hr = MIL_THR!(FixedPointPathEnumerateInParallel(
         rgpt,
         rgTypes,
         cPoints,
         &matrix,
         edgeContext.ClipRect,
-        &mut edgeContext
+        &mut edgeContext,
+        self.m_cEnumerateThreads
         ));
 
     if (FAILED(hr))
@@ -600,12 +1028,14 @@ pub fn RasterizePath(
 
     assert!((nTotalCount >= 2) && (nTotalCount <= (UINT::MAX - 2)));
 
+    let coverageBuffer: CCoverageBuffer = Default::default();
+    // Initialize the coverage buffer
+    coverageBuffer.Initialize(self.AllocateCoverageIntervals());
+
     pInactiveArray = &mut inactiveArrayStack[..];
     if (nTotalCount > (INACTIVE_LIST_NUMBER!() as u32 - 2))
     {
-        pInactiveArrayAllocation = vec![Default::default(); nTotalCount as usize + 2];
-
-        pInactiveArray = &mut pInactiveArrayAllocation;
+        pInactiveArray = self.AllocateInactiveArray(&mut inactiveArrayAllocation, nTotalCount as usize + 2);
     }
 
     // Initialize and sort the inactive array:
@@ -632,7 +1062,7 @@ pub fn RasterizePath(
     // 'nPixelYClipBottom' is in screen space and needs to be converted to the
     // format we use for antialiasing.
 
-    nSubpixelYBottom = nSubpixelYBottom.min(nPixelYClipBottom << c_nShift);
+    nSubpixelYBottom = nSubpixelYBottom.min(nPixelYClipBottom << self.GetSubpixelShift());
 
     // 'nTotalCount' should have been zero if all the edges were
     // clipped out (RasterizeEdges assumes there's at least one edge
@@ -640,694 +1070,2230 @@ pub fn RasterizePath(
 
     assert!(nSubpixelYBottom > nSubpixelYCurrent);
 
-    IFC!(self.RasterizeEdges(
-        pEdgeActiveList,
-        pInactiveArray,
-        &coverageBuffer,
-        nSubpixelYCurrent,
-        nSubpixelYBottom
-        ));
+    if (self.m_antiAliasMode == MilAntiAliasMode::None)
+    {
+        hr = self.RasterizeAliasedEdges(
+            &mut CLinkedActiveEdgeList::new(pEdgeActiveList),
+            pInactiveArray,
+            &coverageBuffer,
+            nSubpixelYCurrent,
+            nSubpixelYBottom
+            );
+    }
+    else
+    {
+        hr = self.RasterizeEdges(
+            pEdgeActiveList,
+            pInactiveArray,
+            nTotalCount,
+            &coverageBuffer,
+            nSubpixelYCurrent,
+            nSubpixelYBottom
+            );
+    }
+
+    self.ReleaseCoverageIntervals(coverageBuffer.Destroy());
+
+    IFC!(hr);
 
     return hr;
 }
 
 //-------------------------------------------------------------------------
 //
-//  Function:   CHwRasterizer::Setup
+//  Function:   CHwRasterizer::RasterizeRectangle
 //
 //  Synopsis:
-//      1. Ensure clean state
-//      2. Convert path to internal format
+//      RasterizeConvexPolygon for an antialiased axis-aligned rectangle.
+//
+//      The only edges are the two vertical sides.  Their DDAs never move,
+//      so rather than going through InitializeEdges they are computed
+//      directly, with the same integer math and clipping, and then walked
+//      by RasterizeConvexChains: the partial top scanline, one trapezoid
+//      down to the last whole scanline, and the partial bottom scanline
+//      (complex scans all the way down if the rectangle is too narrow for
+//      a trapezoid).
+//
+//      A rectangle entirely to one side of the clipping has
+//      InitializeEdges collapse edges, so it takes RasterizeConvexPolygon
+//      instead.
 //
 //-------------------------------------------------------------------------
-pub fn Setup(&mut self,
-    pD3DDevice: Rc<CD3DDeviceLevel1>,
-    pShape: Rc<dyn IShapeData>,
-    pmatWorldToDevice: Option<&CMatrix<CoordinateSpace::Shape,CoordinateSpace::Device>>
+fn RasterizeRectangle(
+    &mut self,
+    rgptRect: &[POINT]
     ) -> HRESULT
 {
-    let hr = S_OK;
+    let hr;
 
+    assert!(self.m_antiAliasMode != MilAntiAliasMode::None);
 
-    //
-    // Initialize our state
-    //
-    self.m_rcClipBounds = Default::default();
-    self.m_pIGeometrySink = None;
+    let clipBounds = self.GetSubpixelClipBounds();
+    let nPixelYClipBottom: INT = self.m_rcClipBounds.Y + self.m_rcClipBounds.Height;
 
+    // Scale to subpixels with the half-pixel offset, as InitializeEdges
+    // does, along with the clipping:
 
+    let ToSubpixel = |n: INT| (n + 8) << c_nShift;
 
-    self.m_pDeviceNoRef = Some(pD3DDevice.clone());
+    let mut xLeft = ToSubpixel(rgptRect[0].x.min(rgptRect[2].x));
+    let mut xRight = ToSubpixel(rgptRect[0].x.max(rgptRect[2].x));
+    let yTop = ToSubpixel(rgptRect[0].y.min(rgptRect[2].y));
+    let yBottom = ToSubpixel(rgptRect[0].y.max(rgptRect[2].y));
 
-    //
-    // PS#856364-2003/07/01-ashrafm  Remove pixel center fixup
-    //
-    // Incoming coordinate space uses integers at upper-left of pixel (pixel
-    // center are half integers) at device level.
-    //
-    // Rasterizer uses the coordinate space with integers at pixel center.
-    //
-    // To convert from center (1/2, 1/2) to center (0, 0) we need to subtract
-    // 1/2 from each coordinate in device space.
-    //
-    // See InitializeEdges in aarasterizer.ccp to see how we unconvert for
-    // antialiased rendering.
-    //
+    assert!(clipBounds.bottom > 0);
 
-    let mut matWorldHPCToDeviceIPC;
-    if let Some(pmatWorldToDevice) = pmatWorldToDevice
+    let yClipTopInteger = (clipBounds.top >> 4) << c_nShift;
+    let yClipTop = clipBounds.top << c_nShift;
+    let yClipBottom = (clipBounds.bottom << c_nShift) - 16;   // Inclusive
+    let xClipLeft = clipBounds.left << c_nShift;
+    let xClipRight = clipBounds.right << c_nShift;
+
+    if (yBottom <= yClipTop || yTop > yClipBottom)
     {
-        matWorldHPCToDeviceIPC = pmatWorldToDevice.clone();
+        return S_OK;     // Entirely clipped
+    }
+
+    // Sides outside the clipping go onto its boundary:
+
+    for x in [&mut xLeft, &mut xRight]
+    {
+        if (*x <= xClipLeft)
+        {
+            *x = xClipLeft;
+        }
+        else if (*x >= xClipRight)
+        {
+            *x = xClipRight;
+        }
+    }
+
+    if (xLeft == xRight)
+    {
+        return self.RasterizeConvexPolygon(rgptRect);
+    }
+
+    // Sides that don't span an integer y-value are dropped:
+
+    let nSubpixelYStart = (yTop + 15) >> 4;
+    let nSubpixelYEnd = (yBottom + 15) >> 4;
+
+    if (nSubpixelYEnd <= nSubpixelYStart)
+    {
+        return S_OK;
+    }
+
+    //
+    // Build the sides.  With no slope the DDA starts at the ceiling of the
+    // side's 'x', and neither advancing it to the first scanline nor
+    // clipping it at the top changes anything but StartY.
+    //
+
+    let dN = yBottom - yTop;
+
+    let Side = |x: INT, nWindingDirection: INT| -> CEdge {
+        let mut xStart = x;
+        let mut error: INT = -1;
+
+        if ((xStart & 15) != 0)
+        {
+            error -= dN * (16 - (xStart & 15));
+            xStart += 15;
+        }
+
+        CEdge {
+            X: Cell::new(xStart >> 4),
+            Dx: 0,
+            Error: Cell::new(error >> 4),
+            ErrorUp: 0,
+            ErrorDown: dN,
+            StartY: nSubpixelYStart.max(yClipTopInteger),
+            EndY: nSubpixelYEnd,
+            WindingDirection: nWindingDirection,
+            ..Default::default()
+        }
+    };
+
+    // The path goes down one side and up the other:
+
+    let iDown = (0..4).find(|&i| rgptRect[i].x == rgptRect[(i + 1) % 4].x && rgptRect[i].y < rgptRect[(i + 1) % 4].y).unwrap();
+    let fLeftDown = rgptRect[iDown].x == rgptRect[0].x.min(rgptRect[2].x);
+
+    let edgeDown = Side(if (fLeftDown) { xLeft } else { xRight }, 1);
+    let edgeUp = Side(if (fLeftDown) { xRight } else { xLeft }, -1);
+
+    let nSubpixelYBottom = nSubpixelYEnd.min(nPixelYClipBottom << self.GetSubpixelShift());
+
+    #[cfg(test)]
+    g_cRectangleWalks.with(|c| c.set(c.get() + 1));
+
+    let coverageBuffer: CCoverageBuffer = Default::default();
+    coverageBuffer.Initialize(self.AllocateCoverageIntervals());
+
+    hr = self.RasterizeConvexChains(
+        [&[Ref::new(&edgeDown)], &[Ref::new(&edgeUp)]],
+        &coverageBuffer,
+        nSubpixelYBottom
+        );
+
+    self.ReleaseCoverageIntervals(coverageBuffer.Destroy());
+
+    IFC!(hr);
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::RasterizeConvexPolygon
+//
+//  Synopsis:
+//      RasterizePath for a path that IsConvexPolygon has already
+//      transformed to 28.4.  There is nothing to enumerate or flatten, so
+//      the edges are built straight from the points.  Antialiased
+//      polygons are then walked down their two monotone chains by
+//      RasterizeConvexChains, without an active edge list.
+//
+//      When that doesn't apply (aliased rendering, trapezoid chaining, or
+//      clipping that broke up the chains), the inactive array is merged
+//      from the chains instead of being sorted, lives in a small local
+//      array, and goes through the usual sweep with the linked active list.
+//
+//      The edges are constructed by the same InitializeEdges call the
+//      general path makes, so the output is identical.
+//
+//-------------------------------------------------------------------------
+fn RasterizeConvexPolygon(
+    &mut self,
+    rgptPolygon: &[POINT]
+    ) -> HRESULT
+{
+    let mut hr;
+    let mut edgeHead: CEdge = Default::default();
+    let mut edgeTail: CEdge = Default::default();
+    let pEdgeActiveList: Ref<CEdge>;
+    let edgeStore = self.NewEdgeStore();
+    let mut edgeContext: CInitializeEdgesContext = CInitializeEdgesContext::new(&edgeStore);
+
+    edgeTail.X.set(i32::MAX);       // Terminator to active list
+    edgeTail.StartY = i32::MAX;  // Terminator to inactive list
+
+    edgeTail.EndY = i32::MIN;
+    edgeHead.X.set(i32::MIN);       // Beginning of active list
+    edgeContext.MaxY = i32::MIN;
+
+    edgeHead.Next.set(Ref::new(&edgeTail));
+    pEdgeActiveList = Ref::new(&mut edgeHead);
+
+    edgeContext.AntiAliasMode = self.m_antiAliasMode;
+
+    let nPixelYClipBottom: INT = self.m_rcClipBounds.Y + self.m_rcClipBounds.Height;
+
+    let clipBounds = self.GetSubpixelClipBounds();
+
+    edgeContext.ClipRect = Some(&clipBounds);
+
+    // Close the figure the way FixedPointPathEnumerate does:
+
+    let cPoints = rgptPolygon.len();
+    let mut rgpt: [POINT; CONVEX_POLYGON_POINT_MAX + 1] = [POINT::default(); CONVEX_POLYGON_POINT_MAX + 1];
+    rgpt[..cPoints].copy_from_slice(rgptPolygon);
+    rgpt[cPoints] = rgptPolygon[0];
+
+    hr = InitializeEdges(&mut edgeContext, &mut rgpt, cPoints as UINT + 1);
+
+    if (FAILED(hr))
+    {
+        if (hr == WGXERR_VALUEOVERFLOW)
+        {
+            // Draw nothing on value overflow and return
+            hr = S_OK;
+        }
+        return hr;
+    }
+
+    let nTotalCount: UINT = edgeContext.Store.len() as UINT;
+    if (nTotalCount == 0)
+    {
+        return S_OK;     // Entirely clipped
+    }
+
+    assert!((nTotalCount >= 2) && (nTotalCount as usize <= cPoints));
+
+    let nSubpixelYBottom = edgeContext.MaxY.min(nPixelYClipBottom << self.GetSubpixelShift());
+
+    let coverageBuffer: CCoverageBuffer = Default::default();
+    coverageBuffer.Initialize(self.AllocateCoverageIntervals());
+
+    let mut rgpEdgeDown: [Ref<CEdge>; CONVEX_POLYGON_POINT_MAX] = [unsafe { Ref::null() }; CONVEX_POLYGON_POINT_MAX];
+    let mut rgpEdgeUp: [Ref<CEdge>; CONVEX_POLYGON_POINT_MAX] = [unsafe { Ref::null() }; CONVEX_POLYGON_POINT_MAX];
+    let mut cEdgesDown = 0;
+    let mut cEdgesUp = 0;
+
+    if (self.m_antiAliasMode != MilAntiAliasMode::None
+        && self.m_nChainTolerance == 0
+        && GetConvexPolygonChains(edgeContext.Store, &mut rgpEdgeDown, &mut rgpEdgeUp, &mut cEdgesDown, &mut cEdgesUp))
+    {
+        hr = self.RasterizeConvexChains(
+            [&rgpEdgeDown[..cEdgesDown], &rgpEdgeUp[..cEdgesUp]],
+            &coverageBuffer,
+            nSubpixelYBottom
+            );
+
+        self.ReleaseCoverageIntervals(coverageBuffer.Destroy());
+
+        IFC!(hr);
+
+        return hr;
+    }
+
+    // Room for every side plus the head and tail sentinels
+    let mut inactiveArray: [CInactiveEdge; CONVEX_POLYGON_POINT_MAX + 2] = [(); CONVEX_POLYGON_POINT_MAX + 2].map(|_| Default::default());
+
+    let nSubpixelYCurrent = InitializeInactiveArrayFromConvexPolygon(
+        edgeContext.Store,
+        &mut inactiveArray,
+        nTotalCount,
+        Ref::new(&edgeTail)
+        );
+
+    assert!(nSubpixelYBottom > nSubpixelYCurrent);
+
+    if (self.m_antiAliasMode == MilAntiAliasMode::None)
+    {
+        hr = self.RasterizeAliasedEdges(
+            &mut CLinkedActiveEdgeList::new(pEdgeActiveList),
+            &mut inactiveArray[1..],
+            &coverageBuffer,
+            nSubpixelYCurrent,
+            nSubpixelYBottom
+            );
     }
     else
     {
-        matWorldHPCToDeviceIPC = CMatrix::Identity();
+        hr = self.RasterizeActiveEdges(
+            &mut CLinkedActiveEdgeList::new(pEdgeActiveList),
+            &mut inactiveArray[1..],
+            &coverageBuffer,
+            nSubpixelYCurrent,
+            nSubpixelYBottom
+            );
+    }
+
+    self.ReleaseCoverageIntervals(coverageBuffer.Destroy());
+
+    IFC!(hr);
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::RasterizeConvexChains
+//
+//  Synopsis:
+//      RasterizeActiveEdges for a polygon split into its downward and
+//      upward chains of edges by GetConvexPolygonChains.
+//
+//      Exactly one edge of each chain is active on every scanline, so
+//      rather than keeping an active edge list this walks down the two
+//      chains, stepping to the next edge of a chain at its vertex.  It
+//      outputs trapezoids between the vertices and complex scans only on
+//      the scanlines where a trapezoid can't start, which are those around
+//      the vertices and those where the polygon is too narrow.
+//
+//      The trapezoid checks and output are the ones RasterizeActiveEdges
+//      makes for the same pair of edges, so the output is identical.
+//
+//-------------------------------------------------------------------------
+fn RasterizeConvexChains<'a>(&mut self,
+    rgpEdgeChain: [&[Ref<'a, CEdge<'a>>]; 2],
+    coverageBuffer: &CCoverageBuffer,
+    nSubpixelYBottom: INT
+    ) -> HRESULT
+{
+    let hr: HRESULT = S_OK;
+    let mut rgiEdge: [usize; 2] = [0, 0];
+    let mut nSubpixelYCurrent: INT = rgpEdgeChain[0][0].StartY;
+    let mut nSubpixelYNext: INT;
+
+    assert!(rgpEdgeChain[1][0].StartY == nSubpixelYCurrent);
+    assert!(nSubpixelYBottom > nSubpixelYCurrent);
+
+    #[cfg(test)]
+    g_cConvexChainWalks.with(|c| c.set(c.get() + 1));
+
+    while (nSubpixelYCurrent < nSubpixelYBottom)
+    {
+        let pEdgeDown = rgpEdgeChain[0][rgiEdge[0]];
+        let pEdgeUp = rgpEdgeChain[1][rgiEdge[1]];
+
+        // Put the edges in active list order.  Edges at the same 'x' can't
+        // start a trapezoid and fill nothing, whichever way round they are.
+
+        let (pEdgeLeft, pEdgeRight) = if (pEdgeUp.X.get() < pEdgeDown.X.get())
+        {
+            (pEdgeUp, pEdgeDown)
+        }
+        else
+        {
+            (pEdgeDown, pEdgeUp)
+        };
+
+        // Where the next edge of either chain becomes active
+
+        let nSubpixelYNextVertex: INT = rgpEdgeChain[0].get(rgiEdge[0] + 1).map_or(INT::MAX, |pEdge| pEdge.StartY)
+            .min(rgpEdgeChain[1].get(rgiEdge[1] + 1).map_or(INT::MAX, |pEdge| pEdge.StartY));
+
+        //
+        // Detect trapezoidal case, as ComputeTrapezoidsEndScan does for
+        // the pair.  The chains wind in opposite directions, so winding
+        // mode can always be filled as alternate mode.
+        //
+
+        nSubpixelYNext = nSubpixelYCurrent;
+
+        if (!IsTagEnabled!(tagDisableTrapezoids)
+            && (nSubpixelYCurrent & c_nShiftMask) == 0
+            && nSubpixelYNextVertex >= nSubpixelYCurrent + c_nShiftSize)
+        {
+            nSubpixelYNext = Self::ComputeTrapezoidPairEndScan(
+                &*pEdgeLeft,
+                &*pEdgeRight,
+                nSubpixelYCurrent,
+                nSubpixelYNextVertex.min(pEdgeLeft.EndY)
+                );
+
+            if (nSubpixelYNext > nSubpixelYCurrent)
+            {
+                nSubpixelYNext = nSubpixelYNext.min(pEdgeRight.EndY) & (!c_nShiftMask);
+            }
+        }
+
+        if (nSubpixelYNext >= nSubpixelYCurrent + c_nShiftSize)
+        {
+            // Output the trapezoid, which also advances the DDA
+            IFC!(self.OutputTrapezoid(
+                &*pEdgeLeft,
+                &*pEdgeRight,
+                nSubpixelYCurrent,
+                nSubpixelYNext
+                ));
+        }
+        else
+        {
+            //
+            // Fall back to a complex scan
+            //
+
+            nSubpixelYNext = nSubpixelYCurrent + 1;
+
+            if (pEdgeLeft.X.get() != pEdgeRight.X.get())
+            {
+                IFC!(coverageBuffer.AddInterval(pEdgeLeft.X.get(), pEdgeRight.X.get()));
+            }
+
+            // If the next scan is done, output what's there:
+            if (nSubpixelYNext > (nSubpixelYCurrent | c_nShiftMask))
+            {
+                IFC!(self.GenerateOutputAndClearCoverage(coverageBuffer, nSubpixelYCurrent));
+            }
+
+            // Advance the DDA of the edges that stay active:
+            for pEdge in [pEdgeLeft, pEdgeRight]
+            {
+                if (pEdge.EndY > nSubpixelYNext)
+                {
+                    pEdge.X.set(pEdge.X.get() + pEdge.Dx);
+                    pEdge.Error.set(pEdge.Error.get() + pEdge.ErrorUp);
+                    if (pEdge.Error.get() >= 0)
+                    {
+                        pEdge.Error.set(pEdge.Error.get() - pEdge.ErrorDown);
+                        pEdge.X.set(pEdge.X.get() + 1);
+                    }
+                }
+            }
+        }
+
+        nSubpixelYCurrent = nSubpixelYNext;
+
+        // Step past the vertices we've reached.  The last edges of the
+        // chains end at or below nSubpixelYBottom.
+
+        for i in 0..2
+        {
+            if (rgpEdgeChain[i][rgiEdge[i]].EndY <= nSubpixelYCurrent && rgiEdge[i] + 1 < rgpEdgeChain[i].len())
+            {
+                rgiEdge[i] += 1;
+                assert!(rgpEdgeChain[i][rgiEdge[i]].StartY == nSubpixelYCurrent);
+            }
+        }
     }
-    matWorldHPCToDeviceIPC.SetDx(matWorldHPCToDeviceIPC.GetDx() - 0.5);
-    matWorldHPCToDeviceIPC.SetDy(matWorldHPCToDeviceIPC.GetDy() - 0.5);
 
     //
-    // Set local state.
+    // Output the last scanline that has partial coverage
     //
 
-    pD3DDevice.GetClipRect(&mut self.m_rcClipBounds);
+    if ((nSubpixelYCurrent & c_nShiftMask) != 0)
+    {
+        IFC!(self.GenerateOutputAndClearCoverage(coverageBuffer, nSubpixelYCurrent));
+    }
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::Setup
+//
+//  Synopsis:
+//      1. Ensure clean state
+//      2. Convert path to internal format
+//
+//-------------------------------------------------------------------------
+pub fn Setup(&mut self,
+    pD3DDevice: Rc<CD3DDeviceLevel1>,
+    pShape: Rc<dyn IShapeData>,
+    pmatWorldToDevice: Option<&CMatrix<CoordinateSpace::Shape,CoordinateSpace::Device>>
+    ) -> HRESULT
+{
+    let hr = S_OK;
+
+
+    //
+    // Initialize our state
+    //
+    self.m_rcClipBounds = Default::default();
+    self.m_pIGeometrySink = None;
+
+
+
+    self.m_pDeviceNoRef = Some(pD3DDevice.clone());
+
+    //
+    // PS#856364-2003/07/01-ashrafm  Remove pixel center fixup
+    //
+    // Incoming coordinate space uses integers at upper-left of pixel (pixel
+    // center are half integers) at device level.
+    //
+    // Rasterizer uses the coordinate space with integers at pixel center.
+    //
+    // To convert from center (1/2, 1/2) to center (0, 0) we need to subtract
+    // 1/2 from each coordinate in device space.
+    //
+    // See InitializeEdges in aarasterizer.ccp to see how we unconvert for
+    // antialiased rendering.
+    //
+
+    let mut matWorldHPCToDeviceIPC;
+    if let Some(pmatWorldToDevice) = pmatWorldToDevice
+    {
+        matWorldHPCToDeviceIPC = pmatWorldToDevice.clone();
+    }
+    else
+    {
+        matWorldHPCToDeviceIPC = CMatrix::Identity();
+    }
+    matWorldHPCToDeviceIPC.SetDx(matWorldHPCToDeviceIPC.GetDx() - 0.5);
+    matWorldHPCToDeviceIPC.SetDy(matWorldHPCToDeviceIPC.GetDy() - 0.5);
+
+    //
+    // Set local state.
+    //
+
+    pD3DDevice.GetClipRect(&mut self.m_rcClipBounds);
+
+    //IFC!(pShape.ConvertToGpPath(&mut *Rc::get_mut(self.m_prgPoints.as_mut().unwrap()).unwrap().borrow_mut(), &mut *Rc::get_mut(self.m_prgTypes.as_mut().unwrap()).unwrap().borrow_mut()));
+
+    self.m_matWorldToDevice = matWorldHPCToDeviceIPC;
+    self.m_fillMode = pShape.GetFillMode();
+
+    //  There's an opportunity for early clipping here
+    //
+    // However, since the rasterizer itself does a reasonable job of clipping some
+    // cases, we don't early clip yet.
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SendGeometry
+//
+//  Synopsis:
+//     Tessellate and send geometry to the pipeline
+//
+//-------------------------------------------------------------------------
+pub fn SendGeometry(&mut self,
+    pIGeometrySink: Rc<RefCell<CHwVertexBufferBuilder>>,
+    points: &[MilPoint2F],
+    types: &[BYTE],
+    ) -> HRESULT
+{
+    let mut hr = S_OK;
+
+    //
+    // It's ok not to addref the geometry sink here since it
+    // is never used outside the scope of this method.
+    //
+
+    self.m_pIGeometrySink = Some(pIGeometrySink.clone());
+
+    //
+    // Rasterize the path
+    //
+    IFR!(self.RasterizeGeometry(points, types));
+        /* 
+    IFC!(self.RasterizePath(
+        self.m_prgPoints.as_ref().unwrap().GetDataBuffer(),
+        self.m_prgTypes.as_ref().unwrap().GetDataBuffer(),
+        self.m_prgPoints.as_ref().unwrap().GetCount() as u32,
+        &self.m_matWorldToDevice,
+        self.m_fillMode
+        ));*/
+
+    //
+    // It's possible that we output no triangles.  For example, if we tried to fill a
+    // line instead of stroke it.  Since we have no efficient way to detect all these cases
+    // up front, we simply rasterize and see if we generated anything.
+    //
+
+    if (pIGeometrySink.borrow().IsEmpty())
+    {
+        hr = WGXHR_EMPTYFILL;
+    }
+
+    self.m_pIGeometrySink = None;
+
+    RRETURN1!(hr, WGXHR_EMPTYFILL);
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SendRectangles
+//
+//  Synopsis:
+//      Rasterize each rectangle in turn into the same geometry sink.  The
+//      rectangles are filled independently, so overlaps are not merged.
+//
+//-------------------------------------------------------------------------
+pub fn SendRectangles(&mut self,
+    pIGeometrySink: Rc<RefCell<CHwVertexBufferBuilder>>,
+    rgRects: &[MilPointAndSizeF],
+    ) -> HRESULT
+{
+    let mut hr = S_OK;
+    let rgTypes: [BYTE; 4] = [
+        PathPointTypeStart,
+        PathPointTypeLine,
+        PathPointTypeLine,
+        PathPointTypeLine | PathPointTypeCloseSubpath,
+        ];
+
+    self.m_pIGeometrySink = Some(pIGeometrySink.clone());
+
+    for rc in rgRects
+    {
+        let rgpt: [MilPoint2F; 4] = [
+            MilPoint2F { X: rc.X,            Y: rc.Y },
+            MilPoint2F { X: rc.X + rc.Width, Y: rc.Y },
+            MilPoint2F { X: rc.X + rc.Width, Y: rc.Y + rc.Height },
+            MilPoint2F { X: rc.X,            Y: rc.Y + rc.Height },
+            ];
+
+        IFR!(self.RasterizeGeometry(&rgpt, &rgTypes));
+    }
+
+    if (pIGeometrySink.borrow().IsEmpty())
+    {
+        hr = WGXHR_EMPTYFILL;
+    }
+
+    self.m_pIGeometrySink = None;
+
+    RRETURN1!(hr, WGXHR_EMPTYFILL);
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::RasterizeGeometry
+//
+//  Synopsis:
+//      Rasterize a path, taking the convex polygon fast path when the path
+//      is a single convex polygon, or the rectangle one when that polygon
+//      is an axis-aligned rectangle.
+//
+//-------------------------------------------------------------------------
+fn RasterizeGeometry(&mut self,
+    points: &[MilPoint2F],
+    types: &[BYTE],
+    ) -> HRESULT
+{
+    let mut rgptPolygon: [POINT; CONVEX_POLYGON_POINT_MAX] = Default::default();
+    let mut cPolygonPoints: usize = 0;
+
+    if (IsConvexPolygon(points, types, &self.m_matWorldToDevice, &mut rgptPolygon, &mut cPolygonPoints))
+    {
+        let rgptPolygon = &rgptPolygon[..cPolygonPoints];
+
+        if (self.m_antiAliasMode != MilAntiAliasMode::None && IsAxisAlignedRectangle(rgptPolygon))
+        {
+            return self.RasterizeRectangle(rgptPolygon);
+        }
+
+        return self.RasterizeConvexPolygon(rgptPolygon);
+    }
+
+    let count = points.len() as u32;
+    return self.RasterizePath(
+        points,
+        types,
+        count,
+        &self.m_matWorldToDevice.clone(),
+        );
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::BuildEdgeTable
+//
+//  Synopsis:
+//      Run the front half of RasterizePath (enumeration, flattening,
+//      clipping, edge construction and sorting) and serialize the
+//      resulting inactive edge array into 'table'.  The table can later
+//      be replayed with SendEdgeTable without touching the path again.
+//
+//-------------------------------------------------------------------------
+pub fn BuildEdgeTable(&mut self,
+    points: &[MilPoint2F],
+    types: &[BYTE],
+    table: &mut Vec<u8>,
+    ) -> HRESULT
+{
+    let mut hr = S_OK;
+    let mut edgeTail: CEdge = Default::default();
+    let clipBounds = self.GetSubpixelClipBounds();
+    let edgeStore = self.NewEdgeStore();
+    let mut edgeContext: CInitializeEdgesContext = CInitializeEdgesContext::new(&edgeStore);
+    let mut header: CEdgeTableHeader = Default::default();
+
+    header.FillMode = self.m_fillMode as INT;
+    header.ClipBounds = self.m_rcClipBounds.clone();
+
+    edgeTail.X.set(i32::MAX);
+    edgeTail.StartY = i32::MAX;
+    edgeTail.EndY = i32::MIN;
+    edgeContext.MaxY = i32::MIN;
+    edgeContext.AntiAliasMode = c_antiAliasMode;
+    edgeContext.SimplifyTolerance = self.m_nSimplifyTolerance;
+
+    if (points.len() >= 2)
+    {
+        edgeContext.ClipRect = Some(&clipBounds);
+
+        let mut matrix: CMILMatrix = self.m_matWorldToDevice.clone();
+        AppendScaleToMatrix(&mut matrix, TOREAL!(16), TOREAL!(16));
+
+        hr = MIL_THR!(FixedPointPathEnumerateInParallel(
+            points,
+            types,
+            points.len() as UINT,
+            &matrix,
+            edgeContext.ClipRect,
+            &mut edgeContext,
+            self.m_cEnumerateThreads
+            ));
+
+        if (FAILED(hr))
+        {
+            // A failed path draws nothing, so it is recorded as an empty
+            // table.  Value overflow isn't reported to the caller, the
+            // same as in RasterizePath.
+            if (hr == WGXERR_VALUEOVERFLOW)
+            {
+                hr = S_OK;
+            }
+        }
+        else
+        {
+            header.Count = edgeContext.Store.len() as UINT;
+        }
+    }
+
+    let mut inactiveArrayAllocation: Option<CInactiveArrayAllocation> = None;
+    let mut inactiveArray: &mut [CInactiveEdge] = &mut [];
+    if (header.Count != 0)
+    {
+        inactiveArray = self.AllocateInactiveArray(&mut inactiveArrayAllocation, header.Count as usize + 2);
+        InitializeInactiveArray(
+            edgeContext.Store,
+            inactiveArray,
+            header.Count,
+            Ref::new(&edgeTail)
+            );
+    }
+
+    SerializeEdgeTable(&header, inactiveArray, table);
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SendEdgeTable
+//
+//  Synopsis:
+//      Rasterize a table produced by BuildEdgeTable and send the
+//      geometry to the pipeline.  The clip bounds and fill mode are
+//      taken from Setup, which the caller should feed from the table
+//      header (see ReadEdgeTableHeader).
+//
+//-------------------------------------------------------------------------
+pub fn SendEdgeTable(&mut self,
+    pIGeometrySink: Rc<RefCell<CHwVertexBufferBuilder>>,
+    table: &[u8],
+    ) -> HRESULT
+{
+    let mut hr = S_OK;
+    let mut header: CEdgeTableHeader = Default::default();
+
+    IFR!(ReadEdgeTableHeader(table, &mut header));
+
+    if (header.Count != 0)
+    {
+        self.m_pIGeometrySink = Some(pIGeometrySink.clone());
+
+        hr = self.RasterizeEdgeTable(table, header.Count);
+
+        self.m_pIGeometrySink = None;
+
+        IFR!(hr);
+    }
+
+    if (pIGeometrySink.borrow().IsEmpty())
+    {
+        hr = WGXHR_EMPTYFILL;
+    }
+
+    RRETURN1!(hr, WGXHR_EMPTYFILL);
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::RasterizeEdgeTable
+//
+//  Synopsis:
+//      Counterpart of RasterizePath for a serialized edge table: load the
+//      presorted edges and go straight to the main rasterization loop.
+//
+//-------------------------------------------------------------------------
+fn RasterizeEdgeTable(
+    &mut self,
+    table: &[u8],
+    nTotalCount: UINT
+    ) -> HRESULT
+{
+    let mut hr = S_OK;
+    let mut inactiveArrayStack: [CInactiveEdge; INACTIVE_LIST_NUMBER!()] = [(); INACTIVE_LIST_NUMBER!()].map(|_| Default::default());
+    let mut pInactiveArray: &mut [CInactiveEdge];
+    let mut inactiveArrayAllocation: Option<CInactiveArrayAllocation> = None;
+    let mut edgeHead: CEdge = Default::default();
+    let mut edgeTail: CEdge = Default::default();
+    let pEdgeActiveList: Ref<CEdge>;
+    let edgeStore = self.NewEdgeStore();
+
+    edgeTail.X.set(i32::MAX);       // Terminator to active list
+    edgeTail.StartY = i32::MAX;  // Terminator to inactive list
+
+    edgeTail.EndY = i32::MIN;
+    edgeHead.X.set(i32::MIN);       // Beginning of active list
+
+    edgeHead.Next.set(Ref::new(&edgeTail));
+    pEdgeActiveList = Ref::new(&mut edgeHead);
+
+    let nPixelYClipBottom: INT = self.m_rcClipBounds.Y + self.m_rcClipBounds.Height;
+
+    pInactiveArray = &mut inactiveArrayStack[..];
+    if (nTotalCount > (INACTIVE_LIST_NUMBER!() as u32 - 2))
+    {
+        pInactiveArray = self.AllocateInactiveArray(&mut inactiveArrayAllocation, nTotalCount as usize + 2);
+    }
+
+    let mut nSubpixelYCurrent = 0;
+    let mut nSubpixelYBottom = 0;
+    IFR!(InitializeInactiveArrayFromTable(
+        table,
+        &edgeStore,
+        pInactiveArray,
+        nTotalCount,
+        Ref::new(&edgeTail),
+        &mut nSubpixelYCurrent,
+        &mut nSubpixelYBottom
+        ));
+
+    pInactiveArray = &mut pInactiveArray[1..];
+
+    nSubpixelYBottom = nSubpixelYBottom.min(nPixelYClipBottom << c_nShift);
+
+    let coverageBuffer: CCoverageBuffer = Default::default();
+    coverageBuffer.Initialize(self.AllocateCoverageIntervals());
+
+    // The table may have been built against a taller clip than the one
+    // we are replaying it with:
+
+    if (nSubpixelYBottom > nSubpixelYCurrent)
+    {
+        hr = self.RasterizeEdges(
+            pEdgeActiveList,
+            pInactiveArray,
+            nTotalCount,
+            &coverageBuffer,
+            nSubpixelYCurrent,
+            nSubpixelYBottom
+            );
+    }
+
+    self.ReleaseCoverageIntervals(coverageBuffer.Destroy());
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::NewEdgeStore
+//
+//  Synopsis:
+//      An edge store that reuses the blocks kept in the device's buffer
+//      dispenser, or a standalone one if there is no device.
+//
+//-------------------------------------------------------------------------
+fn NewEdgeStore<'a>(&self) -> CEdgeStore<'a>
+{
+    match &self.m_pDeviceNoRef
+    {
+        Some(pDevice) => CEdgeStore::with_device(pDevice.clone()),
+        None => CEdgeStore::new(),
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::AllocateInactiveArray
+//
+//  Synopsis:
+//      Get a heap inactive array of 'count' entries, reusing the
+//      allocation kept in the device's buffer dispenser if there is one.
+//      'allocation' keeps it for the caller and hands it back when it
+//      goes out of scope, on every return path.
+//
+//-------------------------------------------------------------------------
+fn AllocateInactiveArray<'a>(&self,
+    allocation: &'a mut Option<CInactiveArrayAllocation>,
+    count: usize
+    ) -> &'a mut [CInactiveEdge<'a>]
+{
+    let mut rgInactiveArray = match &self.m_pDeviceNoRef
+    {
+        Some(pDevice) =>
+        {
+            let mut bufferDispenser = pDevice.bufferDispenser.borrow_mut();
+            let allocator = bufferDispenser.m_allocator;
+            std::mem::replace(&mut bufferDispenser.m_rgInactiveArray, CTransientArray::new(allocator))
+        }
+        None => Default::default(),
+    };
+    rgInactiveArray.resize(count, Default::default());
+
+    let allocation = allocation.insert(CInactiveArrayAllocation {
+        m_pDeviceNoRef: self.m_pDeviceNoRef.clone(),
+        m_rgInactiveArray: rgInactiveArray,
+    });
+
+    // The entries may point at edges that live at least as long as the
+    // borrow of 'allocation'.  They are cleared before the array is
+    // looked at again as an array of CInactiveEdge<'static>.
+    let rgInactiveArray = &mut allocation.m_rgInactiveArray;
+    return unsafe {
+        std::slice::from_raw_parts_mut(
+            rgInactiveArray.as_mut_ptr() as *mut CInactiveEdge<'a>,
+            rgInactiveArray.len()
+            )
+    };
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::AllocateActiveEdgeArrayBuffers
+//
+//  Synopsis:
+//      Get the buffers for a CActiveEdgeArray, reusing the ones kept in
+//      the device's buffer dispenser if there are any.
+//
+//-------------------------------------------------------------------------
+fn AllocateActiveEdgeArrayBuffers(&self) -> CActiveEdgeArrayBuffers
+{
+    match &self.m_pDeviceNoRef
+    {
+        Some(pDevice) =>
+        {
+            let mut bufferDispenser = pDevice.bufferDispenser.borrow_mut();
+            let allocator = bufferDispenser.m_allocator;
+            std::mem::replace(&mut bufferDispenser.m_activeEdgeArrayBuffers, CActiveEdgeArrayBuffers::new(allocator))
+        }
+        None => Default::default(),
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::ReleaseActiveEdgeArrayBuffers
+//
+//  Synopsis:
+//      Keep the emptied buffers of a CActiveEdgeArray in the device's
+//      buffer dispenser for the next path.
+//
+//-------------------------------------------------------------------------
+fn ReleaseActiveEdgeArrayBuffers(&self, buffers: CActiveEdgeArrayBuffers)
+{
+    if let Some(pDevice) = &self.m_pDeviceNoRef
+    {
+        pDevice.bufferDispenser.borrow_mut().m_activeEdgeArrayBuffers = buffers;
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::AllocateAliasedSpans
+//
+//  Synopsis:
+//      Get the two span arrays for RasterizeAliasedEdges, reusing the
+//      ones kept in the device's buffer dispenser if there are any.
+//
+//-------------------------------------------------------------------------
+fn AllocateAliasedSpans(&self) -> (CTransientArray<(INT, INT)>, CTransientArray<(INT, INT)>)
+{
+    match &self.m_pDeviceNoRef
+    {
+        Some(pDevice) =>
+        {
+            let mut bufferDispenser = pDevice.bufferDispenser.borrow_mut();
+            let allocator = bufferDispenser.m_allocator;
+            (
+                std::mem::replace(&mut bufferDispenser.m_rgAliasedSpanRun, CTransientArray::new(allocator)),
+                std::mem::replace(&mut bufferDispenser.m_rgAliasedSpan, CTransientArray::new(allocator)),
+            )
+        }
+        None => Default::default(),
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::ReleaseAliasedSpans
+//
+//  Synopsis:
+//      Hand the span arrays back to the device's buffer dispenser.
+//
+//-------------------------------------------------------------------------
+fn ReleaseAliasedSpans(&self,
+    mut rgSpanRun: CTransientArray<(INT, INT)>,
+    mut rgSpan: CTransientArray<(INT, INT)>
+    )
+{
+    if let Some(pDevice) = &self.m_pDeviceNoRef
+    {
+        rgSpanRun.clear();
+        rgSpan.clear();
+        let mut bufferDispenser = pDevice.bufferDispenser.borrow_mut();
+        bufferDispenser.m_rgAliasedSpanRun = rgSpanRun;
+        bufferDispenser.m_rgAliasedSpan = rgSpan;
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::AllocateCoverageIntervals
+//
+//  Synopsis:
+//      Get the interval array for the coverage buffer, reusing the one
+//      kept in the device's buffer dispenser if there is one.
+//
+//-------------------------------------------------------------------------
+fn AllocateCoverageIntervals(&self) -> CTransientArray<CCoverageInterval>
+{
+    match &self.m_pDeviceNoRef
+    {
+        Some(pDevice) =>
+        {
+            let mut bufferDispenser = pDevice.bufferDispenser.borrow_mut();
+            let allocator = bufferDispenser.m_allocator;
+            std::mem::replace(&mut bufferDispenser.m_rgCoverageInterval, CTransientArray::new(allocator))
+        }
+        None => Default::default(),
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::ReleaseCoverageIntervals
+//
+//  Synopsis:
+//      Keep the coverage buffer's interval array in the device's buffer
+//      dispenser for the next call.
+//
+//-------------------------------------------------------------------------
+fn ReleaseCoverageIntervals(&self, rgInterval: CTransientArray<CCoverageInterval>)
+{
+    if let Some(pDevice) = &self.m_pDeviceNoRef
+    {
+        pDevice.bufferDispenser.borrow_mut().m_rgCoverageInterval = rgInterval;
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SetSimplifyTolerance
+//
+//  Synopsis:
+//      Let path enumeration drop vertices that are within 'rTolerance'
+//      device pixels of the simplified path.  0 keeps every vertex.
+//
+//-------------------------------------------------------------------------
+pub fn SetSimplifyTolerance(&mut self, rTolerance: FLOAT)
+{
+    self.m_nSimplifyTolerance = if (rTolerance > 0.)
+    {
+        (rTolerance * FIX4_ONE!() as FLOAT).min(INT::MAX as FLOAT) as INT
+    }
+    else
+    {
+        0
+    };
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SetTrapezoidChainTolerance
+//
+//  Synopsis:
+//      Let trapezoids continue across edge joints that are within
+//      'rTolerance' device pixels of the trapezoid's side.  0 keeps
+//      trapezoids within single edges.
+//
+//-------------------------------------------------------------------------
+pub fn SetTrapezoidChainTolerance(&mut self, rTolerance: FLOAT)
+{
+    self.m_nChainTolerance = if (rTolerance > 0.)
+    {
+        (rTolerance * c_nShiftSize as FLOAT).min(INT::MAX as FLOAT).max(1.) as INT
+    }
+    else
+    {
+        0
+    };
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SetEnumerateThreads
+//
+//  Synopsis:
+//      Let path enumeration (flattening and edge construction) spread
+//      the subpaths over up to 'cThreads' threads, see
+//      FixedPointPathEnumerateInParallel.  Paths that are too small to
+//      benefit stay on the calling thread.
+//
+//-------------------------------------------------------------------------
+pub fn SetEnumerateThreads(&mut self, cThreads: usize)
+{
+    self.m_cEnumerateThreads = cThreads.max(1);
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SetAntiAliasMode
+//
+//  Synopsis:
+//      Choose between 8x8 anti-aliasing (c_antiAliasMode, the default) and
+//      MilAntiAliasMode::None, which samples each pixel once at its center
+//      and only generates full coverage.  Edge tables are always built
+//      for anti-aliasing.
+//
+//-------------------------------------------------------------------------
+pub fn SetAntiAliasMode(&mut self, antiAliasMode: MilAntiAliasMode)
+{
+    self.m_antiAliasMode = antiAliasMode;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::GetSubpixelShift
+//
+//  Synopsis:
+//      The shift from pixels to the units InitializeEdges produces for
+//      the current anti-alias mode.  Without anti-aliasing the sweep is
+//      in whole pixels.
+//
+//-------------------------------------------------------------------------
+fn GetSubpixelShift(&self) -> INT
+{
+    if (self.m_antiAliasMode == MilAntiAliasMode::None) { 0 } else { c_nShift }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::GetSubpixelClipBounds
+//
+//  Synopsis:
+//      Scale the clip bounds rectangle by 16 to account for our
+//      scaling to 28.4 coordinates.
+//
+//-------------------------------------------------------------------------
+fn GetSubpixelClipBounds(&self) -> RECT
+{
+    let mut clipBounds : RECT = Default::default();
+    clipBounds.left   = self.m_rcClipBounds.X * FIX4_ONE!();
+    clipBounds.top    = self.m_rcClipBounds.Y * FIX4_ONE!();
+    clipBounds.right  = (self.m_rcClipBounds.X + self.m_rcClipBounds.Width) * FIX4_ONE!();
+    clipBounds.bottom = (self.m_rcClipBounds.Y + self.m_rcClipBounds.Height) * FIX4_ONE!();
+    return clipBounds;
+}
+/*
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::SendGeometryModifiers
+//
+//  Synopsis:   Send an AA color source to the pipeline.
+//
+//-------------------------------------------------------------------------
+fn SendGeometryModifiers(&self,
+    pPipelineBuilder: &mut CHwPipelineBuilder
+    ) -> HRESULT
+{
+    let hr = S_OK;
+
+    let pAntiAliasColorSource = None;
+
+    self.m_pDeviceNoRef.GetColorComponentSource(
+        CHwColorComponentSource::Diffuse,
+        &pAntiAliasColorSource
+        );
+
+    IFC!(pPipelineBuilder.Set_AAColorSource(
+        pAntiAliasColorSource
+        ));
+
+    return hr;
+}*/
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::GenerateOutputAndClearCoverage
+//
+//  Synopsis:
+//      Collapse output and generate span data
+//
+//-------------------------------------------------------------------------
+fn
+GenerateOutputAndClearCoverage(&mut self, coverageBuffer: &CCoverageBuffer,
+    nSubpixelY: INT
+    ) -> HRESULT
+{
+    let hr = S_OK;
+    let nPixelY = nSubpixelY >> c_nShift;
+
+    IFC!(self.m_pIGeometrySink.as_ref().unwrap().borrow_mut().AddComplexScan(nPixelY, &coverageBuffer.m_rgInterval.borrow()));
+
+    coverageBuffer.Reset();
+
+    return hr;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::ComputeTrapezoidsEndScan
+//
+//  Synopsis:
+//      This methods takes the current active edge list (and ycurrent)
+//      and will determine:
+//
+//      1. Can we output some list of simple trapezoids for this active
+//         edge list?  If the answer is no, then we simply return
+//         nSubpixelYCurrent indicating this condition.
+//
+//      2. If we can output some set of trapezoids, then what is the
+//         next ycurrent, i.e., how tall are our trapezoids.
+//
+//     Note that all trapezoids output for a particular active edge list
+//     are all the same height.
+//
+//     To further understand the conditions for making this decision, it
+//     is important to consider the simple trapezoid tessellation:
+//
+//           ___+_________________+___
+//          /  +  /             \  +  \        '+' marks active edges
+//         /  +  /               \  +  \
+//        /  +  /                 \  +  \
+//       /__+__/___________________\__+__\
+//       1+1/m                         +
+//
+//      Note that 1+1/edge_slope is the required expand distance to ensure
+//      that we cover all pixels required.
+//
+//      Now, we can fail to output any trapezoids under the following conditions:
+//         1. The expand regions along the top edge of the trapezoid overlap.
+//         2. The expand regions along the bottom edge of the trapezoid overlap
+//            within the current scanline.  Note that if the bottom edges overlap
+//            at some later point, we can shorten our trapezoid to remove the
+//            overlapping.
+//
+//      The key to the algorithm at this point is to detect the above condition
+//      in our active edge list and either update the returned end y position
+//      or reject all together based on overlapping.
+//
+//-------------------------------------------------------------------------
+
+fn ComputeTrapezoidsEndScan<'a>(&mut self,
+    activeList: &impl IActiveEdgeList<'a>,
+    pEdgeCurrent: Ref<'a, CEdge<'a>>,
+    nSubpixelYCurrent: INT,
+    nSubpixelYNextInactive: INT
+    ) -> INT
+{
+
+    let mut nSubpixelYBottomTrapezoids;
+    let mut pEdgeLeft: Ref<CEdge>;
+    let mut pEdgeRight: Ref<CEdge>;
+
+    //
+    // Trapezoids should always start at scanline boundaries
+    //
+
+    assert!((nSubpixelYCurrent & c_nShiftMask) == 0);
+
+    //
+    // If we are doing a winding mode fill, check that we can ignore mode and do an
+    // alternating fill in OutputTrapezoids.  This condition occurs when winding is
+    // equivalent to alternating which happens if the pairwise edges have different
+    // winding directions.
+    //
+
+    if (self.m_fillMode == MilFillMode::Winding)
+    {
+        cfor!{let mut pEdge = pEdgeCurrent; (*pEdge).EndY != INT::MIN; pEdge = activeList.Next(activeList.Next(pEdge));
+        {
+            // The active edge list always has an even number of edges which we actually
+            // assert in ASSERTACTIVELIST.
+
+            assert!((*activeList.Next(pEdge)).EndY != INT::MIN);
+
+            // If not alternating winding direction, we can't fill with alternate mode
+
+            if ((*pEdge).WindingDirection == (*activeList.Next(pEdge)).WindingDirection)
+            {
+                // Give up until we handle winding mode
+                nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
+                return nSubpixelYBottomTrapezoids;
+            }
+        }}
+    }
+
+    //
+    // For each edge, we:
+    //
+    //    1. Set the new trapezoid bottom to the min of the current
+    //       one and the edge EndY
+    //
+    //    2. Check if edges will intersect during trapezoidal shrink/expand
+    //
+
+    nSubpixelYBottomTrapezoids = nSubpixelYNextInactive;
+
+    cfor!{let mut pEdge = pEdgeCurrent; (*pEdge).EndY != INT::MIN; pEdge = activeList.Next(pEdge); 
+    {
+        //
+        // Step 1
+        //
+        // Updated nSubpixelYBottomTrapezoids based on edge EndY.
+        //
+        // Since edges are clipped to the current clip rect y bounds, we also know
+        // that pEdge->EndY <= nSubpixelYBottom so there is no need to check for that here.
+        //
+
+        nSubpixelYBottomTrapezoids = nSubpixelYBottomTrapezoids.min((*pEdge).EndY);
+
+        //
+        // Step 2
+        //
+        // Check that edges will not overlap during trapezoid shrink/expand.
+        //
+
+        pEdgeLeft = pEdge;
+        pEdgeRight = activeList.Next(pEdge);
+
+        if ((*pEdgeRight).EndY != INT::MIN)
+        {
+            nSubpixelYBottomTrapezoids = Self::ComputeTrapezoidPairEndScan(
+                &*pEdgeLeft,
+                &*pEdgeRight,
+                nSubpixelYCurrent,
+                nSubpixelYBottomTrapezoids
+                );
+
+            if (nSubpixelYBottomTrapezoids == nSubpixelYCurrent)
+            {
+                // This pair can't start a trapezoid on this scanline
+                return nSubpixelYBottomTrapezoids;
+            }
+        }
+    }};
+
+    //
+    // Snap to pixel boundary
+    //
+
+    nSubpixelYBottomTrapezoids = nSubpixelYBottomTrapezoids & (!c_nShiftMask);
+
+    //
+    // Ensure that we are never less than nSubpixelYCurrent
+    //
+
+    assert!(nSubpixelYBottomTrapezoids >= nSubpixelYCurrent);
+
+    //
+    // Return trapezoid end scan
+    //
+
+//Cleanup:
+    return nSubpixelYBottomTrapezoids;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::ComputeNoCoverageEndScan
+//
+//  Synopsis:
+//      Check whether the active edges give no coverage from
+//      nSubpixelYCurrent until one of them ends or nSubpixelYEnd, e.g.
+//      when they are all edges outside the clip that InitializeEdges
+//      moved onto its sides.  Returns the end of that stretch, or
+//      nSubpixelYCurrent if they may give coverage.
+//
+//      The edges are split into runs that stay on top of each other (see
+//      EdgesMoveTogether).  If each run leaves the winding or the parity
+//      unchanged, the fill rule never sees a span between them.  The
+//      runs must also keep their order, so that advancing them in one go
+//      leaves the active edge list sorted.
+//
+//-------------------------------------------------------------------------
+fn ComputeNoCoverageEndScan<'a>(&self,
+    activeList: &impl IActiveEdgeList<'a>,
+    nSubpixelYCurrent: INT,
+    nSubpixelYEnd: INT
+    ) -> INT
+{
+    let mut nSubpixelYEndScan = nSubpixelYEnd;
+    let mut pEdge = activeList.Next(activeList.Head());
+
+    while ((*pEdge).EndY != INT::MIN)
+    {
+        let pEdgeFirst = pEdge;
+        let mut cEdges = 0;
+        let mut nWinding = 0;
+
+        while ((*pEdge).EndY != INT::MIN && EdgesMoveTogether(&*pEdgeFirst, &*pEdge))
+        {
+            cEdges += 1;
+            nWinding += (*pEdge).WindingDirection;
+            nSubpixelYEndScan = nSubpixelYEndScan.min((*pEdge).EndY);
+            pEdge = activeList.Next(pEdge);
+        }
+
+        let fNoSpan = if (self.m_fillMode == MilFillMode::Alternate) { (cEdges & 1) == 0 } else { nWinding == 0 };
+
+        if (!fNoSpan)
+        {
+            return nSubpixelYCurrent;
+        }
+    }
+
+    //
+    // Check that the edges are still in order on the last row of the
+    // stretch.  Their DDAs are lines, so they are then in order all the
+    // way down.  Stepping on to the end itself is left to
+    // AdvanceDDAAndUpdate, which drops the edges that end there and sorts
+    // the rest.
+    //
+
+    assert!(nSubpixelYEndScan > nSubpixelYCurrent);
+
+    let nSubpixelYAdvance = nSubpixelYEndScan - 1 - nSubpixelYCurrent;
+    let mut nSubpixelXPreviousBottom = INT::MIN;
+    let mut pEdgeLeft = activeList.Next(activeList.Head());
+
+    while ((*pEdgeLeft).EndY != INT::MIN)
+    {
+        let pEdgeRight = activeList.Next(pEdgeLeft);
+
+        let mut nSubpixelXLeftBottom = 0;
+        let mut nSubpixelErrorLeftBottom = 0;
+        let mut nSubpixelXRightBottom = 0;
+        let mut nSubpixelErrorRightBottom = 0;
+
+        AdvanceDDAMultipleSteps(
+            &*pEdgeLeft,
+            &*pEdgeRight,
+            nSubpixelYAdvance,
+            &mut nSubpixelXLeftBottom,
+            &mut nSubpixelErrorLeftBottom,
+            &mut nSubpixelXRightBottom,
+            &mut nSubpixelErrorRightBottom
+            );
+
+        if (nSubpixelXLeftBottom < nSubpixelXPreviousBottom || nSubpixelXRightBottom < nSubpixelXLeftBottom)
+        {
+            return nSubpixelYCurrent;
+        }
+
+        nSubpixelXPreviousBottom = nSubpixelXRightBottom;
+        pEdgeLeft = activeList.Next(pEdgeRight);
+    }
+
+    return nSubpixelYEndScan;
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::ComputeTrapezoidPairEndScan
+//
+//  Synopsis:
+//      Step 2 of ComputeTrapezoidsEndScan for one pair of adjacent active
+//      edges: check that the pair doesn't overlap during trapezoid
+//      shrink/expand before nSubpixelYBottomTrapezoids, shortening it if
+//      the edges converge.  Returns the new trapezoid bottom, or
+//      nSubpixelYCurrent if the pair can't start a trapezoid.
+//
+//-------------------------------------------------------------------------
+fn ComputeTrapezoidPairEndScan(
+    pEdgeLeft: &CEdge,
+    pEdgeRight: &CEdge,
+    nSubpixelYCurrent: INT,
+    mut nSubpixelYBottomTrapezoids: INT
+    ) -> INT
+{
+    //
+    //        __A__A'___________________B'_B__
+    //        \  +  \                  /  +  /       '+' marks active edges
+    //         \  +  \                /  +  /
+    //          \  +  \              /  +  /
+    //           \__+__\____________/__+__/
+    //       1+1/m   C  C'         D' D
+    //
+    // We need to determine if position A' <= position B' and that position C' <= position D'
+    // in the above diagram.  So, we need to ensure that both the distance between
+    // A and B and the distance between C and D is greater than or equal to:
+    //
+    //    0.5 + |0.5/m1| + 0.5 + |0.5/m2|               (pixel space)
+    //  = shiftsize + halfshiftsize*(|1/m1| + |1/m2|)   (subpixel space)
+    //
+    // So, we'll start by computing this distance.  Note that we can compute a distance
+    // that is too large here since the self-intersection detection is simply used to
+    // recognize trapezoid opportunities and isn't required for visual correctness.
+    //
+
+    let nSubpixelExpandDistanceUpperBound: INT =
+        c_nShiftSize
+        + ComputeDeltaUpperBound(&*pEdgeLeft, c_nHalfShiftSize)
+        + ComputeDeltaUpperBound(&*pEdgeRight, c_nHalfShiftSize);
+
+    //
+    // Compute a top edge distance that is <= to the distance between A' and B' as follows:
+    //   lowerbound(distance(A, B)) - nSubpixelExpandDistanceUpperBound
+    //
+
+    let nSubpixelXTopDistanceLowerBound: INT =
+        ComputeDistanceLowerBound(&*pEdgeLeft, &*pEdgeRight) - nSubpixelExpandDistanceUpperBound;
+
+    //
+    // Check if the top edges cross
+    //
+
+    if (nSubpixelXTopDistanceLowerBound < 0)
+    {
+        // The top edges have crossed, so we are out of luck.  We can't
+        // start a trapezoid on this scanline
+
+        nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
+        return nSubpixelYBottomTrapezoids;
+    }
+
+    //
+    // If the edges are converging, we need to check if they cross at
+    // nSubpixelYBottomTrapezoids
+    //
+    //
+    //  1) \       /    2) \    \       3)   /   /
+    //      \     /          \   \          /  /
+    //       \   /             \  \        / /
+    //
+    // The edges converge iff (dx1 > dx2 || (dx1 == dx2 && errorUp1/errorDown1 > errorUp2/errorDown2).
+    //
+    // Note that in the case where the edges do not converge, the code below will end up computing
+    // the DDA at the end points and checking for intersection again.  This code doesn't rely on
+    // the fact that the edges don't converge, so we can be too conservative here.
+    //
+
+    if ((*pEdgeLeft).Dx > (*pEdgeRight).Dx
+        || (((*pEdgeLeft).Dx == (*pEdgeRight).Dx)
+            && IsFractionGreaterThan((*pEdgeLeft).ErrorUp, (*pEdgeLeft).ErrorDown, (*pEdgeRight).ErrorUp, (*pEdgeRight).ErrorDown)))
+    {
+
+        let nSubpixelYAdvance: INT =  nSubpixelYBottomTrapezoids - nSubpixelYCurrent;
+        assert!(nSubpixelYAdvance > 0);
+
+        //
+        // Compute the edge position at nSubpixelYBottomTrapezoids
+        //
+
+        let mut nSubpixelXLeftAdjustedBottom = 0;
+        let mut nSubpixelErrorLeftBottom = 0;
+        let mut nSubpixelXRightBottom = 0;
+        let mut nSubpixelErrorRightBottom = 0;
+
+        AdvanceDDAMultipleSteps(
+            &*pEdgeLeft,
+            &*pEdgeRight,
+            nSubpixelYAdvance,
+            &mut nSubpixelXLeftAdjustedBottom,
+            &mut nSubpixelErrorLeftBottom,
+            &mut nSubpixelXRightBottom,
+            &mut nSubpixelErrorRightBottom
+            );
+
+        //
+        // Adjust the bottom left position by the expand distance for all the math
+        // that follows.  Note that since we adjusted the top distance by that
+        // same expand distance, this adjustment is equivalent to moving the edges
+        // nSubpixelExpandDistanceUpperBound closer together.
+        //
+
+        nSubpixelXLeftAdjustedBottom += nSubpixelExpandDistanceUpperBound;
+
+        //
+        // Check if the bottom edge crosses.
+        //
+        // To avoid checking error1/errDown1 and error2/errDown2, we assume the
+        // edges cross if nSubpixelXLeftAdjustedBottom == nSubpixelXRightBottom
+        // and thus produce a result that is too conservative.
+        //
+
+        if (nSubpixelXLeftAdjustedBottom >= nSubpixelXRightBottom)
+        {
+
+            //
+            // At this point, we have the following scenario
+            //
+            //            ____d1____
+            //            \        /   |   |
+            //              \    /     h1  |
+            //                \/       |   | nSubpixelYAdvance
+            //               /  \          |
+            //             /__d2__\        |
+            //
+            // We want to compute h1.  We know that:
+            //
+            //     h1 / nSubpixelYAdvance = d1 / (d1 + d2)
+            //     h1 = nSubpixelYAdvance * d1 / (d1 + d2)
+            //
+            // Now, if we approximate d1 with some d1' <= d1, we get
+            //
+            //     h1 = nSubpixelYAdvance * d1 / (d1 + d2)
+            //     h1 >= nSubpixelYAdvance * d1' / (d1' + d2)
+            //
+            // Similarly, if we approximate d2 with some d2' >= d2, we get
+            //
+            //     h1 >= nSubpixelYAdvance * d1' / (d1' + d2)
+            //        >= nSubpixelYAdvance * d1' / (d1' + d2')
+            //
+            // Since we are allowed to be too conservative with h1 (it can be
+            // less than the actual value), we'll construct such approximations
+            // for simplicity.
+            //
+            // Note that d1' = nSubpixelXTopDistanceLowerBound which we have already
+            // computed.
+            //
+            //      d2 = (x1 + error1/errorDown1) - (x2 + error2/errorDown2)
+            //         = x1 - x2 + error1/errorDown1 - error2/errorDown2
+            //         <= x1 - x2 - error2/errorDown2   , since error1 < 0
+            //         <= x1 - x2 + 1                   , since error2 < 0
+            //         = nSubpixelXLeftAdjustedBottom - nSubpixelXRightBottom + 1
+            //
+
+            let nSubpixelXBottomDistanceUpperBound: INT = nSubpixelXLeftAdjustedBottom - nSubpixelXRightBottom + 1;
+
+            assert!(nSubpixelXTopDistanceLowerBound >= 0);
+            assert!(nSubpixelXBottomDistanceUpperBound > 0);
+
+            #[cfg(debug_assertions)]
+            let nDbgPreviousSubpixelXBottomTrapezoids: INT = nSubpixelYBottomTrapezoids;
+
+
+            nSubpixelYBottomTrapezoids =
+                nSubpixelYCurrent +
+                (nSubpixelYAdvance * nSubpixelXTopDistanceLowerBound) /
+                (nSubpixelXTopDistanceLowerBound + nSubpixelXBottomDistanceUpperBound);
+
+            #[cfg(debug_assertions)]
+            assert!(nDbgPreviousSubpixelXBottomTrapezoids >= nSubpixelYBottomTrapezoids);
+
+            if (nSubpixelYBottomTrapezoids < nSubpixelYCurrent + c_nShiftSize)
+            {
+                // We no longer have a trapezoid that is at least one scanline high, so
+                // abort
+
+                nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
+                return nSubpixelYBottomTrapezoids;
+            }
+        }
+    }
+
+    return nSubpixelYBottomTrapezoids;
+}
+
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::OutputTrapezoids
+//
+//  Synopsis:
+//      Given the current active edge list, output a list of
+//      trapezoids.
+//
+//      _________________________
+//     /     /             \     \
+//    /     /               \     \
+//   /     /                 \     \
+//  /_____/___________________\_____\
+//  1+1/m
+//
+// We output a trapezoid where the distance in X is 1+1/m slope on either edge.
+// Note that we actually do a linear interpolation for coverage along the
+// entire falloff region which comes within 12.5% error when compared to our
+// 8x8 coverage output for complex scans.  What is happening here is
+// that we are applying a linear approximation to the coverage function
+// based on slope.  It is possible to get better linear interpolations
+// by varying the expanded region, but it hasn't been necessary to apply
+// these quality improvements yet.
+//
+//-------------------------------------------------------------------------
+fn 
+OutputTrapezoids<'a>(&mut self,
+    activeList: &impl IActiveEdgeList<'a>,
+    pEdgeCurrent: Ref<'a, CEdge<'a>>,
+    nSubpixelYCurrent: INT, // inclusive
+    nSubpixelYNext: INT     // exclusive
+    ) -> HRESULT
+{
+
+    let hr = S_OK;
+
+    let mut pEdgeLeft = pEdgeCurrent;
+    let mut pEdgeRight = activeList.Next(pEdgeCurrent);
+
+    assert!((nSubpixelYCurrent & c_nShiftMask) == 0);
+    assert!((*pEdgeLeft).EndY != INT::MIN);
+    assert!((*pEdgeRight).EndY != INT::MIN);
+
+    //
+    // Output each trapezoid
+    //
+
+    loop
+    {
+        IFC!(self.OutputTrapezoid(
+            &*pEdgeLeft,
+            &*pEdgeRight,
+            nSubpixelYCurrent,
+            nSubpixelYNext
+            ));
+
+        //
+        // Check for termination
+        //
+
+        if ((*activeList.Next(pEdgeRight)).EndY == INT::MIN)
+        {
+            break;
+        }
 
-    //IFC!(pShape.ConvertToGpPath(&mut *Rc::get_mut(self.m_prgPoints.as_mut().unwrap()).unwrap().borrow_mut(), &mut *Rc::get_mut(self.m_prgTypes.as_mut().unwrap()).unwrap().borrow_mut()));
+        //
+        // Advance edge data
+        //
 
-    self.m_matWorldToDevice = matWorldHPCToDeviceIPC;
-    self.m_fillMode = pShape.GetFillMode();
+        pEdgeLeft  = activeList.Next(pEdgeRight);
+        pEdgeRight = activeList.Next(pEdgeLeft);
 
-    //  There's an opportunity for early clipping here
-    //
-    // However, since the rasterizer itself does a reasonable job of clipping some
-    // cases, we don't early clip yet.
+    }
 
     return hr;
+
 }
 
 //-------------------------------------------------------------------------
 //
-//  Function:   CHwRasterizer::SendGeometry
+//  Function:   CHwRasterizer::OutputTrapezoid
 //
 //  Synopsis:
-//     Tessellate and send geometry to the pipeline
+//      Output the trapezoid between one pair of edges for OutputTrapezoids,
+//      and advance the pair's x/error to nSubpixelYNext.
 //
 //-------------------------------------------------------------------------
-pub fn SendGeometry(&mut self,
-    pIGeometrySink: Rc<RefCell<CHwVertexBufferBuilder>>,
-    points: &[MilPoint2F],
-    types: &[BYTE],
+fn OutputTrapezoid(&mut self,
+    pEdgeLeft: &CEdge,
+    pEdgeRight: &CEdge,
+    nSubpixelYCurrent: INT, // inclusive
+    nSubpixelYNext: INT     // exclusive
     ) -> HRESULT
 {
-    let mut hr = S_OK;
+    let hr = S_OK;
+    let nSubpixelYAdvance: INT = nSubpixelYNext - nSubpixelYCurrent;
+
+    let rSubpixelLeftErrorDown: f32;
+    let rSubpixelRightErrorDown: f32;
+    let rPixelXLeft: f32;
+    let rPixelXRight: f32;
+    let rSubpixelLeftInvSlope: f32;
+    let rSubpixelLeftAbsInvSlope: f32;
+    let rSubpixelRightInvSlope: f32;
+    let rSubpixelRightAbsInvSlope: f32;
+    let rPixelXLeftDelta: f32;
+    let rPixelXRightDelta: f32;
+
+    //
+    // Compute x/error for end of trapezoid
+    //
+
+    let mut nSubpixelXLeftBottom: INT = 0;
+    let mut nSubpixelErrorLeftBottom: INT = 0;
+    let mut nSubpixelXRightBottom: INT = 0;
+    let mut nSubpixelErrorRightBottom: INT = 0;
+
+    AdvanceDDAMultipleSteps(
+        &*pEdgeLeft,
+        &*pEdgeRight,
+        nSubpixelYAdvance,
+        &mut nSubpixelXLeftBottom,
+        &mut nSubpixelErrorLeftBottom,
+        &mut nSubpixelXRightBottom,
+        &mut nSubpixelErrorRightBottom
+        );
 
-    //
-    // It's ok not to addref the geometry sink here since it
-    // is never used outside the scope of this method.
-    //
+    // The above computation should ensure that we are a simple
+    // trapezoid at this point
 
-    self.m_pIGeometrySink = Some(pIGeometrySink.clone());
+    assert!(nSubpixelXLeftBottom <= nSubpixelXRightBottom);
 
-    //
-    // Rasterize the path
-    //
-    let count = points.len() as u32;
-    IFR!(self.RasterizePath(
-        points,
-        types,
-        count,
-        &self.m_matWorldToDevice.clone(),
-        ));
-        /* 
-    IFC!(self.RasterizePath(
-        self.m_prgPoints.as_ref().unwrap().GetDataBuffer(),
-        self.m_prgTypes.as_ref().unwrap().GetDataBuffer(),
-        self.m_prgPoints.as_ref().unwrap().GetCount() as u32,
-        &self.m_matWorldToDevice,
-        self.m_fillMode
-        ));*/
+    // We know we have a simple trapezoid now.  Now, compute the end of our current trapezoid
+
+    assert!(nSubpixelYAdvance > 0);
 
     //
-    // It's possible that we output no triangles.  For example, if we tried to fill a
-    // line instead of stroke it.  Since we have no efficient way to detect all these cases
-    // up front, we simply rasterize and see if we generated anything.
+    // Computation of edge data
     //
 
-    if (pIGeometrySink.borrow().IsEmpty())
-    {
-        hr = WGXHR_EMPTYFILL;
-    }
+    rSubpixelLeftErrorDown  = (*pEdgeLeft).ErrorDown as f32;
+    rSubpixelRightErrorDown = (*pEdgeRight).ErrorDown as f32;
+    rPixelXLeft  = ConvertSubpixelXToPixel((*pEdgeLeft).X.get(), (*pEdgeLeft).Error.get(), rSubpixelLeftErrorDown);
+    rPixelXRight = ConvertSubpixelXToPixel((*pEdgeRight).X.get(), (*pEdgeRight).Error.get(), rSubpixelRightErrorDown);
 
-    self.m_pIGeometrySink = None;
+    rSubpixelLeftInvSlope     = (*pEdgeLeft).Dx as f32 + (*pEdgeLeft).ErrorUp as f32/rSubpixelLeftErrorDown;
+    rSubpixelLeftAbsInvSlope  = rSubpixelLeftInvSlope.abs();
+    rSubpixelRightInvSlope    = (*pEdgeRight).Dx as f32 + (*pEdgeRight).ErrorUp as f32/rSubpixelRightErrorDown;
+    rSubpixelRightAbsInvSlope = rSubpixelRightInvSlope.abs();
 
-    RRETURN1!(hr, WGXHR_EMPTYFILL);
-}
-/*
-//-------------------------------------------------------------------------
-//
-//  Function:   CHwRasterizer::SendGeometryModifiers
-//
-//  Synopsis:   Send an AA color source to the pipeline.
-//
-//-------------------------------------------------------------------------
-fn SendGeometryModifiers(&self,
-    pPipelineBuilder: &mut CHwPipelineBuilder
-    ) -> HRESULT
-{
-    let hr = S_OK;
+    rPixelXLeftDelta  = 0.5 + 0.5 * rSubpixelLeftAbsInvSlope;
+    rPixelXRightDelta = 0.5 + 0.5 * rSubpixelRightAbsInvSlope;
 
-    let pAntiAliasColorSource = None;
+    let rPixelYTop         = ConvertSubpixelYToPixel(nSubpixelYCurrent);
+    let rPixelYBottom      = ConvertSubpixelYToPixel(nSubpixelYNext);
 
-    self.m_pDeviceNoRef.GetColorComponentSource(
-        CHwColorComponentSource::Diffuse,
-        &pAntiAliasColorSource
-        );
+    let rPixelXBottomLeft  = ConvertSubpixelXToPixel(
+                                    nSubpixelXLeftBottom,
+                                    nSubpixelErrorLeftBottom,
+                                    (*pEdgeLeft).ErrorDown as f32
+                                    );
 
-    IFC!(pPipelineBuilder.Set_AAColorSource(
-        pAntiAliasColorSource
-        ));
+    let rPixelXBottomRight = ConvertSubpixelXToPixel(
+                                    nSubpixelXRightBottom,
+                                    nSubpixelErrorRightBottom,
+                                    (*pEdgeRight).ErrorDown as f32
+                                    );
 
-    return hr;
-}*/
+    //
+    // Output the trapezoid
+    //
 
-//-------------------------------------------------------------------------
-//
-//  Function:   CHwRasterizer::GenerateOutputAndClearCoverage
-//
-//  Synopsis:
-//      Collapse output and generate span data
-//
-//-------------------------------------------------------------------------
-fn
-GenerateOutputAndClearCoverage<'a>(&mut self, coverageBuffer: &'a CCoverageBuffer<'a>,
-    nSubpixelY: INT
-    ) -> HRESULT
-{
-    let hr = S_OK;
-    let nPixelY = nSubpixelY >> c_nShift;
+    IFC!(self.m_pIGeometrySink.as_mut().unwrap().borrow_mut().AddTrapezoid(
+        rPixelYTop,              // In: y coordinate of top of trapezoid
+        rPixelXLeft,             // In: x coordinate for top left
+        rPixelXRight,            // In: x coordinate for top right
+        rPixelYBottom,           // In: y coordinate of bottom of trapezoid
+        rPixelXBottomLeft,       // In: x coordinate for bottom left
+        rPixelXBottomRight,      // In: x coordinate for bottom right
+        rPixelXLeftDelta,        // In: trapezoid expand radius for left edge
+        rPixelXRightDelta        // In: trapezoid expand radius for right edge
+        ));
 
-    let pIntervalSpanStart: Ref<CCoverageInterval> = coverageBuffer.m_pIntervalStart.get();
+    //
+    // Update the edge data
+    //
 
-    IFC!(self.m_pIGeometrySink.as_ref().unwrap().borrow_mut().AddComplexScan(nPixelY, pIntervalSpanStart));
+    //  no need to do this if edges are stale
 
-    coverageBuffer.Reset();
+    (*pEdgeLeft).X.set(nSubpixelXLeftBottom);
+    (*pEdgeLeft).Error.set(nSubpixelErrorLeftBottom);
+    (*pEdgeRight).X.set(nSubpixelXRightBottom);
+    (*pEdgeRight).Error.set(nSubpixelErrorRightBottom);
 
     return hr;
 }
 
 //-------------------------------------------------------------------------
 //
-//  Function:   CHwRasterizer::ComputeTrapezoidsEndScan
+//  Function:   CHwRasterizer::ComputeChainedTrapezoidsEndScan
 //
 //  Synopsis:
-//      This methods takes the current active edge list (and ycurrent)
-//      and will determine:
-//
-//      1. Can we output some list of simple trapezoids for this active
-//         edge list?  If the answer is no, then we simply return
-//         nSubpixelYCurrent indicating this condition.
-//
-//      2. If we can output some set of trapezoids, then what is the
-//         next ycurrent, i.e., how tall are our trapezoids.
-//
-//     Note that all trapezoids output for a particular active edge list
-//     are all the same height.
-//
-//     To further understand the conditions for making this decision, it
-//     is important to consider the simple trapezoid tessellation:
-//
-//           ___+_________________+___
-//          /  +  /             \  +  \        '+' marks active edges
-//         /  +  /               \  +  \
-//        /  +  /                 \  +  \
-//       /__+__/___________________\__+__\
-//       1+1/m                         +
-//
-//      Note that 1+1/edge_slope is the required expand distance to ensure
-//      that we cover all pixels required.
-//
-//      Now, we can fail to output any trapezoids under the following conditions:
-//         1. The expand regions along the top edge of the trapezoid overlap.
-//         2. The expand regions along the bottom edge of the trapezoid overlap
-//            within the current scanline.  Note that if the bottom edges overlap
-//            at some later point, we can shorten our trapezoid to remove the
-//            overlapping.
-//
-//      The key to the algorithm at this point is to detect the above condition
-//      in our active edge list and either update the returned end y position
-//      or reject all together based on overlapping.
+//      Like ComputeTrapezoidsEndScan, but let the trapezoids continue past
+//      the EndY of their edges.  A polyline turns into one edge per
+//      segment, and each joint stops the trapezoids and usually costs a
+//      complex scan as well, which splits flattened curves into many
+//      short pieces.
+//
+//      An active edge that ends is continued by an inactive edge starting
+//      at the same scanline, with the same winding direction and at the
+//      same x.  The chains are extended joint by joint for as long as
+//      every new inactive edge continues a chain.  The trapezoid sides
+//      are then the chords from the top of each chain to its bottom, and
+//      the deepest bottom where all the joints lie within the chain
+//      tolerance of their chord is returned.  On return 'chain' holds the
+//      joints; the ones above the returned scanline have been crossed.
+//
+//      Returns nSubpixelYCurrent if no chained trapezoids are possible.
 //
 //-------------------------------------------------------------------------
-
-fn ComputeTrapezoidsEndScan(&mut self,
-    pEdgeCurrent: Ref<CEdge>,
+fn ComputeChainedTrapezoidsEndScan<'a>(&self,
+    activeList: &impl IActiveEdgeList<'a>,
+    pEdgeCurrent: Ref<'a, CEdge<'a>>,
     nSubpixelYCurrent: INT,
-    nSubpixelYNextInactive: INT
+    rgInactive: &[CInactiveEdge<'a>],
+    chain: &mut CTrapezoidChain<'a>
     ) -> INT
 {
+    assert!((nSubpixelYCurrent & c_nShiftMask) == 0);
 
-    let mut nSubpixelYBottomTrapezoids;
-    let mut pEdgeLeft: Ref<CEdge>;
-    let mut pEdgeRight: Ref<CEdge>;
-
-    //
-    // Trapezoids should always start at scanline boundaries
-    //
+    chain.cEdges = 0;
+    chain.cJoints = 0;
 
-    assert!((nSubpixelYCurrent & c_nShiftMask) == 0);
+    cfor!{let mut pEdge = pEdgeCurrent; (*pEdge).EndY != INT::MIN; pEdge = activeList.Next(pEdge);
+    {
+        if (chain.cEdges == c_nChainEdgeMax)
+        {
+            return nSubpixelYCurrent;
+        }
+        chain.rgpEdgeActive[chain.cEdges] = Some(pEdge);
+        chain.rgpEdgeLast[chain.cEdges] = Some(pEdge);
+        chain.cEdges += 1;
+    }}
 
     //
-    // If we are doing a winding mode fill, check that we can ignore mode and do an
-    // alternating fill in OutputTrapezoids.  This condition occurs when winding is
-    // equivalent to alternating which happens if the pairwise edges have different
-    // winding directions.
+    // As in ComputeTrapezoidsEndScan, winding mode is only handled when it
+    // is equivalent to alternate mode.  Chains keep their winding
+    // direction, so this holds for the whole trapezoid.
     //
 
     if (self.m_fillMode == MilFillMode::Winding)
     {
-        cfor!{let mut pEdge = pEdgeCurrent; (*pEdge).EndY != INT::MIN; pEdge = (*(*pEdge).Next.get()).Next.get();
+        for iChain in (0..chain.cEdges).step_by(2)
         {
-            // The active edge list always has an even number of edges which we actually
-            // assert in ASSERTACTIVELIST.
-
-            assert!((*(*pEdge).Next.get()).EndY != INT::MIN);
-
-            // If not alternating winding direction, we can't fill with alternate mode
-
-            if ((*pEdge).WindingDirection == (*(*pEdge).Next.get()).WindingDirection)
+            if (chain.rgpEdgeActive[iChain].unwrap().WindingDirection == chain.rgpEdgeActive[iChain + 1].unwrap().WindingDirection)
             {
-                // Give up until we handle winding mode
-                nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
-                return nSubpixelYBottomTrapezoids;
+                return nSubpixelYCurrent;
             }
-        }}
+        }
     }
 
-    //
-    // For each edge, we:
-    //
-    //    1. Set the new trapezoid bottom to the min of the current
-    //       one and the edge EndY
-    //
-    //    2. Check if edges will intersect during trapezoidal shrink/expand
-    //
-
-    nSubpixelYBottomTrapezoids = nSubpixelYNextInactive;
+    let mut nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
+    let mut iInactive = 0;
 
-    cfor!{let mut pEdge = pEdgeCurrent; (*pEdge).EndY != INT::MIN; pEdge = (*pEdge).Next.get(); 
+    'extend: loop
     {
         //
-        // Step 1
-        //
-        // Updated nSubpixelYBottomTrapezoids based on edge EndY.
-        //
-        // Since edges are clipped to the current clip rect y bounds, we also know
-        // that pEdge->EndY <= nSubpixelYBottom so there is no need to check for that here.
+        // Every chain is known down to the first chain end or the first
+        // inactive edge that hasn't been matched up yet.  Try a trapezoid
+        // bottom on the last scanline boundary above that.
         //
 
-        nSubpixelYBottomTrapezoids = nSubpixelYBottomTrapezoids.min((*pEdge).EndY);
+        let mut nSubpixelYReach = rgInactive[iInactive].GetEdge().StartY;
+        for iChain in 0..chain.cEdges
+        {
+            nSubpixelYReach = nSubpixelYReach.min(chain.rgpEdgeLast[iChain].unwrap().EndY);
+        }
+
+        let nSubpixelYBottom = nSubpixelYReach & !c_nShiftMask;
+        if (nSubpixelYBottom >= nSubpixelYCurrent + c_nShiftSize && nSubpixelYBottom > nSubpixelYBottomTrapezoids)
+        {
+            if (!self.IsTrapezoidChainValid(chain, nSubpixelYCurrent, nSubpixelYBottom))
+            {
+                break;
+            }
+            nSubpixelYBottomTrapezoids = nSubpixelYBottom;
+        }
 
         //
-        // Step 2
-        //
-        // Check that edges will not overlap during trapezoid shrink/expand.
+        // Continue the chains that end at nSubpixelYReach with the inactive
+        // edges starting there.  Every one of those edges has to continue
+        // a chain, or the trapezoids would no longer cover the shape.
         //
 
-        pEdgeLeft = pEdge;
-        pEdgeRight = (*pEdge).Next.get();
+        let mut rgfContinued = [false; c_nChainEdgeMax];
 
-        if ((*pEdgeRight).EndY != INT::MIN)
+        while (rgInactive[iInactive].GetEdge().StartY == nSubpixelYReach)
         {
-            //
-            //        __A__A'___________________B'_B__
-            //        \  +  \                  /  +  /       '+' marks active edges
-            //         \  +  \                /  +  /
-            //          \  +  \              /  +  /
-            //           \__+__\____________/__+__/
-            //       1+1/m   C  C'         D' D
-            //
-            // We need to determine if position A' <= position B' and that position C' <= position D'
-            // in the above diagram.  So, we need to ensure that both the distance between
-            // A and B and the distance between C and D is greater than or equal to:
-            //
-            //    0.5 + |0.5/m1| + 0.5 + |0.5/m2|               (pixel space)
-            //  = shiftsize + halfshiftsize*(|1/m1| + |1/m2|)   (subpixel space)
-            //
-            // So, we'll start by computing this distance.  Note that we can compute a distance
-            // that is too large here since the self-intersection detection is simply used to
-            // recognize trapezoid opportunities and isn't required for visual correctness.
-            //
+            if (chain.cJoints == c_nChainJointMax)
+            {
+                break 'extend;
+            }
 
-            let nSubpixelExpandDistanceUpperBound: INT =
-                c_nShiftSize
-                + ComputeDeltaUpperBound(&*pEdgeLeft, c_nHalfShiftSize)
-                + ComputeDeltaUpperBound(&*pEdgeRight, c_nHalfShiftSize);
+            let pEdgeNew = rgInactive[iInactive].GetEdge();
+            let mut iBestChain = None;
+            let mut nBestDistance = self.m_nChainTolerance + 1;
 
-            //
-            // Compute a top edge distance that is <= to the distance between A' and B' as follows:
-            //   lowerbound(distance(A, B)) - nSubpixelExpandDistanceUpperBound
-            //
+            for iChain in 0..chain.cEdges
+            {
+                let pEdgeLast = chain.rgpEdgeLast[iChain].unwrap();
+                if (pEdgeLast.EndY != nSubpixelYReach
+                    || rgfContinued[iChain]
+                    || pEdgeLast.WindingDirection != pEdgeNew.WindingDirection)
+                {
+                    continue;
+                }
 
-            let nSubpixelXTopDistanceLowerBound: INT =
-                ComputeDistanceLowerBound(&*pEdgeLeft, &*pEdgeRight) - nSubpixelExpandDistanceUpperBound;
+                let (_, nSubpixelYEdge) = chain.EdgeAt(iChain, nSubpixelYCurrent, nSubpixelYReach);
+                let (mut nSubpixelX, mut nSubpixelError) = (0, 0);
+                let (mut nUnused, mut nUnusedError) = (0, 0);
+                AdvanceDDAMultipleSteps(
+                    &*pEdgeLast,
+                    &*pEdgeLast,
+                    nSubpixelYReach - nSubpixelYEdge,
+                    &mut nSubpixelX,
+                    &mut nSubpixelError,
+                    &mut nUnused,
+                    &mut nUnusedError
+                    );
 
-            //
-            // Check if the top edges cross
-            //
+                let nDistance = (nSubpixelX - pEdgeNew.X.get()).abs();
+                if (nDistance <= nBestDistance)
+                {
+                    iBestChain = Some(iChain);
+                    nBestDistance = nDistance;
+                }
+            }
 
-            if (nSubpixelXTopDistanceLowerBound < 0)
+            match iBestChain
             {
-                // The top edges have crossed, so we are out of luck.  We can't
-                // start a trapezoid on this scanline
-
-                nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
-                return nSubpixelYBottomTrapezoids;
+                Some(iChain) =>
+                {
+                    chain.rgJoint[chain.cJoints] = (iChain, Some(pEdgeNew));
+                    chain.cJoints += 1;
+                    chain.rgpEdgeLast[iChain] = Some(pEdgeNew);
+                    rgfContinued[iChain] = true;
+                    iInactive += 1;
+                }
+                None => break 'extend,
             }
+        }
 
-            //
-            // If the edges are converging, we need to check if they cross at
-            // nSubpixelYBottomTrapezoids
-            //
-            //
-            //  1) \       /    2) \    \       3)   /   /
-            //      \     /          \   \          /  /
-            //       \   /             \  \        / /
-            //
-            // The edges converge iff (dx1 > dx2 || (dx1 == dx2 && errorUp1/errorDown1 > errorUp2/errorDown2).
-            //
-            // Note that in the case where the edges do not converge, the code below will end up computing
-            // the DDA at the end points and checking for intersection again.  This code doesn't rely on
-            // the fact that the edges don't converge, so we can be too conservative here.
-            //
+        //
+        // A chain that ends without being continued is as far as we go
+        //
 
-            if ((*pEdgeLeft).Dx > (*pEdgeRight).Dx
-                || (((*pEdgeLeft).Dx == (*pEdgeRight).Dx)
-                    && IsFractionGreaterThan((*pEdgeLeft).ErrorUp, (*pEdgeLeft).ErrorDown, (*pEdgeRight).ErrorUp, (*pEdgeRight).ErrorDown)))
+        for iChain in 0..chain.cEdges
+        {
+            if (chain.rgpEdgeLast[iChain].unwrap().EndY <= nSubpixelYReach)
             {
+                break 'extend;
+            }
+        }
+    }
 
-                let nSubpixelYAdvance: INT =  nSubpixelYBottomTrapezoids - nSubpixelYCurrent;
-                assert!(nSubpixelYAdvance > 0);
-
-                //
-                // Compute the edge position at nSubpixelYBottomTrapezoids
-                //
-
-                let mut nSubpixelXLeftAdjustedBottom = 0;
-                let mut nSubpixelErrorLeftBottom = 0;
-                let mut nSubpixelXRightBottom = 0;
-                let mut nSubpixelErrorRightBottom = 0;
-
-                AdvanceDDAMultipleSteps(
-                    &*pEdgeLeft,
-                    &*pEdgeRight,
-                    nSubpixelYAdvance,
-                    &mut nSubpixelXLeftAdjustedBottom,
-                    &mut nSubpixelErrorLeftBottom,
-                    &mut nSubpixelXRightBottom,
-                    &mut nSubpixelErrorRightBottom
-                    );
-
-                //
-                // Adjust the bottom left position by the expand distance for all the math
-                // that follows.  Note that since we adjusted the top distance by that
-                // same expand distance, this adjustment is equivalent to moving the edges
-                // nSubpixelExpandDistanceUpperBound closer together.
-                //
+    return nSubpixelYBottomTrapezoids;
+}
 
-                nSubpixelXLeftAdjustedBottom += nSubpixelExpandDistanceUpperBound;
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::IsTrapezoidChainValid
+//
+//  Synopsis:
+//      Check that chained trapezoids from nSubpixelYCurrent down to
+//      nSubpixelYNext are close enough to the edges they replace: every
+//      joint crossed lies within the chain tolerance of the chord of its
+//      chain.  Neighbouring chords also have to stay far enough apart for
+//      their expand regions not to overlap, allowing for the edges
+//      straying from the chords.  Chords are straight, so it is enough to
+//      check that at the top and the bottom.
+//
+//-------------------------------------------------------------------------
+fn IsTrapezoidChainValid(&self,
+    chain: &CTrapezoidChain,
+    nSubpixelYCurrent: INT,
+    nSubpixelYNext: INT
+    ) -> bool
+{
+    let rTolerance = self.m_nChainTolerance as f64;
+    let rHeight = (nSubpixelYNext - nSubpixelYCurrent) as f64;
+    let rPosition = |x: INT, error: INT, errorDown: INT| x as f64 + error as f64 / errorDown as f64;
 
-                //
-                // Check if the bottom edge crosses.
-                //
-                // To avoid checking error1/errDown1 and error2/errDown2, we assume the
-                // edges cross if nSubpixelXLeftAdjustedBottom == nSubpixelXRightBottom
-                // and thus produce a result that is too conservative.
-                //
+    let mut rPreviousTop = f64::MIN;
+    let mut rPreviousBottom = f64::MIN;
+    let mut rPreviousAbsInvSlope = 0.;
 
-                if (nSubpixelXLeftAdjustedBottom >= nSubpixelXRightBottom)
-                {
+    for iChain in 0..chain.cEdges
+    {
+        let pEdgeTop = chain.rgpEdgeActive[iChain].unwrap();
+        let (mut nSubpixelXBottom, mut nSubpixelErrorBottom) = (0, 0);
+        let pEdgeBottom = chain.ComputeBottom(iChain, nSubpixelYCurrent, nSubpixelYNext, &mut nSubpixelXBottom, &mut nSubpixelErrorBottom);
 
-                    //
-                    // At this point, we have the following scenario
-                    //
-                    //            ____d1____
-                    //            \        /   |   |
-                    //              \    /     h1  |
-                    //                \/       |   | nSubpixelYAdvance
-                    //               /  \          |
-                    //             /__d2__\        |
-                    //
-                    // We want to compute h1.  We know that:
-                    //
-                    //     h1 / nSubpixelYAdvance = d1 / (d1 + d2)
-                    //     h1 = nSubpixelYAdvance * d1 / (d1 + d2)
-                    //
-                    // Now, if we approximate d1 with some d1' <= d1, we get
-                    //
-                    //     h1 = nSubpixelYAdvance * d1 / (d1 + d2)
-                    //     h1 >= nSubpixelYAdvance * d1' / (d1' + d2)
-                    //
-                    // Similarly, if we approximate d2 with some d2' >= d2, we get
-                    //
-                    //     h1 >= nSubpixelYAdvance * d1' / (d1' + d2)
-                    //        >= nSubpixelYAdvance * d1' / (d1' + d2')
-                    //
-                    // Since we are allowed to be too conservative with h1 (it can be
-                    // less than the actual value), we'll construct such approximations
-                    // for simplicity.
-                    //
-                    // Note that d1' = nSubpixelXTopDistanceLowerBound which we have already
-                    // computed.
-                    //
-                    //      d2 = (x1 + error1/errorDown1) - (x2 + error2/errorDown2)
-                    //         = x1 - x2 + error1/errorDown1 - error2/errorDown2
-                    //         <= x1 - x2 - error2/errorDown2   , since error1 < 0
-                    //         <= x1 - x2 + 1                   , since error2 < 0
-                    //         = nSubpixelXLeftAdjustedBottom - nSubpixelXRightBottom + 1
-                    //
-
-                    let nSubpixelXBottomDistanceUpperBound: INT = nSubpixelXLeftAdjustedBottom - nSubpixelXRightBottom + 1;
-
-                    assert!(nSubpixelXTopDistanceLowerBound >= 0);
-                    assert!(nSubpixelXBottomDistanceUpperBound > 0);
-
-                    #[cfg(debug_assertions)]
-                    let nDbgPreviousSubpixelXBottomTrapezoids: INT = nSubpixelYBottomTrapezoids;
-
-
-                    nSubpixelYBottomTrapezoids =
-                        nSubpixelYCurrent +
-                        (nSubpixelYAdvance * nSubpixelXTopDistanceLowerBound) /
-                        (nSubpixelXTopDistanceLowerBound + nSubpixelXBottomDistanceUpperBound);
-
-                    #[cfg(debug_assertions)]
-                    assert!(nDbgPreviousSubpixelXBottomTrapezoids >= nSubpixelYBottomTrapezoids);
-
-                    if (nSubpixelYBottomTrapezoids < nSubpixelYCurrent + c_nShiftSize)
-                    {
-                        // We no longer have a trapezoid that is at least one scanline high, so
-                        // abort
+        let rTop = rPosition(pEdgeTop.X.get(), pEdgeTop.Error.get(), pEdgeTop.ErrorDown);
+        let rBottom = rPosition(nSubpixelXBottom, nSubpixelErrorBottom, pEdgeBottom.ErrorDown);
+        let rInvSlope = (rBottom - rTop) / rHeight;
 
-                        nSubpixelYBottomTrapezoids = nSubpixelYCurrent;
-                        return nSubpixelYBottomTrapezoids;
-                    }
+        for &(iJointChain, pEdgeJoint) in &chain.rgJoint[..chain.cJoints]
+        {
+            let pEdgeJoint = pEdgeJoint.unwrap();
+            if (pEdgeJoint.StartY >= nSubpixelYNext)
+            {
+                break;
+            }
+            if (iJointChain == iChain)
+            {
+                let rJoint = rPosition(pEdgeJoint.X.get(), pEdgeJoint.Error.get(), pEdgeJoint.ErrorDown);
+                let rChord = rTop + rInvSlope * (pEdgeJoint.StartY - nSubpixelYCurrent) as f64;
+                if ((rJoint - rChord).abs() > rTolerance)
+                {
+                    return false;
                 }
             }
         }
-    }};
-
-    //
-    // Snap to pixel boundary
-    //
 
-    nSubpixelYBottomTrapezoids = nSubpixelYBottomTrapezoids & (!c_nShiftMask);
+        //
+        // Same spacing as ComputeTrapezoidsEndScan requires, plus room for
+        // both edges to be off their chords and for rounding.
+        //
 
-    //
-    // Ensure that we are never less than nSubpixelYCurrent
-    //
+        let rSpacing = c_nShiftSize as f64
+            + c_nHalfShiftSize as f64 * (rPreviousAbsInvSlope + rInvSlope.abs())
+            + 2. * rTolerance
+            + 1.;
 
-    assert!(nSubpixelYBottomTrapezoids >= nSubpixelYCurrent);
+        if (iChain > 0 && (rTop - rPreviousTop < rSpacing || rBottom - rPreviousBottom < rSpacing))
+        {
+            return false;
+        }
 
-    //
-    // Return trapezoid end scan
-    //
+        rPreviousTop = rTop;
+        rPreviousBottom = rBottom;
+        rPreviousAbsInvSlope = rInvSlope.abs();
+    }
 
-//Cleanup:
-    return nSubpixelYBottomTrapezoids;
+    return true;
 }
 
-
 //-------------------------------------------------------------------------
 //
-//  Function:   CHwRasterizer::OutputTrapezoids
+//  Function:   CHwRasterizer::OutputChainedTrapezoids
 //
 //  Synopsis:
-//      Given the current active edge list, output a list of
-//      trapezoids.
-//
-//      _________________________
-//     /     /             \     \
-//    /     /               \     \
-//   /     /                 \     \
-//  /_____/___________________\_____\
-//  1+1/m
-//
-// We output a trapezoid where the distance in X is 1+1/m slope on either edge.
-// Note that we actually do a linear interpolation for coverage along the
-// entire falloff region which comes within 12.5% error when compared to our
-// 8x8 coverage output for complex scans.  What is happening here is
-// that we are applying a linear approximation to the coverage function
-// based on slope.  It is possible to get better linear interpolations
-// by varying the expanded region, but it hasn't been necessary to apply
-// these quality improvements yet.
+//      Output the trapezoids that ComputeChainedTrapezoidsEndScan found,
+//      using the chords of the chains as their sides, and move each
+//      chain's bottom edge into the active list in place of its top edge.
+//      The edges continuing chains must not be inserted again; the caller
+//      drops them from the inactive array.
 //
 //-------------------------------------------------------------------------
-fn 
-OutputTrapezoids(&mut self,
-    pEdgeCurrent: Ref<CEdge>,
+fn OutputChainedTrapezoids<'a, TActiveEdgeList: IActiveEdgeList<'a>>(&mut self,
+    activeList: &mut TActiveEdgeList,
+    chain: &CTrapezoidChain<'a>,
     nSubpixelYCurrent: INT, // inclusive
     nSubpixelYNext: INT     // exclusive
     ) -> HRESULT
 {
-
     let hr = S_OK;
-    let nSubpixelYAdvance: INT;
-    let mut rSubpixelLeftErrorDown: f32;
-    let mut rSubpixelRightErrorDown: f32;
-    let mut rPixelXLeft: f32;
-    let mut rPixelXRight: f32;
-    let mut rSubpixelLeftInvSlope: f32;
-    let mut rSubpixelLeftAbsInvSlope: f32;
-    let mut rSubpixelRightInvSlope: f32;
-    let mut rSubpixelRightAbsInvSlope: f32;
-    let mut rPixelXLeftDelta: f32;
-    let mut rPixelXRightDelta: f32;
-
-    let mut pEdgeLeft = pEdgeCurrent;
-    let mut pEdgeRight = (*pEdgeCurrent).Next.get();
-
-    assert!((nSubpixelYCurrent & c_nShiftMask) == 0);
-    assert!((*pEdgeLeft).EndY != INT::MIN);
-    assert!((*pEdgeRight).EndY != INT::MIN);
-
-    //
-    // Compute the height our trapezoids
-    //
-
-    nSubpixelYAdvance = nSubpixelYNext - nSubpixelYCurrent;
+    let mut rgpEdgeBottom: [Option<Ref<'a, CEdge<'a>>>; c_nChainEdgeMax] = Default::default();
+    let mut rgnSubpixelXBottom = [0; c_nChainEdgeMax];
+    let mut rgnSubpixelErrorBottom = [0; c_nChainEdgeMax];
+    let mut rgrPixelXTop = [0.; c_nChainEdgeMax];
+    let mut rgrPixelXBottom = [0.; c_nChainEdgeMax];
 
-    //
-    // Output each trapezoid
-    //
+    let rPixelYTop = ConvertSubpixelYToPixel(nSubpixelYCurrent);
+    let rPixelYBottom = ConvertSubpixelYToPixel(nSubpixelYNext);
 
-    loop
+    for iChain in 0..chain.cEdges
     {
-        //
-        // Compute x/error for end of trapezoid
-        //
-
-        let mut nSubpixelXLeftBottom: INT = 0;
-        let mut nSubpixelErrorLeftBottom: INT = 0;
-        let mut nSubpixelXRightBottom: INT = 0;
-        let mut nSubpixelErrorRightBottom: INT = 0;
-
-        AdvanceDDAMultipleSteps(
-            &*pEdgeLeft,
-            &*pEdgeRight,
-            nSubpixelYAdvance,
-            &mut nSubpixelXLeftBottom,
-            &mut nSubpixelErrorLeftBottom,
-            &mut nSubpixelXRightBottom,
-            &mut nSubpixelErrorRightBottom
+        let pEdgeTop = chain.rgpEdgeActive[iChain].unwrap();
+        let pEdgeBottom = chain.ComputeBottom(
+            iChain,
+            nSubpixelYCurrent,
+            nSubpixelYNext,
+            &mut rgnSubpixelXBottom[iChain],
+            &mut rgnSubpixelErrorBottom[iChain]
             );
 
-        // The above computation should ensure that we are a simple
-        // trapezoid at this point
-
-        assert!(nSubpixelXLeftBottom <= nSubpixelXRightBottom);
-
-        // We know we have a simple trapezoid now.  Now, compute the end of our current trapezoid
-
-        assert!(nSubpixelYAdvance > 0);
-
-        //
-        // Computation of edge data
-        //
-
-        rSubpixelLeftErrorDown  = (*pEdgeLeft).ErrorDown as f32;
-        rSubpixelRightErrorDown = (*pEdgeRight).ErrorDown as f32;
-        rPixelXLeft  = ConvertSubpixelXToPixel((*pEdgeLeft).X.get(), (*pEdgeLeft).Error.get(), rSubpixelLeftErrorDown);
-        rPixelXRight = ConvertSubpixelXToPixel((*pEdgeRight).X.get(), (*pEdgeRight).Error.get(), rSubpixelRightErrorDown);
-
-        rSubpixelLeftInvSlope     = (*pEdgeLeft).Dx as f32 + (*pEdgeLeft).ErrorUp as f32/rSubpixelLeftErrorDown;
-        rSubpixelLeftAbsInvSlope  = rSubpixelLeftInvSlope.abs();
-        rSubpixelRightInvSlope    = (*pEdgeRight).Dx as f32 + (*pEdgeRight).ErrorUp as f32/rSubpixelRightErrorDown;
-        rSubpixelRightAbsInvSlope = rSubpixelRightInvSlope.abs();
-
-        rPixelXLeftDelta  = 0.5 + 0.5 * rSubpixelLeftAbsInvSlope;
-        rPixelXRightDelta = 0.5 + 0.5 * rSubpixelRightAbsInvSlope;
-
-        let rPixelYTop         = ConvertSubpixelYToPixel(nSubpixelYCurrent);
-        let rPixelYBottom      = ConvertSubpixelYToPixel(nSubpixelYNext);
-
-        let rPixelXBottomLeft  = ConvertSubpixelXToPixel(
-                                        nSubpixelXLeftBottom,
-                                        nSubpixelErrorLeftBottom,
-                                        (*pEdgeLeft).ErrorDown as f32
-                                        );
+        rgrPixelXTop[iChain] = ConvertSubpixelXToPixel(pEdgeTop.X.get(), pEdgeTop.Error.get(), pEdgeTop.ErrorDown as f32);
+        rgrPixelXBottom[iChain] = ConvertSubpixelXToPixel(rgnSubpixelXBottom[iChain], rgnSubpixelErrorBottom[iChain], pEdgeBottom.ErrorDown as f32);
+        rgpEdgeBottom[iChain] = Some(pEdgeBottom);
+    }
 
-        let rPixelXBottomRight = ConvertSubpixelXToPixel(
-                                        nSubpixelXRightBottom,
-                                        nSubpixelErrorRightBottom,
-                                        (*pEdgeRight).ErrorDown as f32
-                                        );
+    for iChain in (0..chain.cEdges).step_by(2)
+    {
+        let (iLeft, iRight) = (iChain, iChain + 1);
 
-        //
-        // Output the trapezoid
-        //
+        let rPixelXLeftDelta  = 0.5 + 0.5 * ((rgrPixelXBottom[iLeft]  - rgrPixelXTop[iLeft])  / (rPixelYBottom - rPixelYTop)).abs();
+        let rPixelXRightDelta = 0.5 + 0.5 * ((rgrPixelXBottom[iRight] - rgrPixelXTop[iRight]) / (rPixelYBottom - rPixelYTop)).abs();
 
         IFC!(self.m_pIGeometrySink.as_mut().unwrap().borrow_mut().AddTrapezoid(
-            rPixelYTop,              // In: y coordinate of top of trapezoid
-            rPixelXLeft,             // In: x coordinate for top left
-            rPixelXRight,            // In: x coordinate for top right
-            rPixelYBottom,           // In: y coordinate of bottom of trapezoid
-            rPixelXBottomLeft,       // In: x coordinate for bottom left
-            rPixelXBottomRight,      // In: x coordinate for bottom right
-            rPixelXLeftDelta,        // In: trapezoid expand radius for left edge
-            rPixelXRightDelta        // In: trapezoid expand radius for right edge
+            rPixelYTop,
+            rgrPixelXTop[iLeft],
+            rgrPixelXTop[iRight],
+            rPixelYBottom,
+            rgrPixelXBottom[iLeft],
+            rgrPixelXBottom[iRight],
+            rPixelXLeftDelta,
+            rPixelXRightDelta
             ));
+    }
 
-        //
-        // Update the edge data
-        //
-
-        //  no need to do this if edges are stale
-
-        (*pEdgeLeft).X.set(nSubpixelXLeftBottom);
-        (*pEdgeLeft).Error.set(nSubpixelErrorLeftBottom);
-        (*pEdgeRight).X.set(nSubpixelXRightBottom);
-        (*pEdgeRight).Error.set(nSubpixelErrorRightBottom);
+    //
+    // Update the active edges
+    //
 
-        //
-        // Check for termination
-        //
+    let mut pEdgePrevious = activeList.Head();
+    for iChain in 0..chain.cEdges
+    {
+        assert!(activeList.Next(pEdgePrevious) == chain.rgpEdgeActive[iChain].unwrap());
 
-        if ((*(*pEdgeRight).Next.get()).EndY == INT::MIN)
+        let pEdgeBottom = rgpEdgeBottom[iChain].unwrap();
+        if (pEdgeBottom != chain.rgpEdgeActive[iChain].unwrap())
         {
-            break;
+            activeList.ReplaceEdge(pEdgePrevious, pEdgeBottom);
         }
 
-        //
-        // Advance edge data
-        //
-
-        pEdgeLeft  = (*pEdgeRight).Next.get();
-        pEdgeRight = (*pEdgeLeft).Next.get();
-
+        let pEdge = activeList.Next(pEdgePrevious);
+        pEdge.X.set(rgnSubpixelXBottom[iChain]);
+        pEdge.Error.set(rgnSubpixelErrorBottom[iChain]);
+        pEdgePrevious = pEdge;
     }
 
     return hr;
-
 }
 
 //-------------------------------------------------------------------------
@@ -1341,20 +3307,53 @@ OutputTrapezoids(&mut self,
 fn
 RasterizeEdges<'a, 'b>(&mut self,
     pEdgeActiveList: Ref<'a, CEdge<'a>>,
+    pInactiveEdgeArray: &'a mut [CInactiveEdge<'a>],
+    nTotalCount: UINT,
+    coverageBuffer: &'b CCoverageBuffer,
+    nSubpixelYCurrent: INT,
+    nSubpixelYBottom: INT
+    ) -> HRESULT
+{
+    if (nTotalCount > ACTIVE_EDGE_ARRAY_THRESHOLD!())
+    {
+        let mut activeList = CActiveEdgeArray::new(pEdgeActiveList, nTotalCount as usize, self.AllocateActiveEdgeArrayBuffers());
+        let hr = self.RasterizeActiveEdges(&mut activeList, pInactiveEdgeArray, coverageBuffer, nSubpixelYCurrent, nSubpixelYBottom);
+        self.ReleaseActiveEdgeArrayBuffers(activeList.Destroy());
+        return hr;
+    }
+    else
+    {
+        let mut activeList = CLinkedActiveEdgeList::new(pEdgeActiveList);
+        return self.RasterizeActiveEdges(&mut activeList, pInactiveEdgeArray, coverageBuffer, nSubpixelYCurrent, nSubpixelYBottom);
+    }
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::RasterizeActiveEdges
+//
+//  Synopsis:
+//      The main loop of RasterizeEdges, for either kind of active edge
+//      list.
+//
+//-------------------------------------------------------------------------
+fn
+RasterizeActiveEdges<'a, 'b, TActiveEdgeList: IActiveEdgeList<'a>>(&mut self,
+    activeList: &mut TActiveEdgeList,
     mut pInactiveEdgeArray: &'a mut [CInactiveEdge<'a>],
-    coverageBuffer: &'b CCoverageBuffer<'b>,
+    coverageBuffer: &'b CCoverageBuffer,
     mut nSubpixelYCurrent: INT,
     nSubpixelYBottom: INT
     ) -> HRESULT
 {
     let hr: HRESULT = S_OK;
-    let mut pEdgePrevious: Ref<CEdge>;
+    let pEdgeActiveList: Ref<CEdge> = activeList.Head();
     let mut pEdgeCurrent: Ref<CEdge>;
     let mut nSubpixelYNextInactive: INT = 0;
     let mut nSubpixelYNext: INT;
+    let mut chain: CTrapezoidChain<'a> = Default::default();
 
-    pInactiveEdgeArray = InsertNewEdges(
-        pEdgeActiveList,
+    pInactiveEdgeArray = activeList.InsertNewEdges(
         nSubpixelYCurrent,
         pInactiveEdgeArray,
         &mut nSubpixelYNextInactive
@@ -1362,25 +3361,23 @@ RasterizeEdges<'a, 'b>(&mut self,
 
     while (nSubpixelYCurrent < nSubpixelYBottom)
     {
-        ASSERTACTIVELIST!(pEdgeActiveList, nSubpixelYCurrent);
+        ASSERTACTIVELIST!(activeList, nSubpixelYCurrent);
 
         //
         // Detect trapezoidal case
         //
 
-        pEdgePrevious = pEdgeActiveList;
-        pEdgeCurrent = (*pEdgeActiveList).Next.get();
+        pEdgeCurrent = activeList.Next(pEdgeActiveList);
 
         nSubpixelYNext = nSubpixelYCurrent;
 
         if (!IsTagEnabled!(tagDisableTrapezoids)
             && (nSubpixelYCurrent & c_nShiftMask) == 0
             && (*pEdgeCurrent).EndY != INT::MIN
-            && nSubpixelYNextInactive >= nSubpixelYCurrent + c_nShiftSize
             )
         {
             // Edges are paired, so we can assert we have another one
-            assert!((*(*pEdgeCurrent).Next.get()).EndY != INT::MIN);
+            assert!((*activeList.Next(pEdgeCurrent)).EndY != INT::MIN);
 
             //
             // Given an active edge list, we compute the furthest we can go in the y direction
@@ -1388,8 +3385,36 @@ RasterizeEdges<'a, 'b>(&mut self,
             // can't even go one scanline, then nSubpixelYNext == nSubpixelYCurrent
             //
 
-            nSubpixelYNext = self.ComputeTrapezoidsEndScan(Ref::new(&*pEdgeCurrent), nSubpixelYCurrent, nSubpixelYNextInactive);
-            assert!(nSubpixelYNext >= nSubpixelYCurrent);
+            if (nSubpixelYNextInactive >= nSubpixelYCurrent + c_nShiftSize)
+            {
+                nSubpixelYNext = self.ComputeTrapezoidsEndScan(activeList, pEdgeCurrent, nSubpixelYCurrent, nSubpixelYNextInactive);
+                assert!(nSubpixelYNext >= nSubpixelYCurrent);
+            }
+
+            //
+            // If allowed, see whether chaining trapezoids across edge joints
+            // gets further.  Chained trapezoids are only used when they
+            // actually cross a joint, so shapes without any come out the same.
+            //
+
+            let mut cCrossedJoints = 0;
+
+            if (self.m_nChainTolerance > 0)
+            {
+                let nSubpixelYChained = self.ComputeChainedTrapezoidsEndScan(activeList, pEdgeCurrent, nSubpixelYCurrent, pInactiveEdgeArray, &mut chain);
+
+                if (nSubpixelYChained > nSubpixelYNext)
+                {
+                    cCrossedJoints = chain.rgJoint[..chain.cJoints].iter()
+                        .take_while(|&&(_, pEdge)| pEdge.unwrap().StartY < nSubpixelYChained)
+                        .count();
+
+                    if (cCrossedJoints > 0)
+                    {
+                        nSubpixelYNext = nSubpixelYChained;
+                    }
+                }
+            }
 
             //
             // Attempt to output a trapezoid.  If it turns out we don't have any
@@ -1397,9 +3422,24 @@ RasterizeEdges<'a, 'b>(&mut self,
             // indicating that we need to fall back to complex scans.
             //
 
-            if (nSubpixelYNext >= nSubpixelYCurrent + c_nShiftSize)
+            if (cCrossedJoints > 0)
+            {
+                IFC!(self.OutputChainedTrapezoids(
+                    activeList,
+                    &chain,
+                    nSubpixelYCurrent,
+                    nSubpixelYNext
+                    ));
+
+                // The crossed edges are in the active list now or already done with
+
+                pInactiveEdgeArray = &mut std::mem::take(&mut pInactiveEdgeArray)[cCrossedJoints..];
+                nSubpixelYNextInactive = pInactiveEdgeArray[0].GetEdge().StartY;
+            }
+            else if (nSubpixelYNext >= nSubpixelYCurrent + c_nShiftSize)
             {
                 IFC!(self.OutputTrapezoids(
+                    activeList,
                     pEdgeCurrent,
                     nSubpixelYCurrent,
                     nSubpixelYNext
@@ -1423,70 +3463,98 @@ RasterizeEdges<'a, 'b>(&mut self,
 
             // Remove stale edges.  Note that the DDA is incremented in OutputTrapezoids.
 
-            while ((*pEdgeCurrent).EndY != INT::MIN)
-            {
-                if ((*pEdgeCurrent).EndY <= nSubpixelYCurrent)
-                {
-                    // Unlink and advance
-
-                    pEdgeCurrent = (*pEdgeCurrent).Next.get();
-                    (*pEdgePrevious).Next.set(pEdgeCurrent);
-                }
-                else
-                {
-                    // Advance
-
-                    pEdgePrevious = pEdgeCurrent;
-                    pEdgeCurrent = (*pEdgeCurrent).Next.get();
-                }
-            }
+            activeList.RemoveStaleEdges(nSubpixelYCurrent);
         }
         else
         {
             //
             // Trapezoid rasterization failed, so
-            //   1) Handle case with no active edges, or
-            //   2) fall back to scan rasterization
+            //   1) Handle case with no active edges,
+            //   2) skip a stretch where the active edges give no coverage, or
+            //   3) fall back to scan rasterization
             //
 
             if ((*pEdgeCurrent).EndY == INT::MIN)
             {
+                // Nothing is active, so jump straight over the gap to the
+                // next edge that becomes active.  There is no DDA to advance
+                // and no list to update on the way.
+
                 nSubpixelYNext = nSubpixelYNextInactive;
+
+                // If the next scan is done, output what's there:
+                if (nSubpixelYNext > (nSubpixelYCurrent | c_nShiftMask))
+                {
+                    IFC!(self.GenerateOutputAndClearCoverage(coverageBuffer, nSubpixelYCurrent));
+                }
+
+                nSubpixelYCurrent = nSubpixelYNext;
             }
             else
             {
-                nSubpixelYNext = nSubpixelYCurrent + 1;
-                if (self.m_fillMode == MilFillMode::Alternate)
+                nSubpixelYNext = self.ComputeNoCoverageEndScan(
+                    activeList,
+                    nSubpixelYCurrent,
+                    nSubpixelYNextInactive.min(nSubpixelYBottom)
+                    );
+
+                if (nSubpixelYNext > nSubpixelYCurrent)
                 {
-                    IFC!(coverageBuffer.FillEdgesAlternating(pEdgeActiveList, nSubpixelYCurrent));
+                    // The active edges give no coverage until one of them
+                    // ends or a new one starts, so jump over that stretch.
+                    // Their DDAs go to its last row in one go and take the
+                    // final step as usual.
+
+                    // If the next scan is done, output what's there:
+                    if (nSubpixelYNext > (nSubpixelYCurrent | c_nShiftMask))
+                    {
+                        IFC!(self.GenerateOutputAndClearCoverage(coverageBuffer, nSubpixelYCurrent));
+                    }
+
+                    AdvanceActiveEdgesMultipleSteps(activeList, nSubpixelYNext - 1 - nSubpixelYCurrent);
+
+                    nSubpixelYCurrent = nSubpixelYNext;
+
+                    activeList.AdvanceDDAAndUpdate(nSubpixelYCurrent);
                 }
                 else
                 {
-                    IFC!(coverageBuffer.FillEdgesWinding(pEdgeActiveList, nSubpixelYCurrent));
-                }
-            }
+                    #[cfg(test)]
+                    g_cScanRows.with(|c| c.set(c.get() + 1));
 
-            // If the next scan is done, output what's there:
-            if (nSubpixelYNext > (nSubpixelYCurrent | c_nShiftMask))
-            {
-                IFC!(self.GenerateOutputAndClearCoverage(coverageBuffer, nSubpixelYCurrent));
-            }
+                    nSubpixelYNext = nSubpixelYCurrent + 1;
+                    if (self.m_fillMode == MilFillMode::Alternate)
+                    {
+                        IFC!(coverageBuffer.FillEdgesAlternating(activeList, nSubpixelYCurrent));
+                    }
+                    else
+                    {
+                        IFC!(coverageBuffer.FillEdgesWinding(activeList, nSubpixelYCurrent));
+                    }
 
-            // Advance nSubpixelYCurrent
-            nSubpixelYCurrent = nSubpixelYNext;
+                    // If the next scan is done, output what's there:
+                    if (nSubpixelYNext > (nSubpixelYCurrent | c_nShiftMask))
+                    {
+                        IFC!(self.GenerateOutputAndClearCoverage(coverageBuffer, nSubpixelYCurrent));
+                    }
+
+                    // Advance nSubpixelYCurrent
+                    nSubpixelYCurrent = nSubpixelYNext;
 
-            // Advance DDA and update edge list
-            AdvanceDDAAndUpdateActiveEdgeList(nSubpixelYCurrent, pEdgeActiveList);
+                    // Advance DDA and update edge list
+                    activeList.AdvanceDDAAndUpdate(nSubpixelYCurrent);
+                }
+            }
         }
 
         //
-        // Update edge list
+        // Update edge list.  Edges that would only become active at or
+        // below the bottom are never needed.
         //
 
-        if (nSubpixelYCurrent == nSubpixelYNextInactive)
+        if (nSubpixelYCurrent == nSubpixelYNextInactive && nSubpixelYCurrent < nSubpixelYBottom)
         {
-            pInactiveEdgeArray = InsertNewEdges(
-                pEdgeActiveList,
+            pInactiveEdgeArray = activeList.InsertNewEdges(
                 nSubpixelYCurrent,
                 pInactiveEdgeArray,
                 &mut nSubpixelYNextInactive
@@ -1506,6 +3574,145 @@ RasterizeEdges<'a, 'b>(&mut self,
     RRETURN!(hr);
 }
 
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::RasterizeAliasedEdges
+//
+//  Synopsis:
+//      The main loop for MilAntiAliasMode::None.  The edges are in whole
+//      pixels, so the sweep samples each scanline once at the pixel
+//      centers and all coverage is full.  Consecutive scanlines that fill
+//      the same pixels are collected into a run; see OutputAliasedRun.
+//
+//-------------------------------------------------------------------------
+fn
+RasterizeAliasedEdges<'a, 'b, TActiveEdgeList: IActiveEdgeList<'a>>(&mut self,
+    activeList: &mut TActiveEdgeList,
+    mut pInactiveEdgeArray: &'a mut [CInactiveEdge<'a>],
+    coverageBuffer: &'b CCoverageBuffer,
+    mut nPixelYCurrent: INT,
+    nPixelYBottom: INT
+    ) -> HRESULT
+{
+    let hr: HRESULT = S_OK;
+    let pEdgeActiveList: Ref<CEdge> = activeList.Head();
+    let mut nPixelYNextInactive: INT = 0;
+    let mut nPixelYRunTop: INT = nPixelYCurrent;
+    let (mut rgSpanRun, mut rgSpan) = self.AllocateAliasedSpans();
+
+    pInactiveEdgeArray = activeList.InsertNewEdges(
+        nPixelYCurrent,
+        pInactiveEdgeArray,
+        &mut nPixelYNextInactive
+        );
+
+    while (nPixelYCurrent < nPixelYBottom)
+    {
+        ASSERTACTIVELIST!(activeList, nPixelYCurrent);
+
+        if ((*activeList.Next(pEdgeActiveList)).EndY == INT::MIN)
+        {
+            // Nothing is active, so end the run and jump straight over the
+            // gap to the next edge that becomes active.
+
+            IFC!(self.OutputAliasedRun(coverageBuffer, &rgSpanRun, nPixelYRunTop, nPixelYCurrent));
+            rgSpanRun.clear();
+
+            nPixelYCurrent = nPixelYNextInactive;
+            nPixelYRunTop = nPixelYCurrent;
+        }
+        else
+        {
+            ComputeAliasedSpans(activeList, self.m_fillMode, &mut rgSpan);
+
+            if (rgSpan[..] != rgSpanRun[..])
+            {
+                IFC!(self.OutputAliasedRun(coverageBuffer, &rgSpanRun, nPixelYRunTop, nPixelYCurrent));
+                std::mem::swap(&mut rgSpan, &mut rgSpanRun);
+                nPixelYRunTop = nPixelYCurrent;
+            }
+
+            // Advance nPixelYCurrent, the DDA and the edge list
+
+            nPixelYCurrent += 1;
+            activeList.AdvanceDDAAndUpdate(nPixelYCurrent);
+        }
+
+        if (nPixelYCurrent == nPixelYNextInactive && nPixelYCurrent < nPixelYBottom)
+        {
+            pInactiveEdgeArray = activeList.InsertNewEdges(
+                nPixelYCurrent,
+                pInactiveEdgeArray,
+                &mut nPixelYNextInactive
+                );
+        }
+    }
+
+    IFC!(self.OutputAliasedRun(coverageBuffer, &rgSpanRun, nPixelYRunTop, nPixelYCurrent.min(nPixelYBottom)));
+
+    self.ReleaseAliasedSpans(rgSpanRun, rgSpan);
+
+    RRETURN!(hr);
+}
+
+//-------------------------------------------------------------------------
+//
+//  Function:   CHwRasterizer::OutputAliasedRun
+//
+//  Synopsis:
+//      Output the pixel intervals 'rgSpan' for the scanlines from
+//      'nPixelYTop' up to 'nPixelYBottom'.  A single scanline is a
+//      complex scan with full coverage.  Taller runs are rectangles,
+//      output as trapezoids with no fringe, which take fewer vertices
+//      than one span per scanline.
+//
+//-------------------------------------------------------------------------
+fn OutputAliasedRun(&mut self,
+    coverageBuffer: &CCoverageBuffer,
+    rgSpan: &[(INT, INT)],
+    nPixelYTop: INT,
+    nPixelYBottom: INT
+    ) -> HRESULT
+{
+    let hr = S_OK;
+    let mut pIGeometrySink = self.m_pIGeometrySink.as_ref().unwrap().borrow_mut();
+
+    if (rgSpan.is_empty() || nPixelYBottom <= nPixelYTop)
+    {
+        return hr;
+    }
+
+    if (nPixelYBottom - nPixelYTop == 1)
+    {
+        for &(nPixelXLeft, nPixelXRight) in rgSpan
+        {
+            IFC!(coverageBuffer.AddPixelInterval(nPixelXLeft, nPixelXRight));
+        }
+
+        IFC!(pIGeometrySink.AddComplexScan(nPixelYTop, &coverageBuffer.m_rgInterval.borrow()));
+
+        coverageBuffer.Reset();
+    }
+    else
+    {
+        for &(nPixelXLeft, nPixelXRight) in rgSpan
+        {
+            IFC!(pIGeometrySink.AddTrapezoid(
+                nPixelYTop as f32,
+                nPixelXLeft as f32,
+                nPixelXRight as f32,
+                nPixelYBottom as f32,
+                nPixelXLeft as f32,
+                nPixelXRight as f32,
+                0.,
+                0.
+                ));
+        }
+    }
+
+    return hr;
+}
+
     //+------------------------------------------------------------------------
     //
     //  Member:    GetPerVertexDataType
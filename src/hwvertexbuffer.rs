@@ -108,7 +108,7 @@ const FLOAT_ONE: DWORD = 0x3f800000;
 
 use std::rc::Rc;
 
-use crate::{types::*, geometry_sink::IGeometrySink, aacoverage::c_nShiftSizeSquared, OutputVertex, nullable_ref::Ref};
+use crate::{allocator::{CTransientAllocator, CTransientArray}, types::*, geometry_sink::IGeometrySink, aacoverage::c_nShiftSizeSquared, OutputVertex, InteriorTrapezoid, OutputTrapezoid, OutputSpan};
 
 
 //+----------------------------------------------------------------------------
@@ -282,6 +282,20 @@ impl CHwVertexBufferBuilder {
     {
         return self.FlushInternal(ppVertexBuffer);
     }
+
+    //+------------------------------------------------------------------------
+    //
+    //  Member:    ReleaseVertexBuffer
+    //
+    //  Synopsis:  Hand the vertex buffer back to the device so that its
+    //             allocation can be reused by the next builder.
+    //
+    //-------------------------------------------------------------------------
+
+    pub fn ReleaseVertexBuffer(self)
+    {
+        self.m_pDeviceNoRef.ReleaseVB_XYZDUV2(self.m_pVB);
+    }
 }
 /* 
 /* 
@@ -686,7 +700,7 @@ protected:
     // XXX: the zero has been removed
     //m_rgVerticesTriList: DynArray<TVertex>,             // Indexed triangle list vertices
     //m_rgVerticesNonIndexedTriList: DynArray<TVertex>,   // Non-indexed triangle list vertices
-    m_rgVerticesTriStrip: DynArray<TVertex>,            // Triangle strip vertices
+    m_rgVerticesTriStrip: CTransientArray<TVertex>,     // Triangle strip vertices
     //m_rgVerticesLineList: DynArray<TVertex>,            // Linelist vertices
 
     #[cfg(debug_assertions)]
@@ -756,6 +770,14 @@ public:
 }
 
 impl<TVertex> CHwTVertexBuffer<TVertex> {
+    pub fn new(allocator: CTransientAllocator) -> Self {
+        Self {
+            m_rgVerticesTriStrip: CTransientArray::new(allocator),
+            #[cfg(debug_assertions)]
+            m_fDbgNonLineSegmentTriangleStrip: false,
+        }
+    }
+
     pub fn Reset(&mut self,
         /*pVBB: &mut CHwTVertexBufferBuilder<TVertex>*/
         )
@@ -1141,6 +1163,15 @@ private:
     m_fNeedInsideGeometry: bool,
     m_rcOutsideBounds: CMILSurfaceRect, // Bounds for creation of outside geometry
 
+    // When true the areas completely within the input geometry are
+    // reported to the device as a list of trapezoids instead of being
+    // added to the vertex buffer.
+    m_fReportInterior: bool,
+
+    // When true trapezoids and complex scan spans are passed on to the
+    // device as they are instead of being turned into vertices.
+    m_fOutputRecords: bool,
+
     /* 
     // Helpful m_rcOutsideBounds casts.
     float OutsideLeft() const { return static_cast<float>(m_rcOutsideBounds.left); }
@@ -1165,6 +1196,19 @@ private:
     // right boundary of the last trapezoid handled by PrepareStratum.
     // We need it to cloze the stratus properly.
     m_rLastTrapezoidRight: f32,
+
+    // Where the last trapezoid left the strip when outside geometry is not
+    // needed, so that a trapezoid stacked right below it can continue the
+    // strip instead of starting a new run.  m_cLastTrapezoidStripEnd is the
+    // strip length right after that trapezoid (UINT::MAX if there is none);
+    // if anything else has been added since, the strip can't be continued.
+    // The remaining vars describe the bottom corner the strip ended at.
+    m_cLastTrapezoidStripEnd: UINT,
+    m_rLastTrapezoidBottom: f32,
+    m_rLastTrapezoidX: f32,
+    m_rLastTrapezoidXDelta: f32,
+    m_rLastTrapezoidXAdvance: f32,
+    m_fLastTrapezoidEndedLeft: bool,
 }
 
 /*
@@ -1376,6 +1420,55 @@ fn AddTriStripVertices(
 //Cleanup:
     //RRETURN!(hr);
 }
+
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::ContinueTriStripVertices
+//
+//  Synopsis:  Like AddTriStripVertices but first drops the last vertex of
+//             the strip, which must be a duplicate that was only there to
+//             end the previous run.
+//
+fn ContinueTriStripVertices(
+    &mut self,
+    uCount: UINT,
+    ) -> &mut [TVertex]
+{
+    let Count = self.m_rgVerticesTriStrip.GetCount();
+    assert!(Count > 0);
+    self.m_rgVerticesTriStrip.truncate(Count - 1);
+
+    return self.AddTriStripVertices(uCount);
+}
+
+fn GetTriStripVertexCount(&self) -> UINT
+{
+    return self.m_rgVerticesTriStrip.GetCount() as UINT;
+}
+
+fn GetTriStripVertices(&mut self, iFirst: UINT, uCount: UINT) -> &mut [TVertex]
+{
+    return &mut self.m_rgVerticesTriStrip[iFirst as usize..(iFirst + uCount) as usize];
+}
+
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::AddLineTriStripVertices
+//
+//  Synopsis:  Reserve space for the 6-vertex tri strips of cLines lines
+//             at once.
+//
+fn AddLineTriStripVertices(
+    &mut self,
+    cLines: UINT,
+    ) -> &mut [TVertex]
+{
+    let Count = self.m_rgVerticesTriStrip.GetCount();
+    let newCount = Count + 6 * cLines as usize;
+
+    self.m_rgVerticesTriStrip.resize_with(newCount, Default::default);
+    return &mut self.m_rgVerticesTriStrip[Count..];
+}
 }
 /* 
 //+----------------------------------------------------------------------------
@@ -1795,8 +1888,16 @@ fn new(pVertexBuffer: Box<CHwTVertexBuffer<TVertex>>, device: Rc<CD3DDeviceLevel
     m_rCurStratumBottom:  -f32::MAX,
     m_fNeedOutsideGeometry: false,
     m_fNeedInsideGeometry: true,
+    m_fReportInterior: false,
+    m_fOutputRecords: false,
 
     m_rLastTrapezoidRight: -f32::MAX,
+    m_cLastTrapezoidStripEnd: UINT::MAX,
+    m_rLastTrapezoidBottom: 0.,
+    m_rLastTrapezoidX: 0.,
+    m_rLastTrapezoidXDelta: 0.,
+    m_rLastTrapezoidXAdvance: 0.,
+    m_fLastTrapezoidEndedLeft: false,
     m_fHasFlushed: false,
     m_iViewportTop: 0,
     //m_map: Default::default(),
@@ -1982,6 +2083,38 @@ pub fn SetOutsideBounds(&mut self,
     }
 }
 
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::Builder::SetReportInterior
+//
+//  Synopsis:  Choose between generating geometry for the areas completely
+//             within the input geometry (the default) and only generating
+//             the anti-aliased fringes and reporting those areas to the
+//             device as InteriorTrapezoid's.
+//
+pub fn SetReportInterior(&mut self,
+    fReportInterior: bool,
+    )
+{
+    self.m_fReportInterior = fReportInterior;
+}
+
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::Builder::SetOutputRecords
+//
+//  Synopsis:  Choose between generating vertices (the default) and passing
+//             each trapezoid and non-empty complex scan span on to the
+//             device as an OutputTrapezoid or OutputSpan.  Outside geometry
+//             is not generated for records.
+//
+pub fn SetOutputRecords(&mut self,
+    fOutputRecords: bool,
+    )
+{
+    self.m_fOutputRecords = fOutputRecords;
+}
+
 //+----------------------------------------------------------------------------
 //
 //  Member:    CHwTVertexBuffer<TVertex>::Builder::BeginBuilding
@@ -1996,6 +2129,7 @@ pub fn BeginBuilding(&mut self,
 
     self.m_fHasFlushed = false;
     self.m_pVB.Reset(/*self*/);
+    self.m_cLastTrapezoidStripEnd = UINT::MAX;
 
     // We need to know the viewport that this vertex buffer will be applied
     // to because a horizontal line through the first row of the viewport
@@ -2023,7 +2157,20 @@ impl IGeometrySink for CHwVertexBufferBuilder {
     {
         let hr = S_OK;
     
-        if (/*self.AreWaffling()*/ false)
+        if (self.m_fOutputRecords)
+        {
+            self.m_pDeviceNoRef.trapezoids.borrow_mut().push(OutputTrapezoid {
+                y_top: rPixelYTop,
+                x_top_left: rPixelXTopLeft,
+                x_top_right: rPixelXTopRight,
+                y_bottom: rPixelYBottom,
+                x_bottom_left: rPixelXBottomLeft,
+                x_bottom_right: rPixelXBottomRight,
+                left_delta: rPixelXLeftDelta,
+                right_delta: rPixelXRightDelta,
+            });
+        }
+        else if (/*self.AreWaffling()*/ false)
         {
             /*IFC(AddTrapezoidWaffle(
                     rPixelYTop,
@@ -2055,6 +2202,8 @@ impl IGeometrySink for CHwVertexBufferBuilder {
 
     fn IsEmpty(&self) -> bool {
         self.m_pVB.IsEmpty()
+            && self.m_pDeviceNoRef.trapezoids.borrow().is_empty()
+            && self.m_pDeviceNoRef.spans.borrow().is_empty()
     }
 
 /* 
@@ -2204,13 +2353,38 @@ Cleanup:
     fn AddComplexScan(&mut self,
         nPixelY: INT,
             // In: y coordinate in pixel space
-            mut pIntervalSpanStart: Ref<crate::aacoverage::CCoverageInterval>
-            // In: coverage segments
+            rgIntervals: &[crate::aacoverage::CCoverageInterval]
+            // In: coverage segments, linked from c_iIntervalHead
         ) -> HRESULT {
 
     let hr: HRESULT = S_OK;
     //let pVertex: *mut CD3DVertexXYZDUV2 = NULL();
 
+    if (self.m_fOutputRecords)
+    {
+        let mut spans = self.m_pDeviceNoRef.spans.borrow_mut();
+        let mut pInterval = &rgIntervals[crate::aacoverage::c_iIntervalHead as usize];
+
+        while (pInterval.m_nPixelX != INT::MAX)
+        {
+            let pIntervalNext = &rgIntervals[pInterval.m_iNext as usize];
+
+            if (pInterval.m_nCoverage != 0)
+            {
+                spans.push(OutputSpan {
+                    y: nPixelY,
+                    x_begin: pInterval.m_nPixelX,
+                    x_end: pIntervalNext.m_nPixelX,
+                    coverage: (pInterval.m_nCoverage as f32)/(c_nShiftSizeSquared as f32),
+                });
+            }
+
+            pInterval = pIntervalNext;
+        }
+
+        RRETURN!(hr);
+    }
+
     IFC!(self.PrepareStratum((nPixelY) as f32,
                   (nPixelY+1) as f32, 
                   false, /* Not a trapezoid. */ 
@@ -2273,13 +2447,35 @@ Cleanup:
         }*/
     }
 
+    //
+    // Count the segments so that the vertices for all of them can be added
+    // at once instead of growing the strip one line at a time.
+    //
+
+    let mut nSegmentCount: UINT = 0;
+    let mut pIntervalSpanTemp = &rgIntervals[crate::aacoverage::c_iIntervalHead as usize];
+
+    while (pIntervalSpanTemp.m_nPixelX != INT::MAX)
+    {
+        if (self.NeedCoverageGeometry(pIntervalSpanTemp.m_nCoverage))
+        {
+            nSegmentCount += 1;
+        }
+        pIntervalSpanTemp = &rgIntervals[pIntervalSpanTemp.m_iNext as usize];
+    }
+
+    let mut iVertex = self.m_pVB.GetTriStripVertexCount();
+    self.m_pVB.AddLineTriStripVertices(nSegmentCount);
+
     //
     // Having allocated space (if not using sink), now let's actually output the vertices.
     //
 
-    while ((*pIntervalSpanStart).m_nPixelX.get() != INT::MAX)
+    let mut pIntervalSpanStart = &rgIntervals[crate::aacoverage::c_iIntervalHead as usize];
+
+    while (pIntervalSpanStart.m_nPixelX != INT::MAX)
     {
-        assert!(!(*pIntervalSpanStart).m_pNext.get().is_null());
+        assert!(pIntervalSpanStart.m_iNext != crate::aacoverage::c_iIntervalNone);
 
         //
         // Output line list segments
@@ -2295,12 +2491,14 @@ Cleanup:
         // Since our top left corner is integer, we add 0.5 to get to the
         // pixel center.
         //
-        if (self.NeedCoverageGeometry((*pIntervalSpanStart).m_nCoverage.get()))
+        let pIntervalSpanNext = &rgIntervals[pIntervalSpanStart.m_iNext as usize];
+
+        if (self.NeedCoverageGeometry(pIntervalSpanStart.m_nCoverage))
         {
-            let rCoverage: f32 = ((*pIntervalSpanStart).m_nCoverage.get() as f32)/(c_nShiftSizeSquared as f32);
+            let rCoverage: f32 = (pIntervalSpanStart.m_nCoverage as f32)/(c_nShiftSizeSquared as f32);
             
-            let mut iBegin: LONG = (*pIntervalSpanStart).m_nPixelX.get();
-            let mut iEnd: LONG = (*(*pIntervalSpanStart).m_pNext.get()).m_nPixelX.get();
+            let mut iBegin: LONG = pIntervalSpanStart.m_nPixelX;
+            let mut iEnd: LONG = pIntervalSpanNext.m_nPixelX;
             if (self.NeedOutsideGeometry())
             {
                 // Intersect the interval with the outside bounds to create
@@ -2326,16 +2524,14 @@ Cleanup:
 
             //if let Some(pLineSink) = pLineSink 
             {
-                let mut v0: PointXYA = Default::default(); let mut v1: PointXYA = Default::default();
-                v0.x = rPixelXBegin;
-                v0.y = rPixelY;
-                v0.a = rCoverage;
-
-                v1.x = rPixelXEnd;
-                v1.y = rPixelY;
-                v1.a = rCoverage;
-
-                IFC!(self.m_pVB.AddLine(&v0,&v1));
+                FillLineAsTriangleStrip(
+                    self.m_pVB.GetTriStripVertices(iVertex, 6),
+                    rPixelXBegin,
+                    rPixelXEnd,
+                    rPixelY,
+                    rCoverage.to_bits()
+                    );
+                iVertex += 6;
             }
             //else
             {
@@ -2354,12 +2550,26 @@ Cleanup:
                 pVertex += 2;*/
             }
         }
+        else if (self.m_fReportInterior && pIntervalSpanStart.m_nCoverage == c_nShiftSizeSquared)
+        {
+            let rPixelXBegin = pIntervalSpanStart.m_nPixelX as f32;
+            let rPixelXEnd = pIntervalSpanNext.m_nPixelX as f32;
+
+            self.AddInteriorTrapezoid(
+                nPixelY as f32,
+                rPixelXBegin,
+                rPixelXEnd,
+                (nPixelY + 1) as f32,
+                rPixelXBegin,
+                rPixelXEnd
+                );
+        }
 
         //
         // Advance coverage buffer
         //
 
-        pIntervalSpanStart = (*pIntervalSpanStart).m_pNext.get();
+        pIntervalSpanStart = pIntervalSpanNext;
     }
 
 
@@ -2381,6 +2591,58 @@ Cleanup:
 //             longer be needed.  (Pixel center conventions will also change.)
 //              
 //-----------------------------------------------------------------------------
+//+----------------------------------------------------------------------------
+//
+//  Function:  FillLineAsTriangleStrip
+//
+//  Synopsis:  Write the 6 vertices AddLineAsTriangleStrip adds for a line
+//             from pixel center (rPixelXBegin, rPixelY) to (rPixelXEnd,
+//             rPixelY) into pVertex.
+//
+//-----------------------------------------------------------------------------
+fn FillLineAsTriangleStrip(
+    pVertex: &mut [CD3DVertexXYZDUV2],
+    rPixelXBegin: f32,
+    rPixelXEnd: f32,
+    rPixelY: f32,
+    dwDiffuse: DWORD
+    )
+{
+    // Offset begin and end X left by 0.5 because the line starts on the first
+    // pixel center and ends on the center of the pixel after the line segment.
+    let x0 = rPixelXBegin - 0.5;
+    let x1 = rPixelXEnd - 0.5;
+
+    // Offset two vertices up and two down to form a 1-pixel-high quad.
+    // Order is TL-BL-TR-BR.
+    //
+    // The first vertex is duplicated.  Assuming that the previous two
+    // vertices in the tristrip are coincident then the first three
+    // vertices here create degenerate triangles.  If this is the
+    // beginning of the strip the first two vertices fill the pipe,
+    // the third creates a degenerate vertex.  In either case the
+    // fourth creates the first triangle in our quad.
+    //
+    // The last vertex is duplicated too. This creates a degenerate triangle
+    // and sets up the next tristrip to create three more degenerate
+    // triangles.
+    let rgPosition: [(f32, f32); 6] = [
+        (x0, rPixelY - 0.5),
+        (x0, rPixelY - 0.5),
+        (x0, rPixelY + 0.5),
+        (x1, rPixelY - 0.5),
+        (x1, rPixelY + 0.5),
+        (x1, rPixelY + 0.5),
+        ];
+
+    for (pVertex, &(x, y)) in pVertex[..6].iter_mut().zip(&rgPosition)
+    {
+        pVertex.X = x;
+        pVertex.Y = y;
+        pVertex.Diffuse = dwDiffuse;
+    }
+}
+
 impl CHwVertexBuffer {
     fn AddLineAsTriangleStrip(&mut self,
     pBegin: &CD3DVertexXYZDUV2, // Begin
@@ -2393,54 +2655,13 @@ impl CHwVertexBuffer {
     debug_assert!(pBegin.Y == pEnd.Y);
     debug_assert!(pBegin.Diffuse == pEnd.Diffuse);
 
-    // Offset begin and end X left by 0.5 because the line starts on the first
-    // pixel center and ends on the center of the pixel after the line segment.
-    let x0 = pBegin.X - 0.5;
-    let x1 = pEnd.X - 0.5;
-    let y = pBegin.Y;
-    let dwDiffuse = pBegin.Diffuse;
-
     //
     // Add the vertices
     //
 
     let pVertex = self.AddTriStripVertices(6);
 
-    //
-    // Duplicate the first vertex.  Assuming that the previous two
-    // vertices in the tristrip are coincident then the first three
-    // vertices here create degenerate triangles.  If this is the
-    // beginning of the strip the first two vertices fill the pipe,
-    // the third creates a degenerate vertex.  In either case the
-    // fourth creates the first triangle in our quad.
-    // 
-    pVertex[0].X = x0;
-    pVertex[0].Y = y  - 0.5;
-    pVertex[0].Diffuse = dwDiffuse;
-    
-    // Offset two vertices up and two down to form a 1-pixel-high quad.
-    // Order is TL-BL-TR-BR.
-    pVertex[1].X = x0;
-    pVertex[1].Y = y  - 0.5;
-    pVertex[1].Diffuse = dwDiffuse;
-    pVertex[2].X = x0;
-    pVertex[2].Y = y  + 0.5;
-    pVertex[2].Diffuse = dwDiffuse;
-    pVertex[3].X = x1;
-    pVertex[3].Y = y  - 0.5;
-    pVertex[3].Diffuse = dwDiffuse;
-    pVertex[4].X = x1;
-    pVertex[4].Y = y  + 0.5;
-    pVertex[4].Diffuse = dwDiffuse;
-    
-    //
-    // Duplicate the last vertex. This creates a degenerate triangle
-    // and sets up the next tristrip to create three more degenerate
-    // triangles.
-    // 
-    pVertex[5].X = x1;
-    pVertex[5].Y = y  + 0.5;
-    pVertex[5].Diffuse = dwDiffuse;
+    FillLineAsTriangleStrip(pVertex, pBegin.X, pEnd.X, pBegin.Y, pBegin.Diffuse);
 
   //Cleanup:
     RRETURN!(hr);
@@ -2458,12 +2679,13 @@ impl CHwVertexBuffer {
     fn DrawPrimitive(&self,
         pDevice: &CD3DDeviceLevel1
         ) -> HRESULT {
-            let mut output = Vec::with_capacity(self.m_rgVerticesTriStrip.GetCount());
+            // Append to the device's output so that a caller supplied
+            // buffer keeps its allocation across draws.
+            // Extending from an exact size iterator does the conversion in one
+            // tight loop without a capacity check per vertex.
+            let mut output = pDevice.output.borrow_mut();
             let data = self.m_rgVerticesTriStrip.GetDataBuffer();
-            for vert in  data {
-                output.push(OutputVertex {x: vert.X, y: vert.Y, coverage: f32::from_bits(vert.Diffuse)})
-            }
-            pDevice.output.replace(output);
+            output.extend(data.iter().map(|vert| OutputVertex {x: vert.X, y: vert.Y, coverage: f32::from_bits(vert.Diffuse)}));
             return S_OK;
         }
 
@@ -2703,6 +2925,42 @@ fn AddTrapezoidStandard(&mut self,
     fNeedOutsideGeometry = self.NeedOutsideGeometry();
     fNeedInsideGeometry = self.NeedInsideGeometry();
 
+    if (self.m_fReportInterior)
+    {
+        self.AddInteriorTrapezoid(
+            rPixelYTop,
+            rPixelXTopLeft + rPixelXLeftDelta,
+            rPixelXTopRight - rPixelXRightDelta,
+            rPixelYBottom,
+            rPixelXBottomLeft + rPixelXLeftDelta,
+            rPixelXBottomRight - rPixelXRightDelta
+            );
+    }
+
+    if (!fNeedOutsideGeometry
+        && self.CanContinueTrapezoidStrip(
+            rPixelYTop,
+            rPixelXTopLeft,
+            rPixelXTopRight,
+            rPixelXBottomLeft - rPixelXTopLeft,
+            rPixelXBottomRight - rPixelXTopRight,
+            rPixelXLeftDelta,
+            rPixelXRightDelta
+            ))
+    {
+        self.ContinueTrapezoidStrip(
+            rPixelYTop,
+            rPixelXTopLeft,
+            rPixelXTopRight,
+            rPixelYBottom,
+            rPixelXBottomLeft,
+            rPixelXBottomRight,
+            rPixelXLeftDelta,
+            rPixelXRightDelta
+            );
+        RRETURN!(hr);
+    }
+
     if (!fNeedOutsideGeometry)
     {
         // For duplicates at beginning and end required to skip outside
@@ -2802,11 +3060,207 @@ fn AddTrapezoidStandard(&mut self,
         pVertex[i].Y = rPixelYBottom;
         pVertex[i].Diffuse = FLOAT_ZERO;
         // i += 1;
+
+        self.m_cLastTrapezoidStripEnd = self.m_pVB.GetTriStripVertexCount();
+        self.m_rLastTrapezoidBottom = rPixelYBottom;
+        self.m_rLastTrapezoidX = rPixelXBottomRight;
+        self.m_rLastTrapezoidXDelta = rPixelXRightDelta;
+        self.m_rLastTrapezoidXAdvance = rPixelXBottomRight - rPixelXTopRight;
+        self.m_fLastTrapezoidEndedLeft = false;
     }
 
 //Cleanup:
     RRETURN!(hr);
 }
+
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::Builder::CanContinueTrapezoidStrip
+//
+//  Synopsis:  Returns true if the trapezoid described by the arguments
+//             starts where the last one added ended and continues the
+//             edge the strip ended on, so that the outer vertex at the end
+//             of the strip is also a corner of the new trapezoid and joins
+//             the two with a zero area triangle.
+//
+fn CanContinueTrapezoidStrip(&self,
+    rPixelYTop: f32,              // In: y coordinate of top of trapezoid
+    rPixelXTopLeft: f32,          // In: x coordinate for top left
+    rPixelXTopRight: f32,         // In: x coordinate for top right
+    rPixelXLeftAdvance: f32,      // In: bottom left x minus top left x
+    rPixelXRightAdvance: f32,     // In: bottom right x minus top right x
+    rPixelXLeftDelta: f32,        // In: trapezoid expand radius for left edge
+    rPixelXRightDelta: f32        // In: trapezoid expand radius for right edge
+    ) -> bool
+{
+    if (self.m_cLastTrapezoidStripEnd != self.m_pVB.GetTriStripVertexCount()
+        || rPixelYTop != self.m_rLastTrapezoidBottom)
+    {
+        return false;
+    }
+
+    let (rPixelX, rPixelXAdvance, rPixelXDelta) = if self.m_fLastTrapezoidEndedLeft {
+        (rPixelXTopLeft, rPixelXLeftAdvance, rPixelXLeftDelta)
+    } else {
+        (rPixelXTopRight, rPixelXRightAdvance, rPixelXRightDelta)
+    };
+
+    // The expand radius only depends on the magnitude of the slope so also
+    // check that the edge keeps leaning the same way.
+
+    return rPixelX == self.m_rLastTrapezoidX
+        && rPixelXDelta == self.m_rLastTrapezoidXDelta
+        && (rPixelXAdvance > 0.) == (self.m_rLastTrapezoidXAdvance > 0.)
+        && (rPixelXAdvance < 0.) == (self.m_rLastTrapezoidXAdvance < 0.);
+}
+
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::Builder::ContinueTrapezoidStrip
+//
+//  Synopsis:  See AddTrapezoidStandard.  Adds a trapezoid that passed
+//             CanContinueTrapezoidStrip by walking it starting from the side
+//             the strip ended on.  The walk direction alternates from one
+//             trapezoid to the next, and the duplicates that would end the
+//             previous run and start this one are not needed, so this takes
+//             7 vertices instead of 10 (9 instead of 12 when skipping inside
+//             geometry.)
+//
+fn ContinueTrapezoidStrip(&mut self,
+    rPixelYTop: f32,              // In: y coordinate of top of trapezoid
+    rPixelXTopLeft: f32,          // In: x coordinate for top left
+    rPixelXTopRight: f32,         // In: x coordinate for top right
+    rPixelYBottom: f32,           // In: y coordinate of bottom of trapezoid
+    rPixelXBottomLeft: f32,       // In: x coordinate for bottom left
+    rPixelXBottomRight: f32,      // In: x coordinate for bottom right
+    rPixelXLeftDelta: f32,        // In: trapezoid expand radius for left edge
+    rPixelXRightDelta: f32        // In: trapezoid expand radius for right edge
+    )
+{
+    let fNeedInsideGeometry = self.NeedInsideGeometry();
+    let fFromLeft = self.m_fLastTrapezoidEndedLeft;
+
+    // Vertical vertex pairs from left to right as (top x, bottom x, coverage)
+
+    let rgColumns: [(f32, f32, DWORD); 4] = [
+        (rPixelXTopLeft - rPixelXLeftDelta, rPixelXBottomLeft - rPixelXLeftDelta, FLOAT_ZERO),
+        (rPixelXTopLeft + rPixelXLeftDelta, rPixelXBottomLeft + rPixelXLeftDelta, FLOAT_ONE),
+        (rPixelXTopRight - rPixelXRightDelta, rPixelXBottomRight - rPixelXRightDelta, FLOAT_ONE),
+        (rPixelXTopRight + rPixelXRightDelta, rPixelXBottomRight + rPixelXRightDelta, FLOAT_ZERO),
+        ];
+    let rgOrder: [usize; 4] = if fFromLeft { [0, 1, 2, 3] } else { [3, 2, 1, 0] };
+
+    // 7 new vertices, the duplicate ending the run and the one replacing
+    // the previous run's end.
+    let mut cVertices: UINT = 8;
+
+    if (!fNeedInsideGeometry)
+    {
+        cVertices += 2;
+    }
+
+    let pVertex = self.m_pVB.ContinueTriStripVertices(cVertices);
+
+    let mut i = 0;
+    for (k, &iColumn) in rgOrder.iter().enumerate()
+    {
+        let (rPixelXTop, rPixelXBottom, dwDiffuse) = rgColumns[iColumn];
+
+        if (k != 0)
+        {
+            // The top of the first column is the vertex the strip ended on.
+            pVertex[i].X = rPixelXTop;
+            pVertex[i].Y = rPixelYTop;
+            pVertex[i].Diffuse = dwDiffuse;
+            i += 1;
+        }
+
+        pVertex[i].X = rPixelXBottom;
+        pVertex[i].Y = rPixelYBottom;
+        pVertex[i].Diffuse = dwDiffuse;
+        i += 1;
+
+        if (k == 1 && !fNeedInsideGeometry)
+        {
+            // Don't create inside geometry.
+            let (rPixelXTopNext, _, dwDiffuseNext) = rgColumns[rgOrder[2]];
+
+            pVertex[i].X = rPixelXBottom;
+            pVertex[i].Y = rPixelYBottom;
+            pVertex[i].Diffuse = dwDiffuse;
+            i += 1;
+
+            pVertex[i].X = rPixelXTopNext;
+            pVertex[i].Y = rPixelYTop;
+            pVertex[i].Diffuse = dwDiffuseNext;
+            i += 1;
+        }
+    }
+
+    // Duplicate the last vertex to end the run.
+    pVertex[i].X = pVertex[i - 1].X;
+    pVertex[i].Y = pVertex[i - 1].Y;
+    pVertex[i].Diffuse = pVertex[i - 1].Diffuse;
+
+    self.m_cLastTrapezoidStripEnd = self.m_pVB.GetTriStripVertexCount();
+    self.m_rLastTrapezoidBottom = rPixelYBottom;
+    if fFromLeft {
+        self.m_rLastTrapezoidX = rPixelXBottomRight;
+        self.m_rLastTrapezoidXDelta = rPixelXRightDelta;
+        self.m_rLastTrapezoidXAdvance = rPixelXBottomRight - rPixelXTopRight;
+    } else {
+        self.m_rLastTrapezoidX = rPixelXBottomLeft;
+        self.m_rLastTrapezoidXDelta = rPixelXLeftDelta;
+        self.m_rLastTrapezoidXAdvance = rPixelXBottomLeft - rPixelXTopLeft;
+    }
+    self.m_fLastTrapezoidEndedLeft = !fFromLeft;
+}
+
+//+----------------------------------------------------------------------------
+//
+//  Member:    CHwTVertexBuffer<TVertex>::Builder::AddInteriorTrapezoid
+//
+//  Synopsis:  Report an area of full coverage to the device.  A rectangle
+//             right below the last one reported and just as wide extends
+//             it instead, so that runs of full coverage spans become a
+//             single rectangle.
+//
+fn AddInteriorTrapezoid(&self,
+    rPixelYTop: f32,              // In: y coordinate of top of trapezoid
+    rPixelXTopLeft: f32,          // In: x coordinate for top left
+    rPixelXTopRight: f32,         // In: x coordinate for top right
+    rPixelYBottom: f32,           // In: y coordinate of bottom of trapezoid
+    rPixelXBottomLeft: f32,       // In: x coordinate for bottom left
+    rPixelXBottomRight: f32       // In: x coordinate for bottom right
+    )
+{
+    let mut interior = self.m_pDeviceNoRef.interior.borrow_mut();
+
+    if (rPixelXTopLeft == rPixelXBottomLeft && rPixelXTopRight == rPixelXBottomRight)
+    {
+        if let Some(pLast) = interior.last_mut()
+        {
+            if (pLast.y_bottom == rPixelYTop
+                && pLast.x_top_left == rPixelXTopLeft
+                && pLast.x_bottom_left == rPixelXTopLeft
+                && pLast.x_top_right == rPixelXTopRight
+                && pLast.x_bottom_right == rPixelXTopRight)
+            {
+                pLast.y_bottom = rPixelYBottom;
+                return;
+            }
+        }
+    }
+
+    interior.push(InteriorTrapezoid {
+        y_top: rPixelYTop,
+        x_top_left: rPixelXTopLeft,
+        x_top_right: rPixelXTopRight,
+        y_bottom: rPixelYBottom,
+        x_bottom_left: rPixelXBottomLeft,
+        x_bottom_right: rPixelXBottomRight,
+    });
+}
 }
 /* 
 //+----------------------------------------------------------------------------
@@ -2930,13 +3384,14 @@ fn NeedCoverageGeometry(&self,
     //
     //  Synopsis:  True if we should create geometry for areas completely
     //             withing the input geometry (i.e. alpha 1.)  Should only
-    //             be false if NeedOutsideGeometry is true.
+    //             be false if NeedOutsideGeometry is true or those areas
+    //             are reported separately (see SetReportInterior.)
     //
     //-------------------------------------------------------------------------
     fn NeedInsideGeometry(&self) -> bool
     {
         assert!(self.m_fNeedOutsideGeometry || self.m_fNeedInsideGeometry);
-        return self.m_fNeedInsideGeometry;
+        return self.m_fNeedInsideGeometry && !self.m_fReportInterior;
     }
 
 
@@ -3233,6 +3688,7 @@ fn FlushInternal(&mut self,
     {
         self.m_fHasFlushed = true;
         self.m_pVB.Reset();
+        self.m_cLastTrapezoidStripEnd = UINT::MAX;
 
         //self.m_rgoPrecomputedTriListVertices = NULL();
         //self.m_cPrecomputedTriListVertices = 0;
@@ -32,6 +32,7 @@ mod hwrasterizer;
 mod aacoverage;
 mod hwvertexbuffer;
 
+mod allocator;
 mod types;
 mod geometry_sink;
 mod matrix;
@@ -41,13 +42,23 @@ mod nullable_ref;
 #[cfg(feature = "c_bindings")]
 pub mod c_bindings;
 
-use std::{rc::Rc, cell::RefCell};
+#[cfg(feature = "bench_internals")]
+#[doc(hidden)]
+pub mod bench_internals;
 
+use std::{rc::Rc, cell::RefCell, ffi::c_void};
+
+use allocator::CTransientAllocator;
 use hwrasterizer::CHwRasterizer;
 use hwvertexbuffer::CHwVertexBufferBuilder;
 use matrix::CMatrix;
-use types::{CoordinateSpace, CD3DDeviceLevel1, IShapeData, MilFillMode, PathPointTypeStart, MilPoint2F, PathPointTypeLine, MilVertexFormat, MilVertexFormatAttribute, DynArray, BYTE, PathPointTypeBezier, PathPointTypeCloseSubpath, CMILSurfaceRect};
+use aarasterizer::{CEdgeTableHeader, ReadEdgeTableHeader, ValidatePathTypes};
+use aacoverage::c_antiAliasMode;
+use types::{CBufferDispenser, PathPointTypePathTypeMask, HRESULT, S_OK, E_INVALIDARG, FAILED, CoordinateSpace, CD3DDeviceLevel1, IShapeData, MilFillMode, MilAntiAliasMode, MilVertexFormat, MilVertexFormatAttribute, DynArray, BYTE, CMILSurfaceRect};
+
 
+pub use allocator::{TransientAllocFn, TransientFreeFn};
+pub use types::{MilPoint2F, MilPointAndSizeF, PathPointTypeStart, PathPointTypeLine, PathPointTypeBezier, PathPointTypeCloseSubpath};
 
 #[repr(C)]
 #[derive(Debug, Default)]
@@ -57,6 +68,48 @@ pub struct OutputVertex {
     pub coverage: f32
 }
 
+/// An area of full coverage reported by `PathBuilder::rasterize_edges_into`.
+/// The top and bottom are horizontal; the corners are in device pixels.
+#[repr(C)]
+#[derive(Debug, Default, Clone, PartialEq)]
+pub struct InteriorTrapezoid {
+    pub y_top: f32,
+    pub x_top_left: f32,
+    pub x_top_right: f32,
+    pub y_bottom: f32,
+    pub x_bottom_left: f32,
+    pub x_bottom_right: f32,
+}
+
+/// A trapezoid produced by `PathBuilder::rasterize_trapezoids_into`. The
+/// top and bottom are horizontal. Across the left side the coverage ramps
+/// from 0 at `x - left_delta` to 1 at `x + left_delta`, and across the
+/// right side from 1 at `x - right_delta` to 0 at `x + right_delta`, just
+/// like in the triangle strip.
+#[repr(C)]
+#[derive(Debug, Default, Clone, PartialEq)]
+pub struct OutputTrapezoid {
+    pub y_top: f32,
+    pub x_top_left: f32,
+    pub x_top_right: f32,
+    pub y_bottom: f32,
+    pub x_bottom_left: f32,
+    pub x_bottom_right: f32,
+    pub left_delta: f32,
+    pub right_delta: f32,
+}
+
+/// A run of pixels `x_begin..x_end` in row `y` with constant coverage,
+/// produced by `PathBuilder::rasterize_trapezoids_into`.
+#[repr(C)]
+#[derive(Debug, Default, Clone, PartialEq)]
+pub struct OutputSpan {
+    pub y: i32,
+    pub x_begin: i32,
+    pub x_end: i32,
+    pub coverage: f32,
+}
+
 #[repr(C)]
 pub enum FillMode {
     EvenOdd = 0,
@@ -78,7 +131,13 @@ pub struct PathBuilder {
     in_shape: bool,
     fill_mode: MilFillMode,
     outside_bounds: Option<CMILSurfaceRect>,
-    need_inside: bool
+    need_inside: bool,
+    simplify_tolerance: f32,
+    chain_tolerance: f32,
+    antialias: bool,
+    edge_threads: usize,
+    // Transient rasterizer allocations kept between calls
+    scratch: RefCell<CBufferDispenser>,
 }
 
 impl PathBuilder {
@@ -91,6 +150,11 @@ impl PathBuilder {
         fill_mode: MilFillMode::Alternate,
         outside_bounds: None,
         need_inside: true,
+        simplify_tolerance: 0.,
+        chain_tolerance: 0.,
+        antialias: true,
+        edge_threads: 1,
+        scratch: Default::default(),
         }
     }
     pub fn line_to(&mut self, x: f32, y: f32) {
@@ -152,6 +216,47 @@ impl PathBuilder {
         self.in_shape = false;
         self.initial_point = None;
     }
+    /// Adds a closed rectangle subpath. A path that consists of a single
+    /// axis-aligned rectangle takes a faster route through the rasterizer.
+    pub fn add_rect(&mut self, x: f32, y: f32, width: f32, height: f32) {
+        self.move_to(x, y);
+        self.line_to(x + width, y);
+        self.line_to(x + width, y + height);
+        self.line_to(x, y + height);
+        self.close();
+    }
+    /// Reserves room for at least `additional` more points.
+    pub fn reserve(&mut self, additional: usize) {
+        self.points.reserve(additional);
+        self.types.reserve(additional);
+    }
+    /// Equivalent to calling `line_to` for each point in turn.
+    pub fn append_polyline(&mut self, points: &[MilPoint2F]) {
+        self.reserve(points.len() + 1);
+        for p in points {
+            self.line_to(p.X, p.Y);
+        }
+    }
+    /// Appends complete subpaths in the `rasterize_path` format.
+    ///
+    /// If the last appended subpath isn't closed, subsequent calls to
+    /// `line_to` and `curve_to` continue it.
+    ///
+    /// Returns false, without modifying the builder, if the slices
+    /// don't describe a valid path.
+    pub fn append_path(&mut self, points: &[MilPoint2F], types: &[u8]) -> bool {
+        if points.len() != types.len() || points.len() > i32::MAX as usize || !ValidatePathTypes(types, types.len() as i32) {
+            return false;
+        }
+        if let Some(&last) = types.last() {
+            let start = types.iter().rposition(|&t| t & PathPointTypePathTypeMask == PathPointTypeStart).unwrap();
+            self.in_shape = last & PathPointTypeCloseSubpath == 0;
+            self.initial_point = if self.in_shape { Some(points[start]) } else { None };
+        }
+        self.points.extend_from_slice(points);
+        self.types.extend_from_slice(types);
+        true
+    }
     pub fn set_fill_mode(&mut self, fill_mode: FillMode) {
         self.fill_mode = match fill_mode {
             FillMode::EvenOdd => MilFillMode::Alternate,
@@ -170,57 +275,319 @@ impl PathBuilder {
         self.outside_bounds = outside_bounds.map(|r| CMILSurfaceRect { left: r.0, top: r.1, right: r.2, bottom: r.3 });
         self.need_inside = need_inside;
     }
+    /// Lets the rasterizer drop vertices of lines and flattened curves
+    /// that are within `tolerance` device pixels of the path without
+    /// them. Dense polylines such as map data then produce far fewer
+    /// edges and longer trapezoids, at the cost of moving the outline by
+    /// up to `tolerance`. The default of 0 keeps every vertex.
+    pub fn set_simplify_tolerance(&mut self, tolerance: f32) {
+        self.simplify_tolerance = tolerance;
+    }
+    /// Lets anti-aliased trapezoids continue across the joints between
+    /// consecutive lines of the outline, as long as each joint is within
+    /// `tolerance` device pixels of the trapezoid's side. Outlines made of
+    /// many short lines, such as flattened curves, then produce far fewer,
+    /// taller trapezoids and fewer partial coverage spans. The default
+    /// of 0 never chains trapezoids.
+    pub fn set_trapezoid_chain_tolerance(&mut self, tolerance: f32) {
+        self.chain_tolerance = tolerance;
+    }
+    /// With `antialias` off, each pixel is sampled once at its center and
+    /// is either fully covered or not covered at all. The output then only
+    /// holds full coverage spans and hard-edged rectangles, and takes far
+    /// less work to produce. This suits hit-test masks, stencil clips and
+    /// pixel art. The default is on. Edge tables are always anti-aliased.
+    pub fn set_antialias(&mut self, antialias: bool) {
+        self.antialias = antialias;
+    }
+    /// Lets the rasterizer flatten the subpaths and build their edges on up
+    /// to `threads` threads. This speeds up paths made of many subpaths,
+    /// such as merged text outlines or map features; paths with fewer than
+    /// a few thousand points per thread stay on the calling thread. The
+    /// output is the same either way. The default of 1 never starts threads.
+    pub fn set_edge_building_threads(&mut self, threads: usize) {
+        self.edge_threads = threads;
+    }
+    /// Makes the rasterizer allocate its transient buffers (the sorted edge
+    /// array, edges past the built-in storage, the coverage intervals, the
+    /// aliased pixel spans and the vertex storage) with `alloc` and give
+    /// them back with `free`, for example from a per-frame arena. The
+    /// buffers are kept between rasterize calls as usual, so once they have
+    /// grown to fit the paths nothing more is allocated. Call
+    /// `release_buffers` to give them all back before the memory behind
+    /// `alloc` is reset. Setting the allocator that is already set keeps
+    /// the buffers; setting another one frees them with the old `free`.
+    /// The output buffers still use the global allocator.
+    ///
+    /// # Safety
+    ///
+    /// `alloc` must return memory of the requested size and alignment, or
+    /// null, and `free` must accept it back. Both are called with
+    /// `user_data` until the builder is dropped or another allocator is
+    /// set. Memory handed out by `alloc` must stay valid until it is given
+    /// back to `free`. They are called on the thread that rasterizes and,
+    /// with `set_edge_building_threads` above 1, also from the edge
+    /// building threads, at the same time as each other.
+    pub unsafe fn set_allocator(&mut self, alloc: TransientAllocFn, free: TransientFreeFn, user_data: *mut c_void) {
+        let allocator = CTransientAllocator::new(alloc, free, user_data);
+        let scratch = self.scratch.get_mut();
+        if !scratch.m_allocator.IsSameAs(&allocator) {
+            *scratch = CBufferDispenser::new(allocator);
+        }
+    }
+    /// Gives the rasterizer's scratch buffers back to their allocator. They
+    /// are allocated again by the next rasterize call.
+    pub fn release_buffers(&mut self) {
+        self.scratch.get_mut().ReleaseBuffers();
+    }
+    /// Clears the path and restores the default settings while keeping
+    /// the allocated capacity, so the builder can be reused for another path.
+    ///
+    /// The builder also holds on to the rasterizer's internal scratch
+    /// buffers between calls. They are freed by `release_buffers` or when
+    /// the builder is dropped.
+    /// The allocator set with `set_allocator` is kept.
+    pub fn reset(&mut self) {
+        self.points.clear();
+        self.types.clear();
+        self.initial_point = None;
+        self.in_shape = false;
+        self.fill_mode = MilFillMode::Alternate;
+        self.outside_bounds = None;
+        self.need_inside = true;
+        self.simplify_tolerance = 0.;
+        self.chain_tolerance = 0.;
+        self.antialias = true;
+        self.edge_threads = 1;
+    }
     pub fn rasterize_to_tri_strip(&self, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> Box<[OutputVertex]> {
+        let mut output = Vec::new();
+        self.rasterize_into(clip_x, clip_y, clip_width, clip_height, &mut output);
+        output.into_boxed_slice()
+    }
+    /// Like `rasterize_to_tri_strip` but replaces the contents of `output`,
+    /// reusing its allocation.
+    pub fn rasterize_into(&self, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32, output: &mut Vec<OutputVertex>) {
+        rasterize_with(self.fill_mode, clip_x, clip_y, clip_width, clip_height, self.outside_bounds.as_ref(), self.need_inside, output, None, None, &mut self.scratch.borrow_mut(),
+            |rasterizer, vertexBuilder| self.send_geometry(rasterizer, vertexBuilder))
+    }
+    /// Like `rasterize_into` but leaves the areas of full coverage out of
+    /// the triangle strip, which then only holds the anti-aliased fringes
+    /// (and the outside geometry, if enabled). Those areas are stored in
+    /// `interior` instead, for the caller to fill with full coverage by
+    /// other means. Runs of full coverage scanlines of the same width are
+    /// merged into a single rectangle.
+    pub fn rasterize_edges_into(&self, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32, output: &mut Vec<OutputVertex>, interior: &mut Vec<InteriorTrapezoid>) {
+        rasterize_with(self.fill_mode, clip_x, clip_y, clip_width, clip_height, self.outside_bounds.as_ref(), self.need_inside, output, Some(interior), None, &mut self.scratch.borrow_mut(),
+            |rasterizer, vertexBuilder| self.send_geometry(rasterizer, vertexBuilder))
+    }
+    /// Rasterizes the path into its trapezoids and the spans of the
+    /// scanlines that aren't covered by trapezoids, without turning them
+    /// into vertices. This is for renderers that evaluate the coverage
+    /// themselves; drawing both lists gives the same result as the
+    /// triangle strip. Spans with zero coverage are left out and the
+    /// outside bounds are ignored.
+    pub fn rasterize_trapezoids_into(&self, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32, trapezoids: &mut Vec<OutputTrapezoid>, spans: &mut Vec<OutputSpan>) {
+        let mut output = Vec::new();
+        rasterize_with(self.fill_mode, clip_x, clip_y, clip_width, clip_height, None, true, &mut output, None, Some((trapezoids, spans)), &mut self.scratch.borrow_mut(),
+            |rasterizer, vertexBuilder| self.send_geometry(rasterizer, vertexBuilder));
+        debug_assert!(output.is_empty());
+    }
+    fn send_geometry(&self, rasterizer: &mut CHwRasterizer, vertexBuilder: Rc<RefCell<CHwVertexBufferBuilder>>) -> HRESULT {
+        rasterizer.SetSimplifyTolerance(self.simplify_tolerance);
+        rasterizer.SetTrapezoidChainTolerance(self.chain_tolerance);
+        rasterizer.SetAntiAliasMode(if self.antialias { c_antiAliasMode } else { MilAntiAliasMode::None });
+        rasterizer.SetEnumerateThreads(self.edge_threads);
+        rasterizer.SendGeometry(vertexBuilder, &self.points, &self.types)
+    }
+
+    /// Does all of the work of `rasterize_to_tri_strip` up to, but not including,
+    /// the scan conversion and returns the resulting edge table in a compact
+    /// binary form. The table can be stored (e.g. at asset build time) and
+    /// rasterized later with `rasterize_edge_table`, skipping path parsing,
+    /// flattening and sorting.
+    ///
+    /// The table captures the clip rectangle and fill mode in effect when it
+    /// was built.
+    pub fn build_edge_table(&self, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> Vec<u8> {
         let mut rasterizer = CHwRasterizer::new();
-        let mut device = CD3DDeviceLevel1::new();
-        
-        device.clipRect.X = clip_x;
-        device.clipRect.Y = clip_y;
-        device.clipRect.Width = clip_width;
-        device.clipRect.Height = clip_height;
-        let device = Rc::new(device);
-        /* 
-        device.m_rcViewport = device.clipRect;
-    */
+        let device = Rc::new(make_device(clip_x, clip_y, clip_width, clip_height));
         let worldToDevice: CMatrix<CoordinateSpace::Shape, CoordinateSpace::Device> = CMatrix::Identity();
+        rasterizer.Setup(device, Rc::new(PathShape { fill_mode: self.fill_mode }), Some(&worldToDevice));
+        rasterizer.SetSimplifyTolerance(self.simplify_tolerance);
+        rasterizer.SetEnumerateThreads(self.edge_threads);
 
-        struct PathShape {
-            fill_mode: MilFillMode,
-        }
+        let mut table = Vec::new();
+        rasterizer.BuildEdgeTable(&self.points, &self.types, &mut table);
+        table
+    }
+}
 
-        impl IShapeData for PathShape {
-            fn GetFillMode(&self) -> MilFillMode {
-                self.fill_mode
-            }
-        }
+/// Rasterizes a path that is already in the rasterizer's native format
+/// without copying it into a `PathBuilder`.
+///
+/// `points` and `types` run in parallel. Every subpath starts with a
+/// `PathPointTypeStart` point followed by `PathPointTypeLine` points and
+/// runs of three `PathPointTypeBezier` points. `PathPointTypeCloseSubpath`
+/// may be or'ed into the last type of a subpath. `MilPoint2F` is `repr(C)`,
+/// so both slices can point straight into a memory-mapped file.
+///
+/// Returns `None` if the slices don't describe a valid path.
+pub fn rasterize_path(points: &[MilPoint2F], types: &[u8], fill_mode: FillMode, clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> Option<Box<[OutputVertex]>> {
+    if points.len() != types.len() || points.len() > i32::MAX as usize || !ValidatePathTypes(types, types.len() as i32) {
+        return None;
+    }
+    let fill_mode = match fill_mode {
+        FillMode::EvenOdd => MilFillMode::Alternate,
+        FillMode::Winding => MilFillMode::Winding,
+    };
+    let mut output = Vec::new();
+    with_thread_scratch(|scratch| rasterize_with(fill_mode, clip_x, clip_y, clip_width, clip_height, None, true, &mut output, None, None, scratch,
+        |rasterizer, vertexBuilder| rasterizer.SendGeometry(vertexBuilder, points, types)));
+    Some(output.into_boxed_slice())
+}
+
+/// Rasterizes each of `rects` as if it were its own path and returns the
+/// concatenated output. Overlapping rectangles are not merged.
+pub fn rasterize_rects(rects: &[MilPointAndSizeF], clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> Box<[OutputVertex]> {
+    let mut output = Vec::new();
+    with_thread_scratch(|scratch| rasterize_with(MilFillMode::Alternate, clip_x, clip_y, clip_width, clip_height, None, true, &mut output, None, None, scratch,
+        |rasterizer, vertexBuilder| rasterizer.SendRectangles(vertexBuilder, rects)));
+    output.into_boxed_slice()
+}
 
-        let path = Rc::new(PathShape { fill_mode: self.fill_mode });
-    
-        rasterizer.Setup(device.clone(), path, Some(&worldToDevice));
-    
-        let mut m_mvfIn: MilVertexFormat = MilVertexFormatAttribute::MILVFAttrNone as MilVertexFormat;
-        let m_mvfGenerated: MilVertexFormat  = MilVertexFormatAttribute::MILVFAttrNone as MilVertexFormat;
-        //let mvfaAALocation  = MILVFAttrNone;
-        const HWPIPELINE_ANTIALIAS_LOCATION: MilVertexFormatAttribute = MilVertexFormatAttribute::MILVFAttrDiffuse;
-        let mvfaAALocation = HWPIPELINE_ANTIALIAS_LOCATION;
-        struct CHwPipeline {
-            m_pDevice: Rc<CD3DDeviceLevel1>
-        }
-        let pipeline =  CHwPipeline { m_pDevice: device.clone() };
-        let m_pHP = &pipeline;
-    
-        rasterizer.GetPerVertexDataType(&mut m_mvfIn);
-        let vertexBuilder= Rc::new(RefCell::new(CHwVertexBufferBuilder::Create(m_mvfIn,                                          m_mvfIn | m_mvfGenerated,
-            mvfaAALocation,
-            m_pHP.m_pDevice.clone())));
-    
-        vertexBuilder.borrow_mut().SetOutsideBounds(self.outside_bounds.as_ref(), self.need_inside);
-        vertexBuilder.borrow_mut().BeginBuilding();
-    
-        rasterizer.SendGeometry(vertexBuilder.clone(), &self.points, &self.types);
-        vertexBuilder.borrow_mut().FlushTryGetVertexBuffer(None);
-        device.output.replace(Vec::new()).into_boxed_slice()
+/// Rasterizes an edge table produced by `PathBuilder::build_edge_table`.
+///
+/// `table` is only read, so it can point straight into a memory-mapped file.
+/// Returns `None` if `table` is not a valid edge table.
+pub fn rasterize_edge_table(table: &[u8]) -> Option<Box<[OutputVertex]>> {
+    let mut header: CEdgeTableHeader = Default::default();
+    if FAILED(ReadEdgeTableHeader(table, &mut header)) {
+        return None;
     }
+    let fill_mode = if header.FillMode == MilFillMode::Winding as i32 { MilFillMode::Winding } else { MilFillMode::Alternate };
+    let clip = &header.ClipBounds;
+
+    let mut hr = S_OK;
+    let mut output = Vec::new();
+    with_thread_scratch(|scratch| rasterize_with(fill_mode, clip.X, clip.Y, clip.Width, clip.Height, None, true, &mut output, None, None, scratch,
+        |rasterizer, vertexBuilder| { hr = rasterizer.SendEdgeTable(vertexBuilder, table); hr }));
+    if hr == E_INVALIDARG {
+        return None;
+    }
+    Some(output.into_boxed_slice())
+}
+
+struct PathShape {
+    fill_mode: MilFillMode,
+}
+
+impl IShapeData for PathShape {
+    fn GetFillMode(&self) -> MilFillMode {
+        self.fill_mode
+    }
+}
+
+fn make_device(clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32) -> CD3DDeviceLevel1 {
+    let mut device = CD3DDeviceLevel1::new();
+
+    device.clipRect.X = clip_x;
+    device.clipRect.Y = clip_y;
+    device.clipRect.Width = clip_width;
+    device.clipRect.Height = clip_height;
+    /* 
+    device.m_rcViewport = device.clipRect;
+    */
+    device
+}
+
+// Sets up the rasterizer and vertex buffer builder, lets `send` feed geometry
+// into them and stores the resulting triangle strip in `output`. If
+// `interior` is given, areas of full coverage go there instead. If `records`
+// is given, trapezoids and spans go there and no vertices are generated.
+fn rasterize_with(
+    fill_mode: MilFillMode,
+    clip_x: i32, clip_y: i32, clip_width: i32, clip_height: i32,
+    outside_bounds: Option<&CMILSurfaceRect>,
+    need_inside: bool,
+    output: &mut Vec<OutputVertex>,
+    mut interior: Option<&mut Vec<InteriorTrapezoid>>,
+    mut records: Option<(&mut Vec<OutputTrapezoid>, &mut Vec<OutputSpan>)>,
+    scratch: &mut CBufferDispenser,
+    send: impl FnOnce(&mut CHwRasterizer, Rc<RefCell<CHwVertexBufferBuilder>>) -> HRESULT,
+) {
+    let mut rasterizer = CHwRasterizer::new();
+    let device = make_device(clip_x, clip_y, clip_width, clip_height);
+    output.clear();
+    device.output.replace(std::mem::take(output));
+    if let Some(interior) = &mut interior {
+        interior.clear();
+        device.interior.replace(std::mem::take(*interior));
+    }
+    if let Some((trapezoids, spans)) = &mut records {
+        trapezoids.clear();
+        spans.clear();
+        device.trapezoids.replace(std::mem::take(*trapezoids));
+        device.spans.replace(std::mem::take(*spans));
+    }
+    device.bufferDispenser.replace(std::mem::take(scratch));
+    let device = Rc::new(device);
+    let worldToDevice: CMatrix<CoordinateSpace::Shape, CoordinateSpace::Device> = CMatrix::Identity();
+
+    let path = Rc::new(PathShape { fill_mode });
+
+    rasterizer.Setup(device.clone(), path, Some(&worldToDevice));
+
+    let mut m_mvfIn: MilVertexFormat = MilVertexFormatAttribute::MILVFAttrNone as MilVertexFormat;
+    let m_mvfGenerated: MilVertexFormat  = MilVertexFormatAttribute::MILVFAttrNone as MilVertexFormat;
+    //let mvfaAALocation  = MILVFAttrNone;
+    const HWPIPELINE_ANTIALIAS_LOCATION: MilVertexFormatAttribute = MilVertexFormatAttribute::MILVFAttrDiffuse;
+    let mvfaAALocation = HWPIPELINE_ANTIALIAS_LOCATION;
+    struct CHwPipeline {
+        m_pDevice: Rc<CD3DDeviceLevel1>
+    }
+    let pipeline =  CHwPipeline { m_pDevice: device.clone() };
+    let m_pHP = &pipeline;
+
+    rasterizer.GetPerVertexDataType(&mut m_mvfIn);
+    let vertexBuilder= Rc::new(RefCell::new(CHwVertexBufferBuilder::Create(m_mvfIn,                                          m_mvfIn | m_mvfGenerated,
+        mvfaAALocation,
+        m_pHP.m_pDevice.clone())));
+
+    vertexBuilder.borrow_mut().SetOutsideBounds(outside_bounds, need_inside);
+    vertexBuilder.borrow_mut().SetReportInterior(interior.is_some());
+    vertexBuilder.borrow_mut().SetOutputRecords(records.is_some());
+    vertexBuilder.borrow_mut().BeginBuilding();
+
+    send(&mut rasterizer, vertexBuilder.clone());
+    vertexBuilder.borrow_mut().FlushTryGetVertexBuffer(None);
+    if let Ok(vertexBuilder) = Rc::try_unwrap(vertexBuilder) {
+        vertexBuilder.into_inner().ReleaseVertexBuffer();
+    }
+    *output = device.output.replace(Vec::new());
+    if let Some(interior) = interior {
+        *interior = device.interior.replace(Vec::new());
+    }
+    if let Some((trapezoids, spans)) = records {
+        *trapezoids = device.trapezoids.replace(Vec::new());
+        *spans = device.spans.replace(Vec::new());
+    }
+    *scratch = device.bufferDispenser.replace(Default::default());
+}
+
+thread_local! {
+    // Transient rasterizer allocations kept between calls to the free
+    // rasterize functions on this thread
+    static g_scratch: RefCell<CBufferDispenser> = Default::default();
+}
+
+// Runs 'f' with this thread's scratch buffers
+fn with_thread_scratch<R>(f: impl FnOnce(&mut CBufferDispenser) -> R) -> R {
+    g_scratch.with(|scratch| match scratch.try_borrow_mut() {
+        Ok(mut scratch) => f(&mut scratch),
+        // Only if 'f' rasterizes again from within 'send'
+        Err(_) => f(&mut Default::default()),
+    })
 }
 
 #[cfg(test)]
@@ -232,6 +599,35 @@ mod tests {
         t.hash(&mut s);
         s.finish()
     }
+    // Renders a triangle strip by sampling coverage at pixel centers
+    fn render(strip: &[OutputVertex], width: usize, height: usize) -> Vec<f32> {
+        let mut image = vec![0f32; width * height];
+        for t in strip.windows(3) {
+            let (a, b, c) = (&t[0], &t[1], &t[2]);
+            let area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+            if area == 0. {
+                continue;
+            }
+            let x0 = a.x.min(b.x).min(c.x).max(0.) as usize;
+            let x1 = (a.x.max(b.x).max(c.x).ceil().max(0.) as usize).min(width);
+            let y0 = a.y.min(b.y).min(c.y).max(0.) as usize;
+            let y1 = (a.y.max(b.y).max(c.y).ceil().max(0.) as usize).min(height);
+            for y in y0..y1 {
+                for x in x0..x1 {
+                    let (px, py) = (x as f32 + 0.5, y as f32 + 0.5);
+                    let wa = ((b.x - px) * (c.y - py) - (c.x - px) * (b.y - py)) / area;
+                    let wb = ((c.x - px) * (a.y - py) - (a.x - px) * (c.y - py)) / area;
+                    let wc = 1. - wa - wb;
+                    if wa >= 0. && wb >= 0. && wc >= 0. {
+                        let coverage = wa * a.coverage + wb * b.coverage + wc * c.coverage;
+                        let pixel = &mut image[y * width + x];
+                        *pixel = pixel.max(coverage);
+                    }
+                }
+            }
+        }
+        image
+    }
     #[test]
     fn basic() {
         let mut p = PathBuilder::new();
@@ -279,7 +675,7 @@ mod tests {
         p.line_to(15., 35.);
         p.close();
         let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
-        assert_eq!(dbg!(calculate_hash(&result)), 0xb34344234f2f75a8);
+        assert_eq!(dbg!(calculate_hash(&result)), 0x3b882af951f36d5e);
 
         let mut p = PathBuilder::new();
         p.move_to(10., 10.);
@@ -298,6 +694,330 @@ mod tests {
 
     }
 
+    #[test]
+    fn strip_continuation() {
+        // The bands between and below the holes continue the strip of the
+        // trapezoid right above them, alternating the walk direction.
+        let mut p = PathBuilder::new();
+        p.add_rect(10., 10., 30., 60.);
+        p.add_rect(15., 15., 20., 20.);
+        p.add_rect(15., 45., 20., 20.);
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(result.len(), 61);
+
+        let image = render(&result, 100, 100);
+        for y in 0..100 {
+            for x in 0..100 {
+                let in_rect = |x0, y0, x1, y1| x >= x0 && x < x1 && y >= y0 && y < y1;
+                let inside = in_rect(10, 10, 40, 70) && !in_rect(15, 15, 35, 35) && !in_rect(15, 45, 35, 65);
+                let expected = if inside { 1. } else { 0. };
+                assert!((image[y * 100 + x] - expected).abs() < 1e-3, "pixel {} {}", x, y);
+            }
+        }
+    }
+
+    #[test]
+    fn edges_only() {
+        let mut shapes = Vec::new();
+        let mut p = PathBuilder::new();
+        p.add_rect(10., 10., 30., 60.);
+        p.add_rect(15., 15., 20., 20.);
+        shapes.push(p);
+        let mut p = PathBuilder::new();
+        p.move_to(50., 5.);
+        p.curve_to(100., 5., 100., 95., 50., 95.);
+        p.curve_to(0., 95., 0., 5., 50., 5.);
+        p.close();
+        shapes.push(p);
+        let mut p = PathBuilder::new();
+        p.move_to(10.25, 10.5);
+        p.line_to(90.5, 30.75);
+        p.line_to(40.125, 85.5);
+        p.close();
+        shapes.push(p);
+
+        for p in &shapes {
+            let full = p.rasterize_to_tri_strip(0, 0, 100, 100);
+            let (mut fringe, mut interior) = (Vec::new(), Vec::new());
+            p.rasterize_edges_into(0, 0, 100, 100, &mut fringe, &mut interior);
+            assert!(!interior.is_empty());
+
+            let mut image = render(&fringe, 100, 100);
+            for t in &interior {
+                let quad = [
+                    OutputVertex { x: t.x_top_left, y: t.y_top, coverage: 1. },
+                    OutputVertex { x: t.x_bottom_left, y: t.y_bottom, coverage: 1. },
+                    OutputVertex { x: t.x_top_right, y: t.y_top, coverage: 1. },
+                    OutputVertex { x: t.x_bottom_right, y: t.y_bottom, coverage: 1. },
+                ];
+                for (pixel, coverage) in image.iter_mut().zip(render(&quad, 100, 100)) {
+                    *pixel = pixel.max(coverage);
+                }
+            }
+            for (a, b) in image.iter().zip(render(&full, 100, 100)) {
+                assert!((a - b).abs() < 1e-3);
+            }
+        }
+    }
+
+    #[test]
+    fn trapezoid_records() {
+        assert_eq!(std::mem::size_of::<OutputTrapezoid>(), 32);
+        assert_eq!(std::mem::size_of::<OutputSpan>(), 16);
+
+        let mut p = PathBuilder::new();
+        p.move_to(50., 5.);
+        p.curve_to(100., 5., 100., 95., 50., 95.);
+        p.curve_to(0., 95., 0., 5., 50., 5.);
+        p.close();
+        p.move_to(30.25, 40.5);
+        p.line_to(70.5, 45.75);
+        p.line_to(45.125, 60.5);
+        p.close();
+        let full = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        let (mut trapezoids, mut spans) = (Vec::new(), Vec::new());
+        p.rasterize_trapezoids_into(0, 0, 100, 100, &mut trapezoids, &mut spans);
+        assert!(!trapezoids.is_empty() && !spans.is_empty());
+
+        // Expand the records the same way the triangle strip does.
+        let mut strip = Vec::new();
+        let vertex = |x, y, coverage| OutputVertex { x, y, coverage };
+        for t in &trapezoids {
+            strip.push(vertex(t.x_top_left - t.left_delta, t.y_top, 0.));
+            strip.push(vertex(t.x_top_left - t.left_delta, t.y_top, 0.));
+            strip.push(vertex(t.x_bottom_left - t.left_delta, t.y_bottom, 0.));
+            strip.push(vertex(t.x_top_left + t.left_delta, t.y_top, 1.));
+            strip.push(vertex(t.x_bottom_left + t.left_delta, t.y_bottom, 1.));
+            strip.push(vertex(t.x_top_right - t.right_delta, t.y_top, 1.));
+            strip.push(vertex(t.x_bottom_right - t.right_delta, t.y_bottom, 1.));
+            strip.push(vertex(t.x_top_right + t.right_delta, t.y_top, 0.));
+            strip.push(vertex(t.x_bottom_right + t.right_delta, t.y_bottom, 0.));
+            strip.push(vertex(t.x_bottom_right + t.right_delta, t.y_bottom, 0.));
+        }
+        for s in &spans {
+            let (x0, x1, y0, y1) = (s.x_begin as f32, s.x_end as f32, s.y as f32, (s.y + 1) as f32);
+            strip.push(vertex(x0, y0, s.coverage));
+            strip.push(vertex(x0, y0, s.coverage));
+            strip.push(vertex(x0, y1, s.coverage));
+            strip.push(vertex(x1, y0, s.coverage));
+            strip.push(vertex(x1, y1, s.coverage));
+            strip.push(vertex(x1, y1, s.coverage));
+        }
+        for (a, b) in render(&strip, 100, 100).iter().zip(render(&full, 100, 100)) {
+            assert!((a - b).abs() < 1e-3);
+        }
+    }
+
+    #[test]
+    fn medium_round() {
+        use crate::real::CFloatFPU;
+        // Halves and their neighbours are where the rounding can go wrong.
+        for i in -1000..1000 {
+            for x in [i as f32 * 0.5, i as f32 * 0.25 + 1024., i as f32 * 0.5 - 8388608., i as f32 + 0.5 + 4194304.] {
+                for x in [x * (1. - f32::EPSILON), x, x * (1. + f32::EPSILON)] {
+                    assert_eq!(CFloatFPU::MediumRound(x), CFloatFPU::Round(x), "{}", x);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn aliased() {
+        // A pentagram, which overlaps itself, and a rectangle with a hole.
+        // The coordinates are exact in 28.4.
+        let star = [(50.3125, 5.1875), (76.4375, 85.0625), (8.0625, 35.6875), (92.5625, 35.6875), (24.1875, 85.0625)];
+        let outer = [(10.0625, 88.4375), (90.9375, 88.4375), (90.9375, 97.5625), (10.0625, 97.5625)];
+        let hole = [(20.5, 90.125), (20.5, 95.875), (60.25, 95.875), (60.25, 90.125)];
+        let polygons = [&star[..], &outer[..], &hole[..]];
+
+        let mut p = PathBuilder::new();
+        for polygon in polygons {
+            p.move_to(polygon[0].0, polygon[0].1);
+            for &(x, y) in &polygon[1..] {
+                p.line_to(x, y);
+            }
+            p.close();
+        }
+        p.set_antialias(false);
+
+        for (fill_mode, inside) in [(FillMode::EvenOdd, (|w: i32| w & 1 != 0) as fn(i32) -> bool), (FillMode::Winding, |w| w != 0)] {
+            p.set_fill_mode(fill_mode);
+            let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+            assert!(result.iter().all(|v| v.coverage == 0. || v.coverage == 1.));
+            let image = render(&result, 100, 100);
+            for y in 0..100 {
+                for x in 0..100 {
+                    let (px, py) = (x as f32 + 0.5, y as f32 + 0.5);
+                    let mut winding = 0;
+                    for polygon in polygons {
+                        for i in 0..polygon.len() {
+                            let (a, b) = (polygon[i], polygon[(i + 1) % polygon.len()]);
+                            if (a.1 <= py) != (b.1 <= py) && px >= a.0 + (py - a.1) * (b.0 - a.0) / (b.1 - a.1) {
+                                winding += if b.1 > a.1 { 1 } else { -1 };
+                            }
+                        }
+                    }
+                    assert_eq!(image[y * 100 + x] > 0.5, inside(winding), "{} {}", x, y);
+                }
+            }
+        }
+
+        // Scanlines that fill the same pixels are merged into one rectangle.
+        let mut p = PathBuilder::new();
+        p.add_rect(10.25, 10.75, 20., 30.);
+        p.set_antialias(false);
+        assert_eq!(p.rasterize_to_tri_strip(0, 0, 100, 100).len(), 10);
+    }
+
+    #[test]
+    fn bezier_preclip() {
+        // Circles much larger than the clip, so their curves get split and
+        // only the pieces near the clip are flattened. One boundary crosses
+        // the clip, one clips its corner, one surrounds it.
+        let k = 0.5522847;
+        let circles = [(50050.3, 50.2, 50000.), (-60000., -60000., 84900.), (40., 30000., 100000.)];
+        for (cx, cy, r) in circles {
+            let mut p = PathBuilder::new();
+            p.move_to(cx + r, cy);
+            p.curve_to(cx + r, cy + r * k, cx + r * k, cy + r, cx, cy + r);
+            p.curve_to(cx - r * k, cy + r, cx - r, cy + r * k, cx - r, cy);
+            p.curve_to(cx - r, cy - r * k, cx - r * k, cy - r, cx, cy - r);
+            p.curve_to(cx + r * k, cy - r, cx + r, cy - r * k, cx + r, cy);
+            p.close();
+            for antialias in [true, false] {
+                p.set_antialias(antialias);
+                let image = render(&p.rasterize_to_tri_strip(0, 0, 100, 100), 100, 100);
+                for y in 0..100 {
+                    for x in 0..100 {
+                        let (dx, dy) = (x as f64 + 0.5 - cx as f64, y as f64 + 0.5 - cy as f64);
+                        let d = (dx * dx + dy * dy).sqrt() - r as f64;
+                        if d.abs() > 1. {
+                            assert_eq!(image[y * 100 + x] > 0.5, d < 0., "{} {} {}", x, y, r);
+                            assert!(image[y * 100 + x] == 0. || image[y * 100 + x] > 0.99);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn clip_snapped_edges() {
+        // A star and a finely flattened spiral that reach outside the clip
+        // on every side. The edges outside it are moved onto the clip
+        // boundary, which must not change any pixel inside.
+        let mut p = PathBuilder::new();
+        for i in 0..9 {
+            let a = i as f32 * 4. * std::f32::consts::PI / 9.;
+            p.line_to(50.3 + 70. * a.cos(), 49.6 + 65. * a.sin());
+        }
+        p.close();
+        for i in 0..400 {
+            let a = i as f32 * 0.05;
+            p.line_to(45.1 + (10. + 6. * a) * a.cos(), 47.7 + (10. + 6. * a) * a.sin());
+        }
+        p.close();
+
+        for antialias in [true, false] {
+            p.set_antialias(antialias);
+            for fill_mode in [FillMode::EvenOdd, FillMode::Winding] {
+                p.set_fill_mode(fill_mode);
+                let full = render(&p.rasterize_to_tri_strip(-100, -100, 300, 300), 100, 100);
+                let clipped = render(&p.rasterize_to_tri_strip(20, 25, 50, 45), 100, 100);
+                for y in 25..70 {
+                    for x in 20..70 {
+                        assert!((full[y * 100 + x] - clipped[y * 100 + x]).abs() < 1e-5, "{} {}", x, y);
+                    }
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn edge_building_threads() {
+        // Enough small circles for every thread to get its minimum share of
+        // points, with some of them overlapping and some partly clipped.
+        let mut p = PathBuilder::new();
+        let k = 0.5522847;
+        for i in 0..1200 {
+            let (cx, cy, r) = ((i % 40) as f32 * 2.6 - 3., (i / 40) as f32 * 3.4 + (i % 3) as f32 * 0.3, 1.5 + (i % 5) as f32 * 0.4);
+            p.move_to(cx + r, cy);
+            p.curve_to(cx + r, cy + r * k, cx + r * k, cy + r, cx, cy + r);
+            p.curve_to(cx - r * k, cy + r, cx - r, cy + r * k, cx - r, cy);
+            p.curve_to(cx - r, cy - r * k, cx - r * k, cy - r, cx, cy - r);
+            p.curve_to(cx + r * k, cy - r, cx + r, cy - r * k, cx + r, cy);
+            p.close();
+        }
+
+        for antialias in [true, false] {
+            p.set_antialias(antialias);
+            p.set_edge_building_threads(1);
+            let vertices = |p: &mut PathBuilder| -> Vec<(f32, f32, f32)> {
+                p.rasterize_to_tri_strip(0, 0, 100, 100).iter().map(|v| (v.x, v.y, v.coverage)).collect()
+            };
+            let expected = vertices(&mut p);
+            assert!(expected.len() > 0);
+            for threads in [2, 3, 8] {
+                p.set_edge_building_threads(threads);
+                assert!(vertices(&mut p) == expected, "{}", threads);
+            }
+        }
+    }
+
+    #[test]
+    fn active_edge_sort() {
+        use crate::aarasterizer::{CEdge, SortActiveEdges, MergeSortActiveEdges};
+        use crate::nullable_ref::Ref;
+
+        let mut seed = 3u64;
+        let mut rnd = |n: i32| { seed = seed.wrapping_mul(6364136223846793005).wrapping_add(1442695040888963407); ((seed >> 33) % n as u64) as i32 };
+        for n in [2, 7, 40, 200] {
+            // From nearly sorted to shuffled, with plenty of ties
+            for spread in [0, 1, 5, 1000] {
+                let xs: Vec<i32> = (0..n).map(|i| i / 3 + rnd(spread + 1)).collect();
+                let mut expected: Vec<usize> = (0..xs.len()).collect();
+                expected.sort_by_key(|&i| xs[i]);
+
+                for sort in [SortActiveEdges as fn(Ref<CEdge>), MergeSortActiveEdges] {
+                    // The head and tail sentinels go around the edges
+                    let edges: Vec<CEdge> = (0..n + 2).map(|_| CEdge::default()).collect();
+                    edges[0].X.set(i32::MIN);
+                    edges[n as usize + 1].X.set(i32::MAX);
+                    for (i, &x) in xs.iter().enumerate() {
+                        edges[i + 1].X.set(x);
+                    }
+                    for i in 1..edges.len() {
+                        edges[i - 1].Next.set(Ref::new(&edges[i]));
+                    }
+
+                    sort(Ref::new(&edges[0]));
+
+                    let mut sorted = Vec::new();
+                    let mut edge = edges[0].Next.get();
+                    while edge.X.get() != i32::MAX {
+                        sorted.push(edges.iter().position(|e| Ref::new(e) == edge).unwrap() - 1);
+                        edge = edge.Next.get();
+                    }
+                    assert_eq!(sorted, expected);
+                }
+            }
+        }
+    }
+
+    #[test]
+    fn round_slice() {
+        use crate::real::CFloatFPU;
+        let input: Vec<f32> = (-1000..1000).map(|i| i as f32 * 0.25 + (i % 7) as f32 * 1024.).collect();
+        // odd lengths leave a tail after the vectorized part of the loop
+        for len in [0, 1, 7, 33, input.len()] {
+            let mut output = vec![0; len];
+            CFloatFPU::RoundSlice(&input[..len], &mut output);
+            for (&x, &n) in input.iter().zip(&output) {
+                assert_eq!(n, CFloatFPU::Round(x), "{}", x);
+            }
+        }
+    }
+
     #[test]
     fn range() {
         // test for a start point out of range
@@ -429,16 +1149,87 @@ mod tests {
     fn clip_edge() {
         let mut p = PathBuilder::new();
         // tests the bigNumerator < 0 case of aarasterizer::ClipEdge
-        p.curve_to(-24., -10., -300., 119., 0.0, 0.0);
+        p.move_to(10., 10.);
+        p.line_to(24., -10.);
+        p.line_to(-300., 119.);
+        p.close();
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(result.len(), 20);
+
+        // A curve that crosses the top of the clip going down and to the
+        // left, so it also reaches the bigNumerator < 0 case.
+        let mut p = PathBuilder::new();
+        p.move_to(33., -72.);
+        p.curve_to(-129., 55., -96., 104., -14., 65.);
+        p.close();
         let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
         // The edge merging only happens between points inside the enumerate buffer. This means
         // that the vertex output can depend on the size of the enumerate buffer because there
         // the number of edges and positions of vertices will change depending on edge merging.
         if ENUMERATE_BUFFER_NUMBER!() == 32 {
-            assert_eq!(result.len(), 170);
+            assert_eq!(result.len(), 92);
         } else {
-            assert_eq!(result.len(), 238);
+            assert_eq!(result.len(), 114);
         }
+
+        // This curve only touches the clip at its end point, so all of its
+        // edges end up on the left clip boundary and there's nothing to output.
+        let mut p = PathBuilder::new();
+        p.curve_to(-24., -10., -300., 119., 0.0, 0.0);
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(result.len(), 0);
+    }
+
+    #[test]
+    fn clip_edge_negative_numerator() {
+        use crate::aarasterizer::{CEdge, ClipEdge};
+        use std::cell::Cell;
+
+        // An edge with a slope of -37/10 that starts above the clip.  Its
+        // DDA steps are Dx = -4 and ErrorUp = 3, and the jump to the clip
+        // top must land where stepping the DDA one row at a time does.
+        let (dM, dN) = (-37, 10);
+        for yClipTop in 1..40 {
+            let mut edge = CEdge {
+                X: Cell::new(100),
+                Dx: -4,
+                Error: Cell::new(-1),
+                ErrorUp: 3,
+                ErrorDown: dN,
+                StartY: 0,
+                EndY: 50,
+                WindingDirection: 1,
+                ..Default::default()
+            };
+            let (mut x, mut error) = (edge.X.get(), edge.Error.get());
+            for _ in 0..yClipTop {
+                x += edge.Dx;
+                error += edge.ErrorUp;
+                if error >= 0 {
+                    error -= dN;
+                    x += 1;
+                }
+            }
+            ClipEdge(&mut edge, yClipTop, dM);
+            assert_eq!((edge.StartY, edge.X.get(), edge.Error.get()), (yClipTop, x, error));
+        }
+
+        // 6 rows down: bigNumerator = -37 * 6 + (-1 + 10) = -213, so X moves
+        // by -22 and the remainder of 7 leaves an error of 7 - 10.
+        let mut edge = CEdge {
+            X: Cell::new(100),
+            Dx: -4,
+            Error: Cell::new(-1),
+            ErrorUp: 3,
+            ErrorDown: dN,
+            StartY: 0,
+            EndY: 50,
+            WindingDirection: 1,
+            ..Default::default()
+        };
+        ClipEdge(&mut edge, 6, dM);
+        assert_eq!(edge.X.get(), 78);
+        assert_eq!(edge.Error.get(), -3);
     }
 
     #[test]
@@ -470,4 +1261,564 @@ mod tests {
         let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
         assert_eq!(result.len(), 820);
     }
+
+    #[test]
+    fn edge_table() {
+        let mut p = PathBuilder::new();
+        p.move_to(10., -10.);
+        p.curve_to(40., 10., 40., 10., 40., 40.);
+        p.line_to(120., 70.);
+        p.line_to(-5., 60.);
+        p.close();
+        for i in 0..20 {
+            let offset = i as f32 * 1.3;
+            p.move_to(0. + offset, 50.);
+            p.line_to(0.5 + offset, 50.);
+            p.line_to(0.5 + offset, 90.);
+            p.close();
+        }
+        for fill_mode in [FillMode::EvenOdd, FillMode::Winding] {
+            p.set_fill_mode(fill_mode);
+            let table = p.build_edge_table(0, 0, 100, 80);
+            let result = rasterize_edge_table(&table).unwrap();
+            assert_eq!(calculate_hash(&result), calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 80)));
+        }
+
+        let empty = PathBuilder::new().build_edge_table(0, 0, 100, 100);
+        assert_eq!(rasterize_edge_table(&empty).unwrap().len(), 0);
+
+        let mut table = p.build_edge_table(0, 0, 100, 100);
+        assert!(rasterize_edge_table(&table[..table.len() - 1]).is_none());
+        // Swap the first two edges so the table is no longer sorted
+        let (first, second) = table[32..96].split_at_mut(32);
+        first.swap_with_slice(second);
+        assert!(rasterize_edge_table(&table).is_none());
+
+        // Edges that run out of the 28.4 range must be rejected rather than
+        // overflow the DDA
+        let table = p.build_edge_table(0, 0, 100, 100);
+        let mut steep = table.clone();
+        steep[32 + 16..32 + 20].copy_from_slice(&(1i32 << 24).to_le_bytes());
+        assert!(rasterize_edge_table(&steep).is_none());
+        let mut steep = table.clone();
+        steep[32 + 16..32 + 20].copy_from_slice(&i32::MIN.to_le_bytes());
+        assert!(rasterize_edge_table(&steep).is_none());
+        let mut far = table.clone();
+        let last = table.len() - 32;
+        far[last + 8..last + 12].copy_from_slice(&(1i32 << 27).to_le_bytes());
+        assert!(rasterize_edge_table(&far).is_none());
+    }
+
+    #[test]
+    fn path_slices() {
+        let mut p = PathBuilder::new();
+        p.move_to(10., 10.);
+        p.curve_to(40., 10., 40., 10., 40., 40.);
+        p.line_to(10., 40.);
+        p.close();
+        p.move_to(20., 20.);
+        p.line_to(30., 20.);
+        p.line_to(30., 30.);
+        p.set_fill_mode(FillMode::Winding);
+        let result = rasterize_path(&p.points, &p.types, FillMode::Winding, 0, 0, 100, 100).unwrap();
+        assert_eq!(calculate_hash(&result), calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)));
+
+        assert_eq!(rasterize_path(&[], &[], FillMode::EvenOdd, 0, 0, 100, 100).unwrap().len(), 0);
+        assert!(rasterize_path(&p.points, &p.types[1..], FillMode::EvenOdd, 0, 0, 100, 100).is_none());
+        assert!(rasterize_path(&p.points[..3], &p.types[..3], FillMode::EvenOdd, 0, 0, 100, 100).is_none());
+        assert!(rasterize_path(&p.points[1..], &p.types[1..], FillMode::EvenOdd, 0, 0, 100, 100).is_none());
+    }
+
+    #[test]
+    fn append() {
+        let mut p = PathBuilder::new();
+        p.move_to(10., 10.);
+        p.curve_to(40., 10., 40., 10., 40., 40.);
+        p.line_to(10., 40.);
+        p.close();
+        p.move_to(20., 20.);
+        p.line_to(30., 20.);
+        p.line_to(30., 30.);
+        p.line_to(25., 35.);
+
+        let mut q = PathBuilder::new();
+        assert!(!q.append_path(&p.points[1..], &p.types[1..]));
+        assert!(q.append_path(&p.points[..8], &p.types[..8]));
+        q.line_to(25., 35.);
+        assert_eq!(calculate_hash(&q.rasterize_to_tri_strip(0, 0, 100, 100)), calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)));
+
+        let mut q = PathBuilder::new();
+        q.reserve(p.points.len());
+        q.append_path(&p.points[..5], &p.types[..5]);
+        q.move_to(20., 20.);
+        q.append_polyline(&[MilPoint2F { X: 30., Y: 20. }, MilPoint2F { X: 30., Y: 30. }, MilPoint2F { X: 25., Y: 35. }]);
+        assert_eq!(calculate_hash(&q.rasterize_to_tri_strip(0, 0, 100, 100)), calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)));
+    }
+
+    #[test]
+    fn reuse() {
+        let mut p = PathBuilder::new();
+        p.move_to(10., 10.);
+        p.line_to(10., 30.);
+        p.line_to(30., 30.);
+        p.line_to(30., 10.);
+        p.close();
+        // Enough room for both results, so neither call has to reallocate
+        let mut output = Vec::with_capacity(4096);
+        let buffer = output.as_ptr();
+        p.rasterize_into(0, 0, 100, 100, &mut output);
+        assert_eq!(calculate_hash(&output), calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)));
+        assert_eq!(output.as_ptr(), buffer);
+
+        p.reset();
+        p.move_to(10., 10.);
+        p.line_to(40., 10.);
+        p.line_to(40., 40.);
+        p.rasterize_into(0, 0, 100, 100, &mut output);
+        assert_eq!(dbg!(calculate_hash(&output)), 0x81a9af7769f88e68);
+        assert!(output.len() <= 4096);
+        assert_eq!(output.as_ptr(), buffer);
+    }
+
+    #[test]
+    fn scratch_reuse() {
+        let mut p = PathBuilder::new();
+        for i in 0..200 {
+            let offset = i as f32 * 1.3;
+            p.move_to(0. + offset, -8.);
+            p.line_to(0.5 + offset, -8.);
+            p.line_to(0.5 + offset, 40.);
+            p.line_to(0. + offset, 40.);
+            p.close();
+        }
+        let first = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert!(p.scratch.borrow().m_pVB.is_some());
+        // Release builds hold these ~150 edges in the built-in inactive
+        // array, so only debug builds go through the dispenser's; the
+        // dense case below covers release
+        if cfg!(debug_assertions) {
+            assert!(p.scratch.borrow().m_rgInactiveArray.capacity() >= 150);
+        }
+        let second = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(first.len(), 24000);
+        assert_eq!(calculate_hash(&first), calculate_hash(&second));
+    }
+
+    #[test]
+    fn scratch_reuse_dense() {
+        // More edges than the built-in stores hold in release builds, and
+        // complex scans wide enough to grow the coverage intervals
+        let mut p = PathBuilder::new();
+        for i in 0..200 {
+            let offset = i as f32 * 0.45;
+            p.move_to(0. + offset, -8.);
+            p.line_to(0.2 + offset, -8.);
+            p.line_to(0.2 + offset, 40.);
+            p.line_to(0. + offset, 40.);
+            p.close();
+        }
+        let first = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert!(p.scratch.borrow().m_pVB.is_some());
+        assert!(p.scratch.borrow().m_rgInactiveArray.capacity() >= 400);
+        // the slivers cover ~90 pixels of each complex scan
+        assert!(p.scratch.borrow().m_rgCoverageInterval.capacity() >= 90);
+        assert!(!p.scratch.borrow().m_rgEdgeBlock.is_empty());
+        let second = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&first), calculate_hash(&second));
+    }
+
+    #[test]
+    fn transient_allocator() {
+        use std::ffi::c_void;
+        #[derive(Default)]
+        struct Counts { allocs: usize, frees: usize, live: isize }
+        unsafe extern "C" fn alloc(user_data: *mut c_void, size: usize, align: usize) -> *mut c_void {
+            let counts = &mut *(user_data as *mut Counts);
+            counts.allocs += 1;
+            counts.live += size as isize;
+            std::alloc::alloc(std::alloc::Layout::from_size_align(size, align).unwrap()) as *mut c_void
+        }
+        unsafe extern "C" fn free(user_data: *mut c_void, ptr: *mut c_void, size: usize, align: usize) {
+            let counts = &mut *(user_data as *mut Counts);
+            counts.frees += 1;
+            counts.live -= size as isize;
+            std::alloc::dealloc(ptr as *mut u8, std::alloc::Layout::from_size_align(size, align).unwrap())
+        }
+
+        // Enough edges for the heap inactive array and the edge store blocks
+        let mut p = PathBuilder::new();
+        for i in 0..300 {
+            let offset = i as f32 * 0.3;
+            p.move_to(0. + offset, 5.);
+            p.line_to(0.2 + offset, 5.);
+            p.line_to(0.2 + offset, 40. + offset);
+            p.close();
+        }
+        let expected = p.rasterize_to_tri_strip(0, 0, 100, 100);
+
+        let mut counts = Counts::default();
+        unsafe { p.set_allocator(alloc, free, &mut counts as *mut Counts as *mut c_void) };
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&result), calculate_hash(&expected));
+        // Everything went through the hook and is kept for the next call
+        assert!(counts.allocs >= 4);
+        assert!(counts.live > 0);
+
+        // Once the buffers fit the path nothing more is allocated, and
+        // setting the same allocator again keeps them
+        let (allocs, frees) = (counts.allocs, counts.frees);
+        unsafe { p.set_allocator(alloc, free, &mut counts as *mut Counts as *mut c_void) };
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&result), calculate_hash(&expected));
+        assert_eq!((counts.allocs, counts.frees), (allocs, frees));
+
+        // The same without anti-aliasing, which keeps its pixel spans in
+        // the dispenser as well
+        p.set_antialias(false);
+        let allocs = counts.allocs;
+        let aliased = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert!(counts.allocs > allocs);
+        assert!(p.scratch.borrow().m_rgAliasedSpanRun.capacity() > 0);
+        let (allocs, frees) = (counts.allocs, counts.frees);
+        assert_eq!(calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)), calculate_hash(&aliased));
+        assert_eq!((counts.allocs, counts.frees), (allocs, frees));
+        p.set_antialias(true);
+
+        p.release_buffers();
+        assert_eq!(counts.allocs, counts.frees);
+        assert_eq!(counts.live, 0);
+
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&result), calculate_hash(&expected));
+        assert!(counts.allocs > allocs);
+        drop(p);
+        assert_eq!(counts.allocs, counts.frees);
+        assert_eq!(counts.live, 0);
+    }
+
+    #[test]
+    fn transient_allocator_threads() {
+        use std::ffi::c_void;
+        use std::sync::atomic::{AtomicUsize, AtomicIsize, Ordering};
+        #[derive(Default)]
+        struct Counts { allocs: AtomicUsize, frees: AtomicUsize, live: AtomicIsize }
+        unsafe extern "C" fn alloc(user_data: *mut c_void, size: usize, align: usize) -> *mut c_void {
+            let counts = &*(user_data as *const Counts);
+            counts.allocs.fetch_add(1, Ordering::Relaxed);
+            counts.live.fetch_add(size as isize, Ordering::Relaxed);
+            std::alloc::alloc(std::alloc::Layout::from_size_align(size, align).unwrap()) as *mut c_void
+        }
+        unsafe extern "C" fn free(user_data: *mut c_void, ptr: *mut c_void, size: usize, align: usize) {
+            let counts = &*(user_data as *const Counts);
+            counts.frees.fetch_add(1, Ordering::Relaxed);
+            counts.live.fetch_sub(size as isize, Ordering::Relaxed);
+            std::alloc::dealloc(ptr as *mut u8, std::alloc::Layout::from_size_align(size, align).unwrap())
+        }
+
+        // Enough points for every thread, with enough edges per thread
+        // to fill several edge store blocks
+        let mut p = PathBuilder::new();
+        for i in 0..3000 {
+            let (x, y) = ((i % 50) as f32 * 2., (i / 50) as f32 * 1.6);
+            p.move_to(x, y);
+            p.line_to(x + 1.5, y + 0.2);
+            p.line_to(x + 0.7, y + 1.4);
+            p.close();
+        }
+        let expected = p.rasterize_to_tri_strip(0, 0, 100, 100);
+
+        let counts = Counts::default();
+        unsafe { p.set_allocator(alloc, free, &counts as *const Counts as *mut c_void) };
+        p.set_edge_building_threads(3);
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&result), calculate_hash(&expected));
+        // The threads' edges stay in the blocks they were built in, which
+        // are kept for the next path
+        assert_eq!(p.scratch.borrow().m_rgThreadEdgeBlocks.len(), 3);
+        assert!(p.scratch.borrow().m_rgThreadEdgeBlocks.iter().all(|rgBlock| rgBlock.len() >= 2));
+        let store_allocs = counts.allocs.load(Ordering::Relaxed);
+        assert!(store_allocs >= 6);
+
+        // The next path reuses every thread's blocks
+        let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&result), calculate_hash(&expected));
+        assert_eq!(counts.allocs.load(Ordering::Relaxed), store_allocs);
+
+        drop(p);
+        assert_eq!(counts.allocs.load(Ordering::Relaxed), counts.frees.load(Ordering::Relaxed));
+        assert_eq!(counts.live.load(Ordering::Relaxed), 0);
+    }
+
+    #[test]
+    fn thread_scratch_reuse() {
+        // The free functions keep their scratch buffers per thread, so the
+        // second call reuses the first one's allocations
+        let mut p = PathBuilder::new();
+        for i in 0..200 {
+            let offset = i as f32 * 0.45;
+            p.move_to(0. + offset, -8.);
+            p.line_to(0.2 + offset, -8.);
+            p.line_to(0.2 + offset, 40.);
+            p.line_to(0. + offset, 40.);
+            p.close();
+        }
+        let scratch = || g_scratch.with(|s| {
+            let s = s.borrow();
+            (s.m_rgCoverageInterval.as_ptr(), s.m_rgCoverageInterval.capacity(), s.m_rgInactiveArray.as_ptr(), s.m_pVB.is_some())
+        });
+        let first = rasterize_path(&p.points, &p.types, FillMode::EvenOdd, 0, 0, 100, 100).unwrap();
+        let buffers = scratch();
+        assert!(buffers.1 >= 90);
+        assert!(buffers.3);
+        let second = rasterize_path(&p.points, &p.types, FillMode::EvenOdd, 0, 0, 100, 100).unwrap();
+        assert_eq!(scratch(), buffers);
+        assert_eq!(calculate_hash(&first), calculate_hash(&second));
+        assert_eq!(calculate_hash(&first), calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)));
+    }
+
+    #[test]
+    fn coverage_intervals() {
+        use crate::aacoverage::{CCoverageBuffer, c_iIntervalHead, c_iIntervalTail};
+        let coverage = CCoverageBuffer::default();
+        coverage.Initialize(Default::default());
+        let spans = |coverage: &CCoverageBuffer| {
+            let rg = coverage.m_rgInterval.borrow();
+            let mut i = rg[c_iIntervalHead as usize].m_iNext;
+            let mut spans = Vec::new();
+            while i != c_iIntervalTail {
+                spans.push((rg[i as usize].m_nPixelX, rg[i as usize].m_nCoverage));
+                i = rg[i as usize].m_iNext;
+            }
+            spans
+        };
+        // the example from the CCoverageBuffer comment
+        coverage.AddInterval(4, 28);
+        assert_eq!(spans(&coverage), [(0, 4), (1, 8), (3, 4), (4, 0)]);
+        // same-pixel updates, then an interval left of the last one
+        coverage.AddInterval(9, 11);
+        coverage.AddInterval(13, 14);
+        coverage.AddInterval(2, 3);
+        assert_eq!(spans(&coverage), [(0, 5), (1, 11), (2, 8), (3, 4), (4, 0)]);
+        coverage.Reset();
+        assert_eq!(spans(&coverage), []);
+    }
+
+    #[test]
+    fn vertical_gap() {
+        // a path with subpaths far apart rasterizes like the subpaths do separately
+        let triangle = |p: &mut PathBuilder, y: f32| {
+            p.move_to(10.3, y);
+            p.line_to(30.6, y + 1.4);
+            p.line_to(12.1, y + 6.2);
+            p.close();
+        };
+        let mut p = PathBuilder::new();
+        triangle(&mut p, 2.25);
+        let mut first = p.rasterize_to_tri_strip(0, 0, 100, 100).into_vec();
+        p.reset();
+        triangle(&mut p, 80.75);
+        first.extend(p.rasterize_to_tri_strip(0, 0, 100, 100).into_vec());
+        p.reset();
+        triangle(&mut p, 2.25);
+        triangle(&mut p, 80.75);
+        let both = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert_eq!(calculate_hash(&both), calculate_hash(&first.into_boxed_slice()));
+    }
+
+    #[test]
+    fn no_coverage_rows_skipped() {
+        // Shapes beside the clip, whose edges get moved onto its sides, and
+        // a shape traced back over itself only give empty rows. The sweep
+        // jumps over those instead of filling them one by one.
+        let rows = |p: &PathBuilder| {
+            let before = crate::hwrasterizer::g_cScanRows.with(|c| c.get());
+            let result = p.rasterize_to_tri_strip(0, 0, 100, 100);
+            (result, crate::hwrasterizer::g_cScanRows.with(|c| c.get()) - before)
+        };
+        let polygon = |p: &mut PathBuilder, points: &[(f32, f32)]| {
+            p.move_to(points[0].0, points[0].1);
+            for &(x, y) in &points[1..] {
+                p.line_to(x, y);
+            }
+            p.close();
+        };
+        let quad = [(20.3, 5.1), (60.7, 9.4), (70.2, 75.3), (25.6, 70.8)];
+        for fill_mode in [FillMode::EvenOdd, FillMode::Winding] {
+            // Two triangles, so that the general sweep is used
+            let mut p = PathBuilder::new();
+            p.set_fill_mode(fill_mode);
+            polygon(&mut p, &[(10.3, 85.25), (30.6, 86.65), (12.1, 91.45)]);
+            polygon(&mut p, &[(50.2, 88.5), (70.7, 87.1), (62.4, 95.3)]);
+            let (alone, alone_rows) = rows(&p);
+
+            polygon(&mut p, &[(-40.5, 1.3), (-10.2, 3.7), (-20.4, 80.1), (-35.7, 60.2)]);
+            polygon(&mut p, &[(140.5, 2.6), (110.2, 7.3), (120.4, 70.1)]);
+            let (beside, beside_rows) = rows(&p);
+            assert_eq!(calculate_hash(&beside), calculate_hash(&alone));
+            assert_eq!(beside_rows, alone_rows);
+
+            // Only the top row of the quad is filled, where its edges
+            // aren't sorted into matching pairs yet
+            polygon(&mut p, &quad);
+            let reversed: Vec<_> = quad[..1].iter().chain(quad[1..].iter().rev()).copied().collect();
+            polygon(&mut p, &reversed);
+            let (all, all_rows) = rows(&p);
+            assert_eq!(calculate_hash(&all), calculate_hash(&alone));
+            assert_eq!(all_rows, alone_rows + 1);
+        }
+    }
+
+    #[test]
+    fn rect() {
+        // the fast path matches the general path, which an edge table
+        // built from the same path always takes
+        let rects = [
+            (10., 10., 20., 20.),
+            (10.3, 2.6, 41.2, 7.7),
+            (-5.5, 95.2, 30., 30.),
+            // too small and too narrow for trapezoids
+            (3.2, 4.4, 0.3, 0.9),
+            (60.7, 3.1, 1.2, 80.6),
+            // clipped on every side
+            (-10.2, -20.7, 130.1, 140.3),
+            // left of the clipping, so it isn't walked
+            (-30., 10.5, 20., 20.),
+        ];
+        for &(x, y, w, h) in &rects {
+            for fill_mode in [FillMode::EvenOdd, FillMode::Winding] {
+                let mut p = PathBuilder::new();
+                p.set_fill_mode(fill_mode);
+                p.add_rect(x, y, w, h);
+                let walks = crate::hwrasterizer::g_cRectangleWalks.with(|c| c.get());
+                let fast = p.rasterize_to_tri_strip(0, 0, 100, 100);
+                // rectangles with a side in the clipping are built and walked directly
+                assert_eq!(crate::hwrasterizer::g_cRectangleWalks.with(|c| c.get()), walks + (x + w > 0.) as usize);
+                let general = rasterize_edge_table(&p.build_edge_table(0, 0, 100, 100)).unwrap();
+                assert_eq!(calculate_hash(&fast), calculate_hash(&general));
+            }
+        }
+    }
+
+    #[test]
+    fn convex() {
+        let mut polygons: Vec<Vec<(f32, f32)>> = vec![
+            vec![(10., 10.), (40.5, 20.25), (15.3, 60.8)],
+            vec![(50., 5.), (95.2, 90.), (3.1, 70.7)],
+            vec![(20., 10.), (80., 30.), (70., 80.), (10., 50.)],
+            // not convex, so it takes the general path
+            vec![(10., 40.), (60., 40.), (60., 20.), (90., 50.), (60., 80.), (60., 60.), (10., 60.)],
+        ];
+        polygons.push((0..12).map(|i| {
+            let a = i as f32 * std::f32::consts::PI / 6.;
+            (50. + 40. * a.cos(), 50. + 40. * a.sin())
+        }).collect());
+
+        // clipped at the top and on both sides
+        polygons.push(vec![(-20., -10.3), (120., 15.7), (60.2, 99.9)]);
+        // narrow, so it is mostly complex scans
+        polygons.push(vec![(40.1, 3.3), (41.4, 3.3), (45.8, 90.6), (44.3, 90.9)]);
+
+        for polygon in &polygons {
+            let convex = polygon.len() != 7;
+            for fill_mode in [FillMode::EvenOdd, FillMode::Winding] {
+                let mut p = PathBuilder::new();
+                p.set_fill_mode(fill_mode);
+                p.move_to(polygon[0].0, polygon[0].1);
+                for &(x, y) in &polygon[1..] {
+                    p.line_to(x, y);
+                }
+                p.close();
+                let walks = crate::hwrasterizer::g_cConvexChainWalks.with(|c| c.get());
+                let fast = p.rasterize_to_tri_strip(0, 0, 100, 100);
+                // convex polygons are walked down their two chains
+                assert_eq!(crate::hwrasterizer::g_cConvexChainWalks.with(|c| c.get()), walks + convex as usize);
+                let general = rasterize_edge_table(&p.build_edge_table(0, 0, 100, 100)).unwrap();
+                assert_eq!(calculate_hash(&fast), calculate_hash(&general));
+            }
+        }
+    }
+
+    #[test]
+    fn rects() {
+        let rects = [
+            MilPointAndSizeF { X: 10.5, Y: 10.25, Width: 20., Height: 20. },
+            MilPointAndSizeF { X: 50., Y: 5., Width: 10.75, Height: 30.5 },
+        ];
+        let mut separate = Vec::new();
+        for r in &rects {
+            let mut p = PathBuilder::new();
+            p.add_rect(r.X, r.Y, r.Width, r.Height);
+            separate.extend(p.rasterize_to_tri_strip(0, 0, 100, 100).into_vec());
+        }
+        let batched = rasterize_rects(&rects, 0, 0, 100, 100);
+        assert_eq!(calculate_hash(&batched), calculate_hash(&separate.into_boxed_slice()));
+    }
+
+    #[test]
+    fn simplify() {
+        // a square with a vertex every 0.25 pixels plus some jitter
+        let mut p = PathBuilder::new();
+        let mut points = Vec::new();
+        for i in 0..240 {
+            let t = i as f32 * 0.25;
+            let jitter = if i % 2 == 0 { 0.02 } else { -0.02 };
+            points.push(match i / 60 {
+                0 => (20. + t, 20. + jitter),
+                1 => (35. + jitter, 20. + t),
+                2 => (50. - t, 35. + jitter),
+                _ => (20. + jitter, 50. - t),
+            });
+        }
+        p.move_to(points[0].0, points[0].1);
+        for &(x, y) in &points[1..] {
+            p.line_to(x, y);
+        }
+        p.close();
+
+        let dense = p.build_edge_table(0, 0, 100, 100);
+        let dense_output = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        p.set_simplify_tolerance(0.1);
+        let simplified = p.build_edge_table(0, 0, 100, 100);
+        assert!(simplified.len() * 4 < dense.len());
+        let simplified_output = p.rasterize_to_tri_strip(0, 0, 100, 100);
+        assert!(simplified_output.len() < dense_output.len());
+        assert_eq!(calculate_hash(&simplified_output), calculate_hash(&rasterize_edge_table(&simplified).unwrap()));
+
+        p.set_simplify_tolerance(0.);
+        assert_eq!(calculate_hash(&p.rasterize_to_tri_strip(0, 0, 100, 100)), calculate_hash(&dense_output));
+    }
+
+    #[test]
+    fn trapezoid_chaining() {
+        let mut circle = PathBuilder::new();
+        circle.move_to(90., 50.);
+        circle.curve_to(90., 72., 72., 90., 50., 90.);
+        circle.curve_to(28., 90., 10., 72., 10., 50.);
+        circle.curve_to(10., 28., 28., 10., 50., 10.);
+        circle.curve_to(72., 10., 90., 28., 90., 50.);
+        circle.close();
+
+        // few enough edges for the linked active list, with a joint on each side
+        let mut kite = PathBuilder::new();
+        kite.move_to(50., 5.);
+        kite.line_to(71., 40.3);
+        kite.line_to(90., 95.);
+        kite.line_to(30., 60.7);
+        kite.close();
+
+        for p in [&mut circle, &mut kite] {
+            let plain = p.rasterize_to_tri_strip(0, 0, 100, 100);
+            p.set_trapezoid_chain_tolerance(0.25);
+            let chained = p.rasterize_to_tri_strip(0, 0, 100, 100);
+            p.set_trapezoid_chain_tolerance(0.);
+            assert!(chained.len() < plain.len());
+
+            // the chords move the outline by at most the tolerance
+            let (plain, chained) = (render(&plain, 100, 100), render(&chained, 100, 100));
+            let max_difference = plain.iter().zip(&chained).map(|(a, b)| (a - b).abs()).fold(0., f32::max);
+            let area: f32 = plain.iter().sum();
+            assert!(max_difference < 0.3);
+            assert!((area - chained.iter().sum::<f32>()).abs() < area * 0.003);
+        }
+    }
 }
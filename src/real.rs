@@ -1,4 +1,5 @@
 pub mod CFloatFPU {
+    #[cfg(all(target_arch = "x86_64", target_feature = "sse2"))]
     use std::arch::x86_64::{__m128, _mm_set_ss, _mm_cvtss_si32, _mm_cvtsi32_ss, _mm_sub_ss, _mm_cmple_ss, _mm_store_ss, _mm_setzero_ps};
 
     // Maximum allowed argument for SmallRound
@@ -8,8 +9,10 @@ pub mod CFloatFPU {
     const sc_uBinaryFloatSmallMax: u32 = 0x497ffff0;
 
     fn LargeRound(x: f32) -> i32 {
-        //XXX: the SSE2 version is probably slower than a naive SSE4 implementation that can use roundss
-        #[cfg(target_feature = "sse2")]
+        // Round only takes this path for |x| > 0xFFFFF so checking for
+        // SSE4.1 here wouldn't pay off.  Bulk rounding goes through
+        // RoundSlice, which does pick a kernel at runtime.
+        #[cfg(all(target_arch = "x86_64", target_feature = "sse2"))]
         unsafe {
             let given: __m128 = _mm_set_ss(x);                       // load given value
             let result = _mm_cvtss_si32(given);
@@ -22,8 +25,10 @@ pub mod CFloatFPU {
             _mm_store_ss((&mut correction) as *mut _ as *mut _, mask); // get comparison result as integer
             return result - correction;                         // correct the result of rounding
         }
-        #[cfg(not(target_feature = "sse2"))]
-        return (x.floor() + 0.5) as i32;
+        // x + .5 is exact in double precision, so this rounds half-integers
+        // up like the SSE2 version.
+        #[cfg(not(all(target_arch = "x86_64", target_feature = "sse2")))]
+        return ((x as f64) + 0.5).floor() as i32;
     }
 
 
@@ -148,6 +153,80 @@ fn SmallRound(x: f32) -> i32
     return result;
 }
 
+//+------------------------------------------------------------------------
+//
+//  Function:   CFloatFPU::MediumRound
+//
+//  Synopsis:   Same as Round, for -0x40000000 < x < 0x40000000.
+//
+//  Details:    This is SmallRound1(x*2+.5) >> 1 (see SmallRound) done in
+//              double precision, where x*2+.5 is exact and adding
+//              1.5*2^52 leaves the rounded integer in the low 32 bits of
+//              the mantissa.  It has no branches and no conversion
+//              instructions, so loops over it can be vectorized.
+//
+//-------------------------------------------------------------------------
+#[inline(always)]
+pub fn MediumRound(x: f32) -> i32
+{
+    let fi = ((x as f64) * 2. + 0.5) + 6755399441055744.0;
+    return (fi.to_bits() as i32) >> 1;
+}
+
+//+------------------------------------------------------------------------
+//
+//  Function:   CFloatFPU::RoundSlice
+//
+//  Synopsis:   MediumRound each of rgrIn into rgnOut.
+//
+//              On x86_64 the loop is compiled for AVX2 and SSE4.1 as well
+//              and the widest one the CPU supports is picked at runtime.
+//              Other targets get the portable loop, which the compiler
+//              vectorizes for whatever the target baseline is.
+//
+//-------------------------------------------------------------------------
+pub fn RoundSlice(rgrIn: &[f32], rgnOut: &mut [i32])
+{
+    assert!(rgnOut.len() >= rgrIn.len());
+
+    #[cfg(target_arch = "x86_64")]
+    {
+        if is_x86_feature_detected!("avx2")
+        {
+            return unsafe { RoundSliceAvx2(rgrIn, rgnOut) };
+        }
+        if is_x86_feature_detected!("sse4.1")
+        {
+            return unsafe { RoundSliceSse41(rgrIn, rgnOut) };
+        }
+    }
+
+    RoundSlicePortable(rgrIn, rgnOut);
+}
+
+#[inline(always)]
+fn RoundSlicePortable(rgrIn: &[f32], rgnOut: &mut [i32])
+{
+    for (n, &r) in rgnOut.iter_mut().zip(rgrIn)
+    {
+        *n = MediumRound(r);
+    }
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "avx2")]
+unsafe fn RoundSliceAvx2(rgrIn: &[f32], rgnOut: &mut [i32])
+{
+    RoundSlicePortable(rgrIn, rgnOut);
+}
+
+#[cfg(target_arch = "x86_64")]
+#[target_feature(enable = "sse4.1")]
+unsafe fn RoundSliceSse41(rgrIn: &[f32], rgnOut: &mut [i32])
+{
+    RoundSlicePortable(rgrIn, rgnOut);
+}
+
 pub fn Round(x: f32) -> i32
 {
     // cut off sign
@@ -12,6 +12,7 @@ pub(crate) type REAL = FLOAT;
 pub(crate) type HRESULT = LONG;
 
 pub(crate) const S_OK: HRESULT = 0;
+pub(crate) const E_INVALIDARG: HRESULT = 0x80070057;
 pub(crate) const INTSAFE_E_ARITHMETIC_OVERFLOW: HRESULT = 0x80070216;
 pub(crate) const WGXERR_VALUEOVERFLOW: HRESULT = INTSAFE_E_ARITHMETIC_OVERFLOW;
 pub(crate) const WINCODEC_ERR_VALUEOVERFLOW: HRESULT = INTSAFE_E_ARITHMETIC_OVERFLOW;
@@ -72,6 +73,7 @@ pub struct POINT {
     pub x: LONG,
     pub y: LONG
 }
+#[repr(C)]
 #[derive(Clone, Copy)]
 pub struct MilPoint2F
 {
@@ -79,6 +81,16 @@ pub struct MilPoint2F
     pub Y: FLOAT,
 }
 
+#[repr(C)]
+#[derive(Default, Clone, Copy)]
+pub struct MilPointAndSizeF
+{
+    pub X: FLOAT,
+    pub Y: FLOAT,
+    pub Width: FLOAT,
+    pub Height: FLOAT,
+}
+
 #[derive(Default, Clone)]
 pub struct MilPointAndSizeL
 {
@@ -90,7 +102,7 @@ pub struct MilPointAndSizeL
 
 pub type CMILSurfaceRect = RECT;
 
-#[derive(PartialEq)]
+#[derive(PartialEq, Clone, Copy)]
 pub enum MilAntiAliasMode {
     None = 0,
     EightByEight = 1,
@@ -109,7 +121,7 @@ pub const    PathPointTypeCloseSubpath: u8    = 0x80; // closed flag
 
 use std::cell::RefCell;
 
-use crate::{hwvertexbuffer::CHwVertexBuffer, OutputVertex};
+use crate::{allocator::{CTransientAllocator, CTransientArray}, hwvertexbuffer::CHwVertexBuffer, aarasterizer::{CInactiveEdge, CActiveEdgeArrayBuffers, CEdgeBlockArray}, aacoverage::CCoverageInterval, OutputVertex, InteriorTrapezoid, OutputTrapezoid, OutputSpan};
 
 
 pub type DynArray<T> = Vec<T>;
@@ -144,7 +156,11 @@ impl<T> DynArrayExts<T> for DynArray<T> {
 #[derive(Default)]
 pub struct CD3DDeviceLevel1 {
     pub clipRect: MilPointAndSizeL,
-    pub output: RefCell<Vec<OutputVertex>>
+    pub output: RefCell<Vec<OutputVertex>>,
+    pub interior: RefCell<Vec<InteriorTrapezoid>>,
+    pub trapezoids: RefCell<Vec<OutputTrapezoid>>,
+    pub spans: RefCell<Vec<OutputSpan>>,
+    pub bufferDispenser: RefCell<CBufferDispenser>,
 }
 impl CD3DDeviceLevel1 {
     pub fn new() -> Self { Default::default() }
@@ -153,7 +169,25 @@ impl CD3DDeviceLevel1 {
     }
     pub fn GetViewport(&self) -> MilPointAndSizeL { self.clipRect.clone() }
     pub fn GetVB_XYZDUV2(&self) -> Box<CHwVertexBuffer> {
-        Box::new(Default::default())
+        let mut bufferDispenser = self.bufferDispenser.borrow_mut();
+        let allocator = bufferDispenser.m_allocator;
+        bufferDispenser.m_pVB.take().unwrap_or_else(|| Box::new(CHwVertexBuffer::new(allocator)))
+    }
+    pub fn ReleaseVB_XYZDUV2(&self, pVB: Box<CHwVertexBuffer>) {
+        self.bufferDispenser.borrow_mut().m_pVB = Some(pVB);
+    }
+    pub fn GetEdgeBlocks(&self) -> (CEdgeBlockArray, CTransientArray<CEdgeBlockArray>) {
+        let mut bufferDispenser = self.bufferDispenser.borrow_mut();
+        let allocator = bufferDispenser.m_allocator;
+        (
+            std::mem::replace(&mut bufferDispenser.m_rgEdgeBlock, CTransientArray::new(allocator)),
+            std::mem::replace(&mut bufferDispenser.m_rgThreadEdgeBlocks, CTransientArray::new(allocator)),
+        )
+    }
+    pub fn ReleaseEdgeBlocks(&self, rgBlock: CEdgeBlockArray, rgThreadBlocks: CTransientArray<CEdgeBlockArray>) {
+        let mut bufferDispenser = self.bufferDispenser.borrow_mut();
+        bufferDispenser.m_rgEdgeBlock = rgBlock;
+        bufferDispenser.m_rgThreadEdgeBlocks = rgThreadBlocks;
     }
     
 }
@@ -193,7 +227,45 @@ pub enum MilVertexFormatAttribute {
 
 pub struct CHwPipeline;
 
-pub struct CBufferDispenser;
+// Transient allocations that are handed back at the end of a draw and
+// handed out again on the next one, instead of going back to the heap.
+// All of them come from 'm_allocator'.
+#[derive(Default)]
+pub struct CBufferDispenser {
+    pub m_allocator: CTransientAllocator,
+    pub m_pVB: Option<Box<CHwVertexBuffer>>,
+    // Always empty while it is kept here; see CHwRasterizer::AllocateInactiveArray
+    pub m_rgInactiveArray: CTransientArray<CInactiveEdge<'static>>,
+    pub m_rgCoverageInterval: CTransientArray<CCoverageInterval>,
+    pub m_activeEdgeArrayBuffers: CActiveEdgeArrayBuffers,
+    // Emptied edge store blocks; see CEdgeStore::with_device
+    pub m_rgEdgeBlock: CEdgeBlockArray,
+    pub m_rgThreadEdgeBlocks: CTransientArray<CEdgeBlockArray>,
+    // The pixel spans of RasterizeAliasedEdges
+    pub m_rgAliasedSpanRun: CTransientArray<(INT, INT)>,
+    pub m_rgAliasedSpan: CTransientArray<(INT, INT)>,
+}
+
+impl CBufferDispenser {
+    pub fn new(allocator: CTransientAllocator) -> Self {
+        Self {
+            m_allocator: allocator,
+            m_pVB: None,
+            m_rgInactiveArray: CTransientArray::new(allocator),
+            m_rgCoverageInterval: CTransientArray::new(allocator),
+            m_activeEdgeArrayBuffers: CActiveEdgeArrayBuffers::new(allocator),
+            m_rgEdgeBlock: CTransientArray::new(allocator),
+            m_rgThreadEdgeBlocks: CTransientArray::new(allocator),
+            m_rgAliasedSpanRun: CTransientArray::new(allocator),
+            m_rgAliasedSpan: CTransientArray::new(allocator),
+        }
+    }
+
+    // Give every buffer back to the allocator, keeping the allocator
+    pub fn ReleaseBuffers(&mut self) {
+        *self = Self::new(self.m_allocator);
+    }
+}
 #[derive(Default)]
 pub struct PointXYA
 {